@@ -1,5 +1,6 @@
 #include "config.h"
 
+#include <algorithm>
 #include <iostream>
 #define YAML_CPP_STATIC_DEFINE
 #include "yaml-cpp/yaml.h"
@@ -56,12 +57,180 @@ static void parse_pve_config(const YAML::Node & yaml_node, Config & config)
             config._pve_api_token_id = pa["token-id"].as<std::string>();
         if (pa["token-uuid"])
             config._pve_api_token_uuid = pa["token-uuid"].as<std::string>();
+        if (pa["guest-discovery"])
+        {
+            const auto & gd = pa["guest-discovery"];
+            if (gd["concurrency"])
+                config._guest_discovery_concurrency = std::max(1, gd["concurrency"].as<int>());
+            if (gd["timeout-ms"])
+                config._guest_discovery_timeout = std::chrono::milliseconds(gd["timeout-ms"].as<uint64_t>());
+        }
     }
     if (yaml_node["sync_host_static_v6_address"])
     {
         const auto val = yaml_node["sync_host_static_v6_address"].as<std::string>();
         config._sync_host_static_v6_address = val == "true";
     }
+    if (yaml_node["sync_host_static_v6_verify"])
+    {
+        const auto & verify = yaml_node["sync_host_static_v6_verify"];
+        if (verify["interval-ms"])
+        {
+            const auto interval_ms = verify["interval-ms"].as<uint64_t>();
+            config._sync_host_static_v6_verify_interval = std::chrono::milliseconds(interval_ms);
+        }
+        if (verify["timeout-ms"])
+        {
+            const auto timeout_ms = verify["timeout-ms"].as<uint64_t>();
+            config._sync_host_static_v6_verify_timeout = std::chrono::milliseconds(timeout_ms);
+        }
+    }
+}
+
+// Parse HTTP retry policy fields from yaml node, missing fields are kept
+static void parse_http_retry_policy(const YAML::Node & yaml_node, http_retry_policy & policy)
+{
+    if (yaml_node["max-attempts"])
+        policy.max_attempts = std::max(1, yaml_node["max-attempts"].as<int>());
+    if (yaml_node["base-delay-ms"])
+        policy.base_delay = std::chrono::milliseconds(yaml_node["base-delay-ms"].as<uint64_t>());
+    if (yaml_node["max-delay-ms"])
+        policy.max_delay = std::chrono::milliseconds(yaml_node["max-delay-ms"].as<uint64_t>());
+}
+
+// Parse HTTP timeouts from yaml node, missing fields are kept
+static void parse_http_timeouts(const YAML::Node & yaml_node, http_timeouts & timeouts)
+{
+    if (yaml_node["connect-ms"])
+        timeouts.connect = std::chrono::milliseconds(yaml_node["connect-ms"].as<uint64_t>());
+    if (yaml_node["tls-ms"])
+        timeouts.tls = std::chrono::milliseconds(yaml_node["tls-ms"].as<uint64_t>());
+    if (yaml_node["first-byte-ms"])
+        timeouts.first_byte = std::chrono::milliseconds(yaml_node["first-byte-ms"].as<uint64_t>());
+    if (yaml_node["total-ms"])
+        timeouts.total = std::chrono::milliseconds(yaml_node["total-ms"].as<uint64_t>());
+}
+
+// Parse HTTP client config from yaml node
+static void parse_http_config(const YAML::Node & yaml_node, Config & config)
+{
+    if (!yaml_node["http"])
+        return;
+
+    const auto & http = yaml_node["http"];
+    if (http["timeout-ms"])
+        config._http_timeouts.total = std::chrono::milliseconds(http["timeout-ms"].as<uint64_t>());
+    if (http["timeouts"])
+    {
+        const auto & timeouts = http["timeouts"];
+        parse_http_timeouts(timeouts, config._http_timeouts);
+        // Service timeouts are based on the default ones
+        if (timeouts["services"] && timeouts["services"].IsMap())
+        {
+            for (const auto & service : timeouts["services"])
+            {
+                http_timeouts service_timeouts = config._http_timeouts;
+                parse_http_timeouts(service.second, service_timeouts);
+                config._http_service_timeouts[service.first.as<std::string>()] = service_timeouts;
+            }
+        }
+    }
+    if (http["pool-max-idle"])
+        config._http_pool_max_idle = http["pool-max-idle"].as<size_t>();
+    if (http["pool-idle-timeout-ms"])
+    {
+        const auto idle_ms = http["pool-idle-timeout-ms"].as<uint64_t>();
+        config._http_pool_idle_timeout = std::chrono::milliseconds(idle_ms);
+    }
+    if (http["ca-file"])
+        config._http_ca_file = http["ca-file"].as<std::string>();
+    if (http["ca-cache-timeout-ms"])
+    {
+        const auto ca_cache_ms = http["ca-cache-timeout-ms"].as<uint64_t>();
+        config._http_ca_cache_timeout = std::chrono::milliseconds(ca_cache_ms);
+    }
+    if (http["http2"])
+    {
+        const auto val = http["http2"].as<std::string>();
+        config._http2 = val == "true";
+    }
+    if (http["http2-max-streams"])
+        config._http2_max_streams = http["http2-max-streams"].as<long>();
+    if (http["compression"])
+    {
+        const auto val = http["compression"].as<std::string>();
+        config._http_compression = val == "true";
+    }
+    if (http["connect-to"] && http["connect-to"].IsSequence())
+    {
+        for (const auto & item : http["connect-to"])
+            config._http_connect_to.push_back(item.as<std::string>());
+    }
+    if (http["rate-limit"] && http["rate-limit"].IsMap())
+    {
+        for (const auto & item : http["rate-limit"])
+        {
+            auto & limit = config._http_rate_limits[item.first.as<std::string>()];
+            if (item.second["requests-per-second"])
+                limit.rate = std::max(0.0, item.second["requests-per-second"].as<double>());
+            if (item.second["burst"])
+                limit.burst = std::max(1.0, item.second["burst"].as<double>());
+        }
+    }
+    if (http["circuit-breaker"])
+    {
+        const auto & cb = http["circuit-breaker"];
+        auto & cb_config = config._http_circuit_breaker;
+        if (cb["window"])
+            cb_config.window = std::max(1, cb["window"].as<int>());
+        if (cb["min-calls"])
+            cb_config.min_calls = std::max(1, cb["min-calls"].as<int>());
+        if (cb["failure-rate"])
+            cb_config.failure_rate = cb["failure-rate"].as<double>();
+        if (cb["open-ms"])
+            cb_config.open_duration = std::chrono::milliseconds(cb["open-ms"].as<uint64_t>());
+        if (cb["probe-timeout-ms"])
+            cb_config.probe_timeout = std::chrono::milliseconds(cb["probe-timeout-ms"].as<uint64_t>());
+    }
+    if (http["cassette"])
+    {
+        const auto & cassette = http["cassette"];
+        if (cassette["mode"])
+            config._http_cassette.mode = cassette["mode"].as<std::string>();
+        if (cassette["file"])
+            config._http_cassette.file = cassette["file"].as<std::string>();
+        if (cassette["latency-scale"])
+            config._http_cassette.latency_scale = std::max(0.0, cassette["latency-scale"].as<double>());
+    }
+    if (http["fault-injection"])
+    {
+        const auto & fault = http["fault-injection"];
+        auto & fault_config = config._http_fault_injection;
+        fault_config.enabled = true;
+        if (fault["latency-ms"])
+            fault_config.latency = std::chrono::milliseconds(fault["latency-ms"].as<uint64_t>());
+        if (fault["jitter-ms"])
+            fault_config.jitter = std::chrono::milliseconds(fault["jitter-ms"].as<uint64_t>());
+        if (fault["error-rate"])
+            fault_config.error_rate = std::min(1.0, std::max(0.0, fault["error-rate"].as<double>()));
+        if (fault["http-error-rate"])
+            fault_config.http_error_rate = std::min(1.0, std::max(0.0, fault["http-error-rate"].as<double>()));
+    }
+    if (http["retry"])
+    {
+        const auto & retry = http["retry"];
+        parse_http_retry_policy(retry, config._http_retry);
+        // Endpoint policies are based on the default one
+        if (retry["endpoints"] && retry["endpoints"].IsMap())
+        {
+            for (const auto & endpoint : retry["endpoints"])
+            {
+                http_retry_policy policy = config._http_retry;
+                parse_http_retry_policy(endpoint.second, policy);
+                config._http_retry_endpoints[endpoint.first.as<std::string>()] = policy;
+            }
+        }
+    }
 }
 
 // Parse general config from yaml node
@@ -72,6 +241,25 @@ static void parse_general_config(const YAML::Node & yaml_node, Config & config)
         const auto interval_ms = yaml_node["update-interval-ms"].as<uint64_t>();
         config._update_interval = std::chrono::milliseconds(interval_ms);
     }
+    if (yaml_node["cycle-budget-ms"])
+        config._cycle_budget = std::chrono::milliseconds(yaml_node["cycle-budget-ms"].as<uint64_t>());
+    if (yaml_node["pipeline-queue-size"])
+        config._pipeline_queue_size = std::max<size_t>(1, yaml_node["pipeline-queue-size"].as<size_t>());
+    if (yaml_node["dns-write-concurrency"])
+        config._dns_write_concurrency = std::max(1, yaml_node["dns-write-concurrency"].as<int>());
+    if (yaml_node["shutdown-grace-ms"])
+        config._shutdown_grace = std::chrono::milliseconds(yaml_node["shutdown-grace-ms"].as<uint64_t>());
+    if (yaml_node["addr-watch"])
+    {
+        const auto & watch = yaml_node["addr-watch"];
+        auto & watch_config = config._addr_watch;
+        if (watch["enabled"])
+            watch_config.enabled = watch["enabled"].as<std::string>() == "true";
+        if (watch["debounce-ms"])
+            watch_config.debounce = std::chrono::milliseconds(watch["debounce-ms"].as<uint64_t>());
+        if (watch["poll-interval-ms"])
+            watch_config.poll_interval = std::chrono::milliseconds(watch["poll-interval-ms"].as<uint64_t>());
+    }
 
     parse_logger_config(yaml_node, config);
 
@@ -107,6 +295,7 @@ static void parse_general_config(const YAML::Node & yaml_node, Config & config)
             config._notify_service_credentials = notify["credentials"].as<std::string>();
     }
 
+    parse_http_config(yaml_node, config);
     parse_pve_config(yaml_node, config);
 }
 
@@ -133,6 +322,28 @@ static void parse_ddns_config(const YAML::Node & yaml_node, config_node & cfg_no
         for (auto it = ipv4_domains.begin(); it != ipv4_domains.end(); ++it)
             cfg_node.ipv6_domains.emplace_back(it->as<std::string>());
     }
+    if (yaml_node["update-interval-ms"])
+        cfg_node.update_interval = std::chrono::milliseconds(yaml_node["update-interval-ms"].as<uint64_t>());
+    if (yaml_node["adaptive"])
+    {
+        const auto & adaptive = yaml_node["adaptive"];
+        auto & adaptive_config = cfg_node.adaptive;
+        adaptive_config.enabled = true;
+        if (adaptive["backoff-factor"])
+            adaptive_config.backoff_factor = std::max(1.0, adaptive["backoff-factor"].as<double>());
+        if (adaptive["max-interval-ms"])
+            adaptive_config.max_interval = std::chrono::milliseconds(adaptive["max-interval-ms"].as<uint64_t>());
+        if (adaptive["fast-interval-ms"])
+            adaptive_config.fast_interval = std::chrono::milliseconds(adaptive["fast-interval-ms"].as<uint64_t>());
+        if (adaptive["fast-window-ms"])
+            adaptive_config.fast_window = std::chrono::milliseconds(adaptive["fast-window-ms"].as<uint64_t>());
+    }
+}
+
+const http_timeouts & Config::getHttpTimeouts(const std::string & service) const
+{
+    const auto found = _http_service_timeouts.find(service);
+    return _http_service_timeouts.end() != found ? found->second : _http_timeouts;
 }
 
 bool Config::loadConfig(const std::string & config_file)
@@ -145,6 +356,25 @@ bool Config::loadConfig(const std::string & config_file)
         _client_config = {};
         _host_config = {};
         _guest_configs.clear();
+        // HTTP options are parsed into the current values (merged into maps and lists), so they are reset to
+        // defaults to not keep options removed from the file on reload
+        const Config defaults;
+        _http_timeouts = defaults._http_timeouts;
+        _http_service_timeouts = defaults._http_service_timeouts;
+        _http_pool_max_idle = defaults._http_pool_max_idle;
+        _http_pool_idle_timeout = defaults._http_pool_idle_timeout;
+        _http_ca_file = defaults._http_ca_file;
+        _http_ca_cache_timeout = defaults._http_ca_cache_timeout;
+        _http2 = defaults._http2;
+        _http2_max_streams = defaults._http2_max_streams;
+        _http_compression = defaults._http_compression;
+        _http_connect_to = defaults._http_connect_to;
+        _http_retry = defaults._http_retry;
+        _http_retry_endpoints = defaults._http_retry_endpoints;
+        _http_circuit_breaker = defaults._http_circuit_breaker;
+        _http_cassette = defaults._http_cassette;
+        _http_fault_injection = defaults._http_fault_injection;
+        _http_rate_limits = defaults._http_rate_limits;
         // Mandatory general node
         if (conf["general"])
         {
@@ -207,3 +437,30 @@ bool Config::loadConfig(const std::string & config_file)
 
     return conf_valid;
 }
+
+bool Config::prepareReload(const std::string & config_file)
+{
+    std::shared_ptr<Config> reloaded(new Config(*this));
+    reloaded->_reloaded.reset();
+    if (!reloaded->loadConfig(config_file))
+        return false;
+    _reloaded = std::move(reloaded);
+    return true;
+}
+
+bool Config::applyReload()
+{
+    if (nullptr == _reloaded)
+        return false;
+
+    std::shared_ptr<Config> other = std::move(_reloaded);
+    other->_ipv4_records = std::move(_ipv4_records);
+    other->_ipv6_records = std::move(_ipv6_records);
+    other->_my_public_ipv4 = _my_public_ipv4;
+    other->_my_public_ipv6 = _my_public_ipv6;
+    const Config previous(*this);
+    *this = *other;
+    *other = previous;
+    _reloaded = std::move(other);
+    return true;
+}
@@ -3,11 +3,25 @@
 
 #include <string>
 #include <chrono>
+#include <memory>
 #include <vector>
 #include <unordered_map>
 
 #include "spdlog/spdlog.h"
 
+// Adaptive polling of an update target, interval stretches while its address is stable
+typedef struct adaptive_polling_config_
+{
+    bool enabled = false;
+    // Interval is multiplied by this after each observation with unchanged address
+    double backoff_factor = 2.0;
+    // Upper bound of the stretched interval
+    std::chrono::milliseconds max_interval = std::chrono::milliseconds(3600000);
+    // Interval used for fast_window after an address change
+    std::chrono::milliseconds fast_interval = std::chrono::milliseconds(30000);
+    std::chrono::milliseconds fast_window = std::chrono::milliseconds(600000);
+} adaptive_polling_config;
+
 // Config node
 typedef struct config_node_
 {
@@ -23,6 +37,10 @@ typedef struct config_node_
     std::vector<std::string> ipv4_domains;
     // IPv6 domain names to update
     std::vector<std::string> ipv6_domains;
+    // Update interval of this target, 0 to use general update interval
+    std::chrono::milliseconds update_interval = std::chrono::milliseconds(0);
+    // Adaptive polling, update interval is the base interval
+    adaptive_polling_config adaptive;
 } config_node;
 
 // DNS record node
@@ -34,6 +52,90 @@ typedef struct dns_record_node_
     std::string last_ip;
 } dns_record_node;
 
+// HTTP request timeouts, 0 to disable
+typedef struct http_timeouts_
+{
+    // TCP connect
+    std::chrono::milliseconds connect = std::chrono::milliseconds(10000);
+    // TLS handshake
+    std::chrono::milliseconds tls = std::chrono::milliseconds(10000);
+    // From request sent to first response byte
+    std::chrono::milliseconds first_byte = std::chrono::milliseconds(20000);
+    // Whole request
+    std::chrono::milliseconds total = std::chrono::milliseconds(30000);
+    // Deadline over all attempts, set per call rather than configured (max for none)
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+} http_timeouts;
+
+// HTTP retry policy
+typedef struct http_retry_policy_
+{
+    // Max attempts including the first one, 1 disables retry
+    int max_attempts = 3;
+    // Backoff base delay, doubled per attempt
+    std::chrono::milliseconds base_delay = std::chrono::milliseconds(500);
+    // Backoff upper bound, also the longest Retry-After honored
+    std::chrono::milliseconds max_delay = std::chrono::milliseconds(30000);
+} http_retry_policy;
+
+// HTTP request rate limit (token bucket)
+typedef struct http_rate_limit_
+{
+    // Sustained requests per second, 0 for unlimited
+    double rate = 0;
+    // Max burst of requests
+    double burst = 1;
+} http_rate_limit;
+
+// HTTP circuit breaker (per endpoint scheme+host+port)
+typedef struct http_circuit_breaker_config_
+{
+    // Number of recent calls the failure rate is computed over
+    int window = 10;
+    // Min calls in window before the circuit may open
+    int min_calls = 4;
+    // Failure rate opening the circuit
+    double failure_rate = 0.5;
+    // How long the circuit stays open before a probe request is let through
+    std::chrono::milliseconds open_duration = std::chrono::milliseconds(30000);
+    // Timeout of probe requests
+    std::chrono::milliseconds probe_timeout = std::chrono::milliseconds(5000);
+} http_circuit_breaker_config;
+
+typedef struct http_cassette_config_
+{
+    // off, record or replay
+    std::string mode = "off";
+    // Cassette file
+    std::string file;
+    // Replayed latencies are multiplied by this, 0 replays without delay
+    double latency_scale = 1.0;
+} http_cassette_config;
+
+typedef struct http_fault_injection_config_
+{
+    // Inject faults into request attempts in the HTTP engine
+    bool enabled = false;
+    // Latency added to every request
+    std::chrono::milliseconds latency{ 0 };
+    // Random extra latency, uniform in [0, jitter]
+    std::chrono::milliseconds jitter{ 0 };
+    // Probability of a request failing as a connection error
+    double error_rate = 0;
+    // Probability of a request getting a 503 response
+    double http_error_rate = 0;
+} http_fault_injection_config;
+
+typedef struct addr_watch_config_
+{
+    // Listen for address changes of local interfaces (client iface public IP service, host iface) via netlink
+    bool enabled = true;
+    // Delay from first address event of an interface to the update, events within it are merged
+    std::chrono::milliseconds debounce = std::chrono::milliseconds(1000);
+    // Update interval of watched targets, polling is only a safety net for missed events
+    std::chrono::milliseconds poll_interval = std::chrono::milliseconds(3600000);
+} addr_watch_config;
+
 // Global config singleton
 class Config
 {
@@ -47,16 +149,71 @@ public:
     // Load config yaml
     bool loadConfig(const std::string & config_file);
 
+    // Parse config yaml into a copy of current config for applyReload, current config is untouched if it fails
+    bool prepareReload(const std::string & config_file);
+
+    // Swap in config parsed by prepareReload, runtime state (records, public addresses) is kept. The replaced
+    // config is held, so calling it again reverts the reload.
+    bool applyReload();
+
+    // Get HTTP timeouts of service (public-ip, pve-api or dns service type), default ones if not configured
+    const http_timeouts & getHttpTimeouts(const std::string & service) const;
+
     // Config yaml file path
     std::string _yml_path;
     // Log file saving path
     std::string _log_path;
 
-    // Default http request timeout 30s
-    long _http_timeout_ms = 30000;
+    // Default http request timeouts
+    http_timeouts _http_timeouts;
+    // HTTP request timeouts by service
+    std::unordered_map<std::string, http_timeouts> _http_service_timeouts;
+    // Max idle curl handles kept in pool, connections are kept in the shared curl connection cache instead
+    size_t _http_pool_max_idle = 16;
+    // Pooled curl handles idle longer than this are closed
+    std::chrono::milliseconds _http_pool_idle_timeout = std::chrono::milliseconds(60000);
+    // CA bundle file, empty to use curl default
+    std::string _http_ca_file;
+    // How long parsed CA store is kept in memory
+    std::chrono::milliseconds _http_ca_cache_timeout = std::chrono::milliseconds(86400000);
+    // Negotiate HTTP/2 (via ALPN) and multiplex concurrent requests over one connection
+    bool _http2 = false;
+    // Max concurrent HTTP/2 streams per connection
+    long _http2_max_streams = 100;
+    // Offer compressed responses (gzip/deflate, br if supported by libcurl)
+    bool _http_compression = true;
+    // Connections to host:port are redirected to connect-host:connect-port ("host:port:connect-host:connect-port"),
+    // TLS still verifies the original host name, e.g. to run against the local mock server
+    std::vector<std::string> _http_connect_to;
+    // Default HTTP retry policy
+    http_retry_policy _http_retry;
+    // HTTP retry policies by endpoint host name
+    std::unordered_map<std::string, http_retry_policy> _http_retry_endpoints;
+    // HTTP circuit breaker
+    http_circuit_breaker_config _http_circuit_breaker;
+    // Record HTTP traffic to, or replay it from a cassette file
+    http_cassette_config _http_cassette;
+    // Latency and failures injected into HTTP requests, for testing
+    http_fault_injection_config _http_fault_injection;
+    // Request rate limits by dns service type, shared by all requests with the same credentials
+    std::unordered_map<std::string, http_rate_limit> _http_rate_limits = {
+        { "cloudflare", { 4, 10 } },
+        { "porkbun", { 1, 5 } },
+        { "dnspod", { 2, 5 } },
+    };
 
     // Update interval
     std::chrono::milliseconds _update_interval = std::chrono::milliseconds(300000);
+    // Time budget of one update cycle, requests are cut short when it runs out (0 to use update interval)
+    std::chrono::milliseconds _cycle_budget = std::chrono::milliseconds(0);
+    // Capacity of each queue between update pipeline stages (observe, plan, apply)
+    size_t _pipeline_queue_size = 64;
+    // Concurrent record writes per DNS service instance (per type and credentials), Lua services write one at a time
+    int _dns_write_concurrency = 4;
+    // In-flight requests are given this long to finish on SIGTERM/SIGINT before they are aborted
+    std::chrono::milliseconds _shutdown_grace = std::chrono::milliseconds(500);
+    // Netlink address watch (Linux only)
+    addr_watch_config _addr_watch;
 
     // Max log files to keep
     int _max_log_files = 5;
@@ -90,7 +247,16 @@ public:
     std::string _pve_api_token_id;
     std::string _pve_api_token_uuid;
 
+    // Guests whose addresses are queried at the same time
+    int _guest_discovery_concurrency = 8;
+    // Deadline of one guest address query, a hung guest agent is given up on after it
+    std::chrono::milliseconds _guest_discovery_timeout = std::chrono::milliseconds(15000);
+
     bool _sync_host_static_v6_address = false;
+    // Host address is polled at this interval after a synced static IPv6 address is applied
+    std::chrono::milliseconds _sync_host_static_v6_verify_interval = std::chrono::milliseconds(2000);
+    // Sync is given up (and attempted again next cycle) if the host does not have the address after it
+    std::chrono::milliseconds _sync_host_static_v6_verify_timeout = std::chrono::milliseconds(60000);
 
     // Client config
     config_node  _client_config;
@@ -105,10 +271,10 @@ public:
     std::unordered_map<std::string, dns_record_node> _ipv4_records;
     std::unordered_map<std::string, dns_record_node> _ipv6_records;
 
-    // Last update time
-    std::chrono::milliseconds _last_update_time = std::chrono::milliseconds(0);
-
 private:
+    // Config parsed by prepareReload, or the replaced one after applyReload
+    std::shared_ptr<Config> _reloaded;
+
     // ctor is hidden
     Config() = default;
     // copy ctor is hidden
@@ -8,7 +8,8 @@
 #include "dns_service_cloudflare.h"
 #include "dns_service_lua.h"
 
-IDnsService * DnsServiceFactory::create(const std::string & service_name)
+IDnsService * DnsServiceFactory::create(const std::string & service_name,
+                                        const std::shared_ptr<IHttpTransport> & transport)
 {
     if (service_name.empty())
     {
@@ -18,7 +19,7 @@ IDnsService * DnsServiceFactory::create(const std::string & service_name)
 
     if (str_iequals(service_name, DNS_SERVICE_PORKBUN))
     {
-        auto * service = new(std::nothrow) DnsServicePorkbun();
+        auto * service = new(std::nothrow) DnsServicePorkbun(transport);
         if (nullptr == service)
         {
             SPDLOG_ERROR("Failed to instantiate DnsServicePorkbun!");
@@ -29,7 +30,7 @@ IDnsService * DnsServiceFactory::create(const std::string & service_name)
 
     if (str_iequals(service_name, DNS_SERVICE_DNSPOD))
     {
-        auto * service = new(std::nothrow) DnsServiceDnspod();
+        auto * service = new(std::nothrow) DnsServiceDnspod(transport);
         if (nullptr == service)
         {
             SPDLOG_ERROR("Failed to instantiate DnsServiceDnspod!");
@@ -40,7 +41,7 @@ IDnsService * DnsServiceFactory::create(const std::string & service_name)
 
     if (str_iequals(service_name, DNS_SERVICE_CLOUDFLARE))
     {
-        auto * service = new(std::nothrow) DnsServiceCloudflare();
+        auto * service = new(std::nothrow) DnsServiceCloudflare(transport);
         if (nullptr == service)
         {
             SPDLOG_ERROR("Failed to instantiate DnsServiceCloudflare!");
@@ -50,7 +51,7 @@ IDnsService * DnsServiceFactory::create(const std::string & service_name)
     }
 
     // Try loading the LUA module with the service_name
-    auto * getter = new(std::nothrow) DnsServiceLua();
+    auto * getter = new(std::nothrow) DnsServiceLua(transport);
     if (nullptr == getter)
     {
         SPDLOG_ERROR("Failed to instantiate DnsServiceLua!");
@@ -1,8 +1,11 @@
 #ifndef PVE_DDNS_CLIENT_SRC_DNS_SERVICE_DNS_SERVICE_H
 #define PVE_DDNS_CLIENT_SRC_DNS_SERVICE_DNS_SERVICE_H
 
+#include <memory>
 #include <string>
 
+class IHttpTransport;
+
 /// DNS service implementations
 constexpr const char * DNS_SERVICE_PORKBUN = "porkbun";
 constexpr const char * DNS_SERVICE_DNSPOD = "dnspod";
@@ -43,6 +46,10 @@ public:
     /// \param ip IPv6 address string
     /// \return Operation result
     virtual bool setIpv6(const std::string & domain, const std::string & ip) = 0;
+
+    /// Check if setIpv4/setIpv6 may be called from several threads at once
+    /// \return Result
+    virtual bool isConcurrentWriteSafe() const { return false; }
 };
 
 /// DNS service factory
@@ -51,8 +58,9 @@ class DnsServiceFactory
 public:
     /// Create DNS service instance
     /// \param service_name Service name
+    /// \param transport HTTP transport used by the instance
     /// \return Instance pointer or nullptr if failed
-    static IDnsService * create(const std::string & service_name);
+    static IDnsService * create(const std::string & service_name, const std::shared_ptr<IHttpTransport> & transport);
 
     /// Destroy DNS service instance
     /// \param dns_service Instance pointer
@@ -7,12 +7,14 @@
 
 #include "../utils.h"
 #include "../config.h"
+#include "../http/http_arena.h"
+#include "../http/http_headers.h"
+#include "../http/http_rate_limiter.h"
 
-static constexpr const char * API_HOST = "https://api.cloudflare.com/client/v4/";
-static constexpr const char * API_VERIFY_TOKEN = "user/tokens/verify";
-static constexpr const char * API_LIST_ZONES = "zones";
-static constexpr const char * API_LIST_RECORDS = "zones/{}/dns_records";
-static constexpr const char * API_PATCH_RECORD = "zones/{}/dns_records/{}";
+static constexpr const char * API_VERIFY_TOKEN = "https://api.cloudflare.com/client/v4/user/tokens/verify";
+static constexpr const char * API_LIST_ZONES = "https://api.cloudflare.com/client/v4/zones?name={}";
+static constexpr const char * API_LIST_RECORDS = "https://api.cloudflare.com/client/v4/zones/{}/dns_records?type={}&name={}";
+static constexpr const char * API_PATCH_RECORD = "https://api.cloudflare.com/client/v4/zones/{}/dns_records/{}";
 
 const std::string & DnsServiceCloudflare::getServiceName()
 {
@@ -27,6 +29,8 @@ bool DnsServiceCloudflare::setCredentials(const std::string & cred_str)
         return false;
     }
     _token = cred_str;
+    _auth_headers = HttpHeaders({ fmt::format("Authorization: Bearer {}", _token) });
+    _rate_limit_key = HttpRateLimiter::getInstance().getKey(_service_name, _token);
     if (!verifyToken())
     {
         SPDLOG_WARN("Invalid cloudflare API token '{}'!", cred_str);
@@ -66,21 +70,21 @@ bool DnsServiceCloudflare::verifyToken()
 
     const auto & config = Config::getInstance();
 
-    const std::string req_url = fmt::format("{}{}", API_HOST, API_VERIFY_TOKEN);
+    const std::string req_url = API_VERIFY_TOKEN;
 
     int resp_code = 0;
-    std::string resp_data;
-    std::vector<std::string> headers = { fmt::format("Authorization: Bearer {}", _token) };
-    const bool ret = http_req(req_url, "", Config::getInstance()._http_timeout_ms, headers, "",
-                              resp_code, resp_data);
+    HttpArena arena;
+    std::string & resp_data = arena.buffer();
+    const bool ret = http_req(*_transport, req_url, "", Config::getInstance().getHttpTimeouts(_service_name),
+                              _auth_headers, "", _rate_limit_key, "cloudflare.verify_token", resp_code, resp_data);
     if (!ret || 200 != resp_code)
     {
         SPDLOG_WARN("Failed to request '{}', response code is {}, response is {}!", req_url, resp_code, resp_data);
         return false;
     }
 
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.Parse(resp_data.c_str());
+    ArenaDocument & d = arena.document();
+    rapidjson::ParseResult ok = arena.parse();
     if (!ok)
     {
         SPDLOG_WARN("Failed to parse response json, error '{}' ({})", 
@@ -102,21 +106,21 @@ bool DnsServiceCloudflare::getZoneId(const std::string & domain_name, std::strin
 {
     const auto & config = Config::getInstance();
 
-    const std::string req_url = fmt::format("{}{}?name={}", API_HOST, API_LIST_ZONES, domain_name);
+    const std::string req_url = fmt::format(API_LIST_ZONES, domain_name);
 
     int resp_code = 0;
-    std::string resp_data;
-    std::vector<std::string> headers = { fmt::format("Authorization: Bearer {}", _token) };
-    const bool ret = http_req(req_url, "", Config::getInstance()._http_timeout_ms, headers, "",
-                              resp_code, resp_data);
+    HttpArena arena;
+    std::string & resp_data = arena.buffer();
+    const bool ret = http_req(*_transport, req_url, "", Config::getInstance().getHttpTimeouts(_service_name),
+                              _auth_headers, "", _rate_limit_key, "cloudflare.list_zones", resp_code, resp_data);
     if (!ret || 200 != resp_code)
     {
         SPDLOG_WARN("Failed to request '{}', response code is {}, response is {}!", req_url, resp_code, resp_data);
         return false;
     }
 
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.Parse(resp_data.c_str());
+    ArenaDocument & d = arena.document();
+    rapidjson::ParseResult ok = arena.parse();
     if (!ok)
     {
         SPDLOG_WARN("Failed to parse response json, error '{}' ({})", 
@@ -150,22 +154,21 @@ bool DnsServiceCloudflare::getRecordId(const std::string & domain_name, const st
 {
     const auto & config = Config::getInstance();
 
-    const std::string api_part = fmt::format(API_LIST_RECORDS, zone_id);
-    const std::string req_url = fmt::format("{}{}?type={}&name={}", API_HOST, api_part, type, domain_name);
+    const std::string req_url = fmt::format(API_LIST_RECORDS, zone_id, type, domain_name);
 
     int resp_code = 0;
-    std::string resp_data;
-    std::vector<std::string> headers = { fmt::format("Authorization: Bearer {}", _token) };
-    const bool ret = http_req(req_url, "", Config::getInstance()._http_timeout_ms, headers, "",
-                              resp_code, resp_data);
+    HttpArena arena;
+    std::string & resp_data = arena.buffer();
+    const bool ret = http_req(*_transport, req_url, "", Config::getInstance().getHttpTimeouts(_service_name),
+                              _auth_headers, "", _rate_limit_key, "cloudflare.list_records", resp_code, resp_data);
     if (!ret || 200 != resp_code)
     {
         SPDLOG_WARN("Failed to request '{}', response code is {}, response is {}!", req_url, resp_code, resp_data);
         return false;
     }
 
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.Parse(resp_data.c_str());
+    ArenaDocument & d = arena.document();
+    rapidjson::ParseResult ok = arena.parse();
     if (!ok)
     {
         SPDLOG_WARN("Failed to parse response json, error '{}' ({})", 
@@ -206,24 +209,32 @@ std::string DnsServiceCloudflare::getIp(const std::string & domain, bool is_v4)
     rec_id_key.append(rec_type);
 
     std::string zone_id, record_id, record_content;
-    if (_zones.find(sub_domain.first) == _zones.end())
+    {
+        std::lock_guard<std::mutex> lock(_cache_mutex);
+        const auto found = _zones.find(sub_domain.first);
+        if (found != _zones.end())
+            zone_id = found->second;
+    }
+    if (zone_id.empty())
     {
         if (!getZoneId(sub_domain.first, zone_id))
         {
             SPDLOG_WARN("Failed to retrieve zone id of '{}'!", sub_domain.first);
             return "";
         }
+        std::lock_guard<std::mutex> lock(_cache_mutex);
         _zones[sub_domain.first] = zone_id;
     }
-    else
-        zone_id = _zones[sub_domain.first];
 
     if (!getRecordId(domain, zone_id, rec_type, record_id, record_content))
     {
         SPDLOG_WARN("Failed to retrieve DNS record id and/or content of '{}'!", rec_id_key);
         return "";
     }
-    _records[rec_id_key] = record_id;
+    {
+        std::lock_guard<std::mutex> lock(_cache_mutex);
+        _records[rec_id_key] = record_id;
+    }
 
     return record_content;
 }
@@ -236,16 +247,22 @@ bool DnsServiceCloudflare::setIp(const std::string & domain, const std::string &
     rec_id_key.append("_");
     rec_id_key.append(rec_type);
 
-    std::string zone_id, record_id, record_content;
-    if (_zones.find(sub_domain.first) == _zones.end())
+    std::string zone_id, record_id;
+    {
+        std::lock_guard<std::mutex> lock(_cache_mutex);
+        const auto zone = _zones.find(sub_domain.first);
+        if (zone != _zones.end())
+            zone_id = zone->second;
+        const auto record = _records.find(rec_id_key);
+        if (record != _records.end())
+            record_id = record->second;
+    }
+    if (zone_id.empty())
     {
         SPDLOG_WARN("Missing zone ID of '{}'!", sub_domain.first);
         return false;
     }
-    else
-        zone_id = _zones[sub_domain.first];
-
-    if (_records.find(rec_id_key) == _records.end())
+    if (record_id.empty())
     {
         SPDLOG_WARN("Missing DNS record ID of '{}'!", rec_id_key);
         return false;
@@ -253,15 +270,15 @@ bool DnsServiceCloudflare::setIp(const std::string & domain, const std::string &
 
     const auto & config = Config::getInstance();
 
-    const std::string api_part = fmt::format(API_PATCH_RECORD, zone_id, record_id);
-    const std::string req_url = fmt::format("{}{}", API_HOST, api_part);
+    const std::string req_url = fmt::format(API_PATCH_RECORD, zone_id, record_id);
     const std::string req_body = fmt::format(R"({{"type":"{}","name":"{}","content":"{}"}})",
                                              rec_type, domain, ip);
 
     int resp_code = 0;
-    std::string resp_data;
-    std::vector<std::string> headers = { fmt::format("Authorization: Bearer {}", _token) };
-    const bool ret = http_req(req_url, req_body, Config::getInstance()._http_timeout_ms, headers, "patch",
+    HttpArena arena;
+    std::string & resp_data = arena.buffer();
+    const bool ret = http_req(*_transport, req_url, req_body, Config::getInstance().getHttpTimeouts(_service_name),
+                              _auth_headers, "patch", _rate_limit_key, "cloudflare.patch_record",
                               resp_code, resp_data);
     if (!ret || 200 != resp_code)
     {
@@ -269,8 +286,8 @@ bool DnsServiceCloudflare::setIp(const std::string & domain, const std::string &
         return false;
     }
 
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.Parse(resp_data.c_str());
+    ArenaDocument & d = arena.document();
+    rapidjson::ParseResult ok = arena.parse();
     if (!ok)
     {
         SPDLOG_WARN("Failed to parse response json, error '{}' ({})", 
@@ -1,19 +1,26 @@
 #ifndef PVE_DDNS_CLIENT_SRC_DNS_SERVICE_DNS_SERVICE_CLOUDFLARE_H
 #define PVE_DDNS_CLIENT_SRC_DNS_SERVICE_DNS_SERVICE_CLOUDFLARE_H
 
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 
 #include "dns_service.h"
+#include "../http/http_headers.h"
+#include "../http/http_transport.h"
 
 class DnsServiceCloudflare : public IDnsService
 {
 public:
+    explicit DnsServiceCloudflare(std::shared_ptr<IHttpTransport> transport) : _transport(std::move(transport)) {}
+
     const std::string & getServiceName() override;
     bool setCredentials(const std::string & cred_str) override;
     std::string getIpv4(const std::string & domain) override;
     std::string getIpv6(const std::string & domain) override;
     bool setIpv4(const std::string & domain, const std::string & ip) override;
     bool setIpv6(const std::string & domain, const std::string & ip) override;
+    bool isConcurrentWriteSafe() const override { return true; }
 
 protected:
     bool verifyToken();
@@ -26,8 +33,16 @@ protected:
 private:
     /// Service name
     std::string _service_name = DNS_SERVICE_CLOUDFLARE;
+    /// HTTP transport
+    std::shared_ptr<IHttpTransport> _transport;
     /// API token
     std::string _token;
+    /// Prebuilt authorization headers
+    HttpHeaders _auth_headers;
+    /// Rate limiter bucket key
+    std::string _rate_limit_key;
+    /// Guards _zones and _records
+    std::mutex _cache_mutex;
     /// Zone ID map
     std::unordered_map<std::string, std::string> _zones;
     /// DNS record ID map
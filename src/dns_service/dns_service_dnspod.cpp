@@ -7,11 +7,14 @@
 
 #include "../utils.h"
 #include "../config.h"
+#include "../http/json_stream_extractor.h"
+#include "../http/http_arena.h"
+#include "../http/http_headers.h"
+#include "../http/http_rate_limiter.h"
 
-static constexpr const char * API_HOST = "https://dnsapi.cn/";
-static constexpr const char * API_VERSION = "Info.Version";
-static constexpr const char * API_RECORD_LIST = "Record.List";
-static constexpr const char * API_RECORD_DDNS = "Record.Ddns";
+static constexpr const char * API_VERSION = "https://dnsapi.cn/Info.Version";
+static constexpr const char * API_RECORD_LIST = "https://dnsapi.cn/Record.List";
+static constexpr const char * API_RECORD_DDNS = "https://dnsapi.cn/Record.Ddns";
 
 const std::string & DnsServiceDnspod::getServiceName()
 {
@@ -32,6 +35,8 @@ bool DnsServiceDnspod::setCredentials(const std::string & cred_str)
         return false;
     }
     _token = cred_str;
+    _common_params = fmt::format("login_token={}&format=json&lang=en", _token);
+    _rate_limit_key = HttpRateLimiter::getInstance().getKey(_service_name, _token);
 
     std::string api_version;
     if (!getVersion(api_version))
@@ -68,20 +73,22 @@ bool DnsServiceDnspod::getVersion(std::string & version)
 {
     const auto & config = Config::getInstance();
 
-    const std::string req_url = fmt::format("{}{}", API_HOST, API_VERSION);
-    const std::string req_body = fmt::format(R"(login_token={}&format=json)", _token);
+    const std::string req_url = API_VERSION;
+    const std::string & req_body = _common_params;
 
     int resp_code = 0;
-    std::string resp_data;
-    const bool ret = http_req(req_url, req_body, config._http_timeout_ms, {}, resp_code, resp_data);
+    HttpArena arena;
+    std::string & resp_data = arena.buffer();
+    const bool ret = http_req(*_transport, req_url, req_body, config.getHttpTimeouts(_service_name),
+                              HttpHeaders(), "", _rate_limit_key, "dnspod.version", resp_code, resp_data);
     if (!ret || 200 != resp_code)
     {
         SPDLOG_WARN("Failed to request '{}', response code is {}, response is {}!", req_url, resp_code, resp_data);
         return false;
     }
 
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.Parse(resp_data.c_str());
+    ArenaDocument & d = arena.document();
+    rapidjson::ParseResult ok = arena.parse();
     if (!ok)
     {
         SPDLOG_WARN("Failed to parse response json, error '{}' ({})", 
@@ -117,59 +124,85 @@ std::string DnsServiceDnspod::getIp(const std::string & domain, bool is_v4)
     const auto & config = Config::getInstance();
 
     const auto sub_domain = get_sub_domain(domain);
-    const std::string req_url = fmt::format("{}{}", API_HOST, API_RECORD_LIST);
+    const std::string req_url = API_RECORD_LIST;
     const std::string req_body = fmt::format(
-        R"(login_token={}&domain={}&sub_domain={}&record_type={}&format=json&lang=en)",
-        _token, sub_domain.first, sub_domain.second, is_v4 ? "A" : "AAAA"
+        R"({}&domain={}&sub_domain={}&record_type={})",
+        _common_params, sub_domain.first, sub_domain.second, is_v4 ? "A" : "AAAA"
     );
 
+    // Record list is parsed as it streams in, only status code and record fields are copied out
+    typedef struct record_fields_
+    {
+        std::string id;
+        std::string line_id;
+        std::string value;
+        bool has_value;
+    } record_fields;
+    std::string status_code;
+    record_fields cur_record = {};
+    std::vector<record_fields> records;
+
+    JsonStreamExtractor extractor;
+    extractor.onValue("status.code", [&status_code](const std::string & v, JsonValueType type)
+    {
+        if (JsonValueType::String == type)
+            status_code = v;
+    });
+    extractor.onValue("records[].id", [&cur_record](const std::string & v, JsonValueType type)
+    {
+        if (JsonValueType::String == type)
+            cur_record.id = v;
+    });
+    extractor.onValue("records[].line_id", [&cur_record](const std::string & v, JsonValueType type)
+    {
+        if (JsonValueType::String == type)
+            cur_record.line_id = v;
+    });
+    extractor.onValue("records[].value", [&cur_record](const std::string & v, JsonValueType type)
+    {
+        cur_record.has_value = JsonValueType::String == type;
+        if (cur_record.has_value)
+            cur_record.value = v;
+    });
+    extractor.onEnd("records[]", [&cur_record, &records]()
+    {
+        records.emplace_back(std::move(cur_record));
+        cur_record = {};
+    });
+
     int resp_code = 0;
-    std::string resp_data;
-    const bool ret = http_req(req_url, req_body, config._http_timeout_ms, {}, resp_code, resp_data);
+    std::string resp_head;
+    const bool ret = http_req_stream(*_transport, req_url, req_body, config.getHttpTimeouts(_service_name),
+                                     HttpHeaders(), "", _rate_limit_key, "dnspod.record_list", extractor,
+                                     resp_code, resp_head);
     if (!ret || 200 != resp_code)
     {
-        SPDLOG_WARN("Failed to request '{}', response code is {}, response is {}!", req_url, resp_code, resp_data);
+        SPDLOG_WARN("Failed to request '{}', response code is {}, response is {}!", req_url, resp_code, resp_head);
         return "";
     }
 
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.Parse(resp_data.c_str());
-    if (!ok)
+    if (!extractor.isComplete())
     {
-        SPDLOG_WARN("Failed to parse response json, error '{}' ({})", 
-            rapidjson::GetParseError_En(ok.Code()), ok.Offset());
+        SPDLOG_WARN("Failed to parse response json, error '{}'", extractor.error());
         return "";
     }
 
-    if (d.HasMember("status") && d["status"].IsObject())
+    if (str_iequals(status_code, "1"))
     {
-        const auto & status = d["status"];
-        if (status.HasMember("code") && status["code"].IsString() && str_iequals(status["code"].GetString(), "1"))
+        for (const auto & r : records)
         {
-            if (d.HasMember("records") && d["records"].IsArray())
+            if (!updateRecordCache(domain, is_v4, r.id, r.line_id))
             {
-                const auto & result = d["records"].GetArray();
-                for (const auto & r : result)
-                {
-                    std::string record_id, line_id;
-                    if (r.HasMember("id") && r["id"].IsString())
-                        record_id = r["id"].GetString();
-                    if (r.HasMember("line_id") && r["line_id"].IsString())
-                        line_id = r["line_id"].GetString();
-                    if (!updateRecordCache(domain, is_v4, record_id, line_id))
-                    {
-                        SPDLOG_WARN("Failed to update record cache for IP{} domain '{}'!", 
-                            (is_v4 ? "v4" : "v6"), domain);
-                        return "";
-                    }
-                    if (r.HasMember("value") && r["value"].IsString())
-                        return r["value"].GetString();
-                }
+                SPDLOG_WARN("Failed to update record cache for IP{} domain '{}'!",
+                    (is_v4 ? "v4" : "v6"), domain);
+                return "";
             }
+            if (r.has_value)
+                return r.value;
         }
     }
 
-    SPDLOG_WARN("Invalid response '{}'!", resp_data);
+    SPDLOG_WARN("Invalid response '{}'!", resp_head);
     return "";
 }
 
@@ -181,38 +214,45 @@ bool DnsServiceDnspod::setIp(const std::string & domain, const std::string & ip,
         return false;
     }
 
-    const auto & record_cache = getRecordCache(domain, is_v4);
-    if (nullptr == record_cache)
+    dnspod_record_cache record_cache;
     {
-        SPDLOG_WARN("No record cache found for IP{} domain '{}'!", (is_v4 ? "v4" : "v6"), domain);
-        return false;
+        std::lock_guard<std::mutex> lock(_cache_mutex);
+        const auto * cached = getRecordCache(domain, is_v4);
+        if (nullptr == cached)
+        {
+            SPDLOG_WARN("No record cache found for IP{} domain '{}'!", (is_v4 ? "v4" : "v6"), domain);
+            return false;
+        }
+        record_cache = *cached;
     }
 
     const auto & config = Config::getInstance();
 
     const auto sub_domain = get_sub_domain(domain);
-    const std::string req_url = fmt::format("{}{}", API_HOST, API_RECORD_DDNS);
+    const std::string req_url = API_RECORD_DDNS;
     const std::string req_body = fmt::format(
-        R"(login_token={}&domain={}&sub_domain={}&record_id={}&record_line_id={}&format=json&lang=en)",
-        _token, sub_domain.first, sub_domain.second, record_cache->record_id, record_cache->line_id
+        R"({}&domain={}&sub_domain={}&record_id={}&record_line_id={})",
+        _common_params, sub_domain.first, sub_domain.second, record_cache.record_id, record_cache.line_id
     );
 
     int resp_code = 0;
-    std::string resp_data;
-    const bool ret = http_req(req_url, req_body, config._http_timeout_ms, {}, resp_code, resp_data);
+    HttpArena arena;
+    std::string & resp_data = arena.buffer();
+    const bool ret = http_req(*_transport, req_url, req_body, config.getHttpTimeouts(_service_name),
+                              HttpHeaders(), "", _rate_limit_key, "dnspod.record_ddns", resp_code, resp_data);
     if (!ret || 200 != resp_code)
     {
         SPDLOG_WARN("Failed to request '{}', response code is {}, response is {}!", req_url, resp_code, resp_data);
-        return "";
+        return false;
     }
 
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.Parse(resp_data.c_str());
+    ArenaDocument & d = arena.document();
+    rapidjson::ParseResult ok = arena.parse();
     if (!ok)
     {
         SPDLOG_WARN("Failed to parse response json, error '{}' ({})", 
             rapidjson::GetParseError_En(ok.Code()), ok.Offset());
-        return "";
+        return false;
     }
 
     if (d.HasMember("status") && d["status"].IsObject())
@@ -236,6 +276,7 @@ bool DnsServiceDnspod::updateRecordCache(const std::string & domain, bool is_v4,
         return false;
     }
 
+    std::lock_guard<std::mutex> lock(_cache_mutex);
     auto found = std::find_if(_records_cache.begin(), _records_cache.end(),
                               [&domain, is_v4](const dnspod_record_cache & rc)
     {
@@ -1,9 +1,12 @@
 #ifndef PVE_DDNS_CLIENT_SRC_DNS_SERVICE_DNS_SERVICE_DNSPOD_H
 #define PVE_DDNS_CLIENT_SRC_DNS_SERVICE_DNS_SERVICE_DNSPOD_H
 
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include "dns_service.h"
+#include "../http/http_transport.h"
 
 /// DNSPod domain record cache
 typedef struct dnspod_record_cache_
@@ -18,12 +21,15 @@ typedef struct dnspod_record_cache_
 class DnsServiceDnspod : public IDnsService
 {
 public:
+    explicit DnsServiceDnspod(std::shared_ptr<IHttpTransport> transport) : _transport(std::move(transport)) {}
+
     const std::string & getServiceName() override;
     bool setCredentials(const std::string & cred_str) override;
     std::string getIpv4(const std::string & domain) override;
     std::string getIpv6(const std::string & domain) override;
     bool setIpv4(const std::string & domain, const std::string & ip) override;
     bool setIpv6(const std::string & domain, const std::string & ip) override;
+    bool isConcurrentWriteSafe() const override { return true; }
 
 protected:
     bool getVersion(std::string & version);
@@ -31,13 +37,22 @@ protected:
     bool setIp(const std::string & domain, const std::string & ip, bool is_v4);
     bool updateRecordCache(const std::string & domain, bool is_v4,
                            const std::string & record_id, const std::string & line_id);
+    /// Caller must hold _cache_mutex
     const dnspod_record_cache * getRecordCache(const std::string & domain, bool is_v4) const;
 
 private:
     /// Service name
     std::string _service_name = DNS_SERVICE_DNSPOD;
+    /// HTTP transport
+    std::shared_ptr<IHttpTransport> _transport;
     /// DNSPod token (id,token)
     std::string _token;
+    /// Prebuilt common request parameters (token and output format)
+    std::string _common_params;
+    /// Rate limiter bucket key
+    std::string _rate_limit_key;
+    /// Guards _records_cache
+    std::mutex _cache_mutex;
     /// Domain records cache
     std::vector<dnspod_record_cache> _records_cache;
 };
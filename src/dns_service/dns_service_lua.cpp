@@ -13,7 +13,8 @@
 #include "../lua_utils.h"
 
 
-DnsServiceLua::DnsServiceLua(DnsServiceLua && other) noexcept : _ls(other._ls)
+DnsServiceLua::DnsServiceLua(DnsServiceLua && other) noexcept
+    : _ls(other._ls), _transport(std::move(other._transport))
 {
     other._ls = nullptr;
 }
@@ -25,6 +26,7 @@ DnsServiceLua & DnsServiceLua::operator=(DnsServiceLua && other) noexcept
         lua_close(_ls);
         _ls = other._ls;
         other._ls = nullptr;
+        _transport = std::move(other._transport);
     }
     return *this;
 }
@@ -42,7 +44,7 @@ bool DnsServiceLua::loadModule(const std::string & module_name)
     file_name.append(".lua");
     mdl_path /= file_name;
 
-    _ls = lua_load_module("LUA DNS service", mdl_path.string());
+    _ls = lua_load_module("LUA DNS service", mdl_path.string(), _transport.get());
     if (nullptr == _ls)
     {
         SPDLOG_WARN("Failed to lua_load_module {}!", mdl_path.string());
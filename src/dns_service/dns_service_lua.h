@@ -1,7 +1,10 @@
 #ifndef PVE_DDNS_CLIENT_SRC_DNS_SERVICE_DNS_SERVICE_LUA_H
 #define PVE_DDNS_CLIENT_SRC_DNS_SERVICE_DNS_SERVICE_LUA_H
 
+#include <memory>
+
 #include "dns_service.h"
+#include "../http/http_transport.h"
 
 typedef struct lua_State lua_State;
 
@@ -9,7 +12,7 @@ typedef struct lua_State lua_State;
 class DnsServiceLua : public IDnsService
 {
 public:
-    DnsServiceLua() = default;
+    explicit DnsServiceLua(std::shared_ptr<IHttpTransport> transport) : _transport(std::move(transport)) {}
     DnsServiceLua(const DnsServiceLua & other) = delete;
     DnsServiceLua & operator=(const DnsServiceLua & other) = delete;
     DnsServiceLua(DnsServiceLua && other) noexcept;
@@ -33,6 +36,8 @@ private:
     /// Service name
     std::string _service_name = DNS_SERVICE_LUA;
     lua_State * _ls;
+    /// HTTP transport
+    std::shared_ptr<IHttpTransport> _transport;
 };
 
 #endif //PVE_DDNS_CLIENT_SRC_DNS_SERVICE_DNS_SERVICE_LUA_H
@@ -7,10 +7,12 @@
 
 #include "../utils.h"
 #include "../config.h"
+#include "../http/http_arena.h"
+#include "../http/http_headers.h"
+#include "../http/http_rate_limiter.h"
 
-static constexpr const char * API_HOST = "https://api.porkbun.com/api/json/v3/";
-static constexpr const char * API_RETRIEVE = "dns/retrieveByNameType/{}/{}/{}";
-static constexpr const char * API_EDIT = "dns/editByNameType/{}/{}/{}";
+static constexpr const char * API_RETRIEVE = "https://api.porkbun.com/api/json/v3/dns/retrieveByNameType/{}/{}/{}";
+static constexpr const char * API_EDIT = "https://api.porkbun.com/api/json/v3/dns/editByNameType/{}/{}/{}";
 
 const std::string & DnsServicePorkbun::getServiceName()
 {
@@ -32,6 +34,9 @@ bool DnsServicePorkbun::setCredentials(const std::string & cred_str)
     }
     _api_key = cred_str.substr(0, comma_pos);
     _api_secret = cred_str.substr(comma_pos + 1);
+    _auth_fields = fmt::format(R"("secretapikey":"{}","apikey":"{}")", _api_secret, _api_key);
+    _auth_body = fmt::format("{{{}}}", _auth_fields);
+    _rate_limit_key = HttpRateLimiter::getInstance().getKey(_service_name, cred_str);
 
     return true;
 }
@@ -65,21 +70,22 @@ std::string DnsServicePorkbun::getIp(const std::string & domain, bool is_v4)
     }
 
     const auto sub_domain = get_sub_domain(domain);
-    const std::string api_part = fmt::format(API_RETRIEVE, sub_domain.first, is_v4 ? "A" : "AAAA", sub_domain.second);
-    const std::string req_url = fmt::format("{}{}", API_HOST, api_part);
-    const std::string req_body = fmt::format(R"({{"secretapikey":"{}","apikey":"{}"}})", _api_secret, _api_key);
+    const std::string req_url = fmt::format(API_RETRIEVE, sub_domain.first, is_v4 ? "A" : "AAAA", sub_domain.second);
+    const std::string & req_body = _auth_body;
 
     int resp_code = 0;
-    std::string resp_data;
-    const bool ret = http_req(req_url, req_body, Config::getInstance()._http_timeout_ms, {}, resp_code, resp_data);
+    HttpArena arena;
+    std::string & resp_data = arena.buffer();
+    const bool ret = http_req(*_transport, req_url, req_body, Config::getInstance().getHttpTimeouts(_service_name),
+                              HttpHeaders(), "", _rate_limit_key, "porkbun.retrieve_record", resp_code, resp_data);
     if (!ret || 200 != resp_code)
     {
         SPDLOG_WARN("Failed to request '{}', response code is {}, response is {}!", req_url, resp_code, resp_data);
         return "";
     }
 
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.Parse(resp_data.c_str());
+    ArenaDocument & d = arena.document();
+    rapidjson::ParseResult ok = arena.parse();
     if (!ok)
     {
         SPDLOG_WARN("Failed to parse response json, error '{}' ({})", 
@@ -112,22 +118,22 @@ bool DnsServicePorkbun::setIp(const std::string & domain, const std::string & ip
     }
 
     const auto sub_domain = get_sub_domain(domain);
-    const std::string api_part = fmt::format(API_EDIT, sub_domain.first, is_v4 ? "A" : "AAAA", sub_domain.second);
-    const std::string req_url = fmt::format("{}{}", API_HOST, api_part);
-    const std::string req_body = fmt::format(R"({{"secretapikey":"{}","apikey":"{}","content":"{}"}})",
-                                             _api_secret, _api_key, ip);
+    const std::string req_url = fmt::format(API_EDIT, sub_domain.first, is_v4 ? "A" : "AAAA", sub_domain.second);
+    const std::string req_body = fmt::format(R"({{{},"content":"{}"}})", _auth_fields, ip);
 
     int resp_code = 0;
-    std::string resp_data;
-    const bool ret = http_req(req_url, req_body, Config::getInstance()._http_timeout_ms, {}, resp_code, resp_data);
+    HttpArena arena;
+    std::string & resp_data = arena.buffer();
+    const bool ret = http_req(*_transport, req_url, req_body, Config::getInstance().getHttpTimeouts(_service_name),
+                              HttpHeaders(), "", _rate_limit_key, "porkbun.edit_record", resp_code, resp_data);
     if (!ret || 200 != resp_code)
     {
         SPDLOG_WARN("Failed to request '{}', response code is {}, response is {}!", req_url, resp_code, resp_data);
         return false;
     }
 
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.Parse(resp_data.c_str());
+    ArenaDocument & d = arena.document();
+    rapidjson::ParseResult ok = arena.parse();
     if (!ok)
     {
         SPDLOG_WARN("Failed to parse response json, error '{}' ({})", 
@@ -1,18 +1,24 @@
 #ifndef PVE_DDNS_CLIENT_SRC_DNS_SERVICE_DNS_SERVICE_PORKBUN_H
 #define PVE_DDNS_CLIENT_SRC_DNS_SERVICE_DNS_SERVICE_PORKBUN_H
 
+#include <memory>
+
 #include "dns_service.h"
+#include "../http/http_transport.h"
 
 /// Porkbun DNS service implementation
 class DnsServicePorkbun : public IDnsService
 {
 public:
+    explicit DnsServicePorkbun(std::shared_ptr<IHttpTransport> transport) : _transport(std::move(transport)) {}
+
     const std::string & getServiceName() override;
     bool setCredentials(const std::string & cred_str) override;
     std::string getIpv4(const std::string & domain) override;
     std::string getIpv6(const std::string & domain) override;
     bool setIpv4(const std::string & domain, const std::string & ip) override;
     bool setIpv6(const std::string & domain, const std::string & ip) override;
+    bool isConcurrentWriteSafe() const override { return true; }
 
 protected:
     std::string getIp(const std::string & domain, bool is_v4);
@@ -21,10 +27,18 @@ protected:
 private:
     /// Service name
     std::string _service_name = DNS_SERVICE_PORKBUN;
+    /// HTTP transport
+    std::shared_ptr<IHttpTransport> _transport;
     /// Porkbun API key
     std::string _api_key;
     /// Porkbun secret key
     std::string _api_secret;
+    /// Prebuilt credential fields of request body
+    std::string _auth_fields;
+    /// Prebuilt request body with only credentials
+    std::string _auth_body;
+    /// Rate limiter bucket key
+    std::string _rate_limit_key;
 };
 
 #endif //PVE_DDNS_CLIENT_SRC_DNS_SERVICE_DNS_SERVICE_PORKBUN_H
@@ -0,0 +1,64 @@
+#include "http_arena.h"
+
+// Pre-allocated block for document values
+static constexpr size_t VALUE_BLOCK_SIZE = 64 * 1024;
+// Pre-allocated block for parse stack
+static constexpr size_t STACK_BLOCK_SIZE = 16 * 1024;
+// Parse stack initial capacity
+static constexpr size_t STACK_CAPACITY = 4 * 1024;
+
+// Arena storage
+struct HttpArena::storage
+{
+    alignas(8) char value_block[VALUE_BLOCK_SIZE];
+    alignas(8) char stack_block[STACK_BLOCK_SIZE];
+    rapidjson::MemoryPoolAllocator<> value_allocator{ value_block, sizeof(value_block) };
+    rapidjson::MemoryPoolAllocator<> stack_allocator{ stack_block, sizeof(stack_block) };
+    std::string buffer;
+    bool leased = false;
+};
+
+thread_local std::unique_ptr<HttpArena::storage> HttpArena::_thread_storage;
+
+HttpArena::storage * HttpArena::acquire()
+{
+    if (nullptr == _thread_storage)
+        _thread_storage = std::make_unique<storage>();
+    if (!_thread_storage->leased)
+    {
+        _thread_storage->leased = true;
+        return _thread_storage.get();
+    }
+
+    _own = std::make_unique<storage>();
+    _own->leased = true;
+    return _own.get();
+}
+
+HttpArena::HttpArena() :
+    _storage(acquire()),
+    _doc(&_storage->value_allocator, STACK_CAPACITY, &_storage->stack_allocator)
+{
+    _storage->buffer.clear();
+}
+
+HttpArena::~HttpArena()
+{
+    // Document has to release its stack before allocators are reset, pooled allocators never free
+    // individual blocks so resetting them is enough to drop all values.
+    _doc.SetNull();
+    _storage->value_allocator.Clear();
+    _storage->stack_allocator.Clear();
+    _storage->buffer.clear();
+    _storage->leased = false;
+}
+
+std::string & HttpArena::buffer()
+{
+    return _storage->buffer;
+}
+
+rapidjson::ParseResult HttpArena::parse()
+{
+    return _doc.ParseInsitu(&_storage->buffer[0]);
+}
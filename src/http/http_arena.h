@@ -0,0 +1,54 @@
+#ifndef PVE_DDNS_CLIENT_SRC_HTTP_HTTP_ARENA_H
+#define PVE_DDNS_CLIENT_SRC_HTTP_HTTP_ARENA_H
+
+#include <memory>
+#include <string>
+
+#include "rapidjson/document.h"
+
+/// rapidjson document with pooled allocators for both values and the parse stack
+typedef rapidjson::GenericDocument<rapidjson::UTF8<>, rapidjson::MemoryPoolAllocator<>,
+                                   rapidjson::MemoryPoolAllocator<>> ArenaDocument;
+
+/// \brief Scoped lease of the per-thread arena for an HTTP response body and the JSON document parsed from it
+///
+/// The body buffer keeps its capacity and the allocators reuse their pre-allocated blocks between requests,
+/// so in steady state the request path does not touch the heap. A nested lease on the same thread falls
+/// back to private storage.
+class HttpArena
+{
+public:
+    HttpArena();
+    ~HttpArena();
+    HttpArena(HttpArena const &) = delete;
+    HttpArena & operator=(HttpArena const &) = delete;
+
+    /// \brief Get response body buffer (empty, capacity retained from previous requests)
+    /// \return Buffer to pass to http_req as response data
+    std::string & buffer();
+
+    /// \brief Parse body buffer in-situ, strings of the document point into (and modify) the buffer
+    /// \return Parse result
+    rapidjson::ParseResult parse();
+
+    /// \brief Get document parsed by parse()
+    /// \return Document
+    ArenaDocument & document() { return _doc; }
+
+private:
+    struct storage;
+
+    storage * acquire();
+
+    /// Per-thread storage
+    static thread_local std::unique_ptr<storage> _thread_storage;
+
+    /// Private storage when per-thread one is already leased
+    std::unique_ptr<storage> _own;
+    /// Leased storage
+    storage * _storage;
+    /// Document using storage allocators
+    ArenaDocument _doc;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_HTTP_HTTP_ARENA_H
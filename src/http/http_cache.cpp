@@ -0,0 +1,77 @@
+#include "http_cache.h"
+
+#include <functional>
+
+#include "fmt/format.h"
+
+#include "../metrics.h"
+
+std::string HttpCache::getKey(const std::string & url, const std::string & req_data, const std::string & identity)
+{
+    // Body and identity may carry credentials, only their hash is kept
+    std::hash<std::string> str_hash;
+    return fmt::format("{}#{:x}", url, str_hash(fmt::format("{}\n{}", req_data, identity)));
+}
+
+std::vector<std::string> HttpCache::getConditionalHeaders(const std::string & key) const
+{
+    std::vector<std::string> headers;
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto found = _entries.find(key);
+    if (_entries.end() == found || !found->second.has_values)
+        return headers;
+
+    if (!found->second.etag.empty())
+        headers.emplace_back(fmt::format("If-None-Match: {}", found->second.etag));
+    if (!found->second.last_modified.empty())
+        headers.emplace_back(fmt::format("If-Modified-Since: {}", found->second.last_modified));
+    return headers;
+}
+
+void HttpCache::setValidators(const std::string & key, const std::string & etag, const std::string & last_modified)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (etag.empty() && last_modified.empty())
+    {
+        // Server does not support conditional requests for this resource
+        _entries.erase(key);
+        return;
+    }
+
+    entry & e = _entries[key];
+    e.etag = etag;
+    e.last_modified = last_modified;
+    e.values.clear();
+    e.has_values = false;
+}
+
+void HttpCache::update(const std::string & key, std::vector<std::string> values)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto found = _entries.find(key);
+    if (_entries.end() == found)
+        return;
+
+    found->second.values = std::move(values);
+    found->second.has_values = true;
+}
+
+bool HttpCache::get(const std::string & key, std::vector<std::string> & out_values) const
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const auto found = _entries.find(key);
+        if (_entries.end() == found || !found->second.has_values)
+            return false;
+        out_values = found->second.values;
+    }
+
+    Metrics::getInstance().add("http_cache_hits_total");
+    return true;
+}
+
+void HttpCache::invalidate(const std::string & key)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.erase(key);
+}
@@ -0,0 +1,74 @@
+#ifndef PVE_DDNS_CLIENT_SRC_HTTP_HTTP_CACHE_H
+#define PVE_DDNS_CLIENT_SRC_HTTP_HTTP_CACHE_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Conditional request cache of read endpoints. Only validators (ETag / Last-Modified) and the values a caller
+/// extracted from the last 200 response are kept, so a 304 response needs no body and no JSON parsing.
+class HttpCache
+{
+public:
+    static HttpCache & getInstance()
+    {
+        static HttpCache instance;
+        return instance;
+    }
+
+    /// \brief Get cache key of a request
+    /// \param url Request URL
+    /// \param req_data Request body
+    /// \param identity Auth identity (token, credentials) the response depends on
+    /// \return Key to set as request cache_key
+    static std::string getKey(const std::string & url, const std::string & req_data, const std::string & identity);
+
+    /// \brief Get conditional request headers of an entry
+    /// \param key Cache key
+    /// \return If-None-Match / If-Modified-Since headers, empty if entry holds no extracted values
+    std::vector<std::string> getConditionalHeaders(const std::string & key) const;
+
+    /// \brief Store validators of a 200 response, previously extracted values are dropped
+    /// \param key Cache key
+    /// \param etag ETag response header
+    /// \param last_modified Last-Modified response header
+    void setValidators(const std::string & key, const std::string & etag, const std::string & last_modified);
+
+    /// \brief Store values extracted from the response the current validators belong to
+    /// \param key Cache key
+    /// \param values Extracted values
+    void update(const std::string & key, std::vector<std::string> values);
+
+    /// \brief Get values extracted from the last 200 response, on 304
+    /// \param key Cache key
+    /// \param out_values Extracted values
+    /// \return If entry holds extracted values
+    bool get(const std::string & key, std::vector<std::string> & out_values) const;
+
+    /// \brief Drop entry
+    /// \param key Cache key
+    void invalidate(const std::string & key);
+
+private:
+    /// Cache entry
+    typedef struct entry_
+    {
+        std::string etag;
+        std::string last_modified;
+        /// Values extracted from the response, only valid once set by update
+        std::vector<std::string> values;
+        bool has_values = false;
+    } entry;
+
+    HttpCache() = default;
+    HttpCache(HttpCache const &) = delete;
+    HttpCache & operator=(HttpCache const &) = delete;
+
+    /// Guards _entries
+    mutable std::mutex _mutex;
+    /// Entries by key
+    std::unordered_map<std::string, entry> _entries;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_HTTP_HTTP_CACHE_H
@@ -0,0 +1,143 @@
+#include "http_cassette.h"
+
+#include <cstdint>
+#include <sstream>
+
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+
+// First line of a cassette file, version 2 keys bodies by FNV-1a
+static constexpr const char * CASSETTE_MAGIC = "PVE-DDNS-CASSETTE 2";
+
+// 64-bit FNV-1a, fixed so cassettes recorded on one platform replay on any other (std::hash is
+// implementation-defined)
+static uint64_t fnv1a_64(const std::string & data)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char c : data)
+    {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+bool HttpCassette::open(const CassetteMode mode, const std::string & file_path, const double latency_scale)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _mode = CassetteMode::Off;
+    if (_file.is_open())
+        _file.close();
+    _tracks.clear();
+    _latency_scale = latency_scale < 0 ? 0 : latency_scale;
+
+    if (CassetteMode::Record == mode)
+    {
+        _file.open(file_path, std::ios::binary | std::ios::trunc);
+        if (!_file.is_open())
+        {
+            SPDLOG_WARN("Failed to open cassette file '{}' for recording!", file_path);
+            return false;
+        }
+        _file << CASSETTE_MAGIC << '\n';
+        SPDLOG_INFO("Recording HTTP traffic to cassette '{}'.", file_path);
+    }
+    else if (CassetteMode::Replay == mode)
+    {
+        if (!load(file_path))
+            return false;
+        SPDLOG_INFO("Replaying HTTP traffic from cassette '{}' ({} requests), latency scale {}.",
+                    file_path, _tracks.size(), _latency_scale);
+    }
+    _mode = mode;
+    return true;
+}
+
+std::string HttpCassette::getKey(const http_request & req)
+{
+    // Same defaults the engine applies, an empty method is GET or POST depending on body
+    const std::string & method = !req.method.empty() ? req.method : (req.body.empty() ? "get" : "post");
+    return fmt::format("{} {} {:016x}", method, req.url, fnv1a_64(req.body));
+}
+
+void HttpCassette::record(const http_request & req, const cassette_entry & entry)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (CassetteMode::Record != _mode || !_file.is_open())
+        return;
+
+    // Header line with field lengths, then raw fields so bodies need no escaping
+    _file << getKey(req) << '\t' << static_cast<int>(entry.curl_code) << '\t' << entry.code << '\t'
+          << entry.latency.count() << '\t' << entry.error.length() << '\t' << entry.etag.length() << '\t'
+          << entry.last_modified.length() << '\t' << entry.body.length() << '\n'
+          << entry.error << entry.etag << entry.last_modified << entry.body << '\n';
+    _file.flush();
+}
+
+bool HttpCassette::replay(const http_request & req, cassette_entry & out_entry)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto found = _tracks.find(getKey(req));
+    if (_tracks.end() == found || found->second.entries.empty())
+        return false;
+
+    track & t = found->second;
+    out_entry = t.entries[t.next];
+    if (t.next + 1 < t.entries.size())
+        ++t.next;
+    out_entry.latency = std::chrono::microseconds(
+        static_cast<long long>(static_cast<double>(out_entry.latency.count()) * _latency_scale));
+    return true;
+}
+
+bool HttpCassette::load(const std::string & file_path)
+{
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open())
+    {
+        SPDLOG_WARN("Failed to open cassette file '{}' for replay!", file_path);
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(file, line) || CASSETTE_MAGIC != line)
+    {
+        SPDLOG_WARN("Invalid cassette file '{}'!", file_path);
+        return false;
+    }
+
+    // Read a length-prefixed field
+    const auto read_field = [&file](const size_t len, std::string & out)
+    {
+        out.resize(len);
+        return len == 0 || static_cast<bool>(file.read(&out[0], static_cast<std::streamsize>(len)));
+    };
+
+    size_t count = 0;
+    while (std::getline(file, line))
+    {
+        std::istringstream header(line);
+        std::string key;
+        std::getline(header, key, '\t');
+
+        cassette_entry entry;
+        int curl_code = 0;
+        long long latency_us = 0;
+        size_t error_len = 0, etag_len = 0, last_modified_len = 0, body_len = 0;
+        if (!(header >> curl_code >> entry.code >> latency_us >> error_len >> etag_len >> last_modified_len
+              >> body_len)
+            || !read_field(error_len, entry.error) || !read_field(etag_len, entry.etag)
+            || !read_field(last_modified_len, entry.last_modified) || !read_field(body_len, entry.body)
+            || '\n' != file.get())
+        {
+            SPDLOG_WARN("Corrupted cassette file '{}' after {} entries!", file_path, count);
+            return false;
+        }
+        entry.curl_code = static_cast<CURLcode>(curl_code);
+        entry.latency = std::chrono::microseconds(latency_us);
+        _tracks[key].entries.emplace_back(std::move(entry));
+        ++count;
+    }
+
+    return true;
+}
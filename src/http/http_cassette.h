@@ -0,0 +1,99 @@
+#ifndef PVE_DDNS_CLIENT_SRC_HTTP_HTTP_CASSETTE_H
+#define PVE_DDNS_CLIENT_SRC_HTTP_HTTP_CASSETTE_H
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "http_client.h"
+
+/// Cassette mode
+enum class CassetteMode
+{
+    /// Requests go to the network
+    Off = 0,
+    /// Requests go to the network, each request/response pair is appended to the cassette
+    Record = 1,
+    /// Requests are served from the cassette, nothing is sent
+    Replay = 2,
+};
+
+/// Recorded response of one request
+typedef struct cassette_entry_
+{
+    CURLcode curl_code = CURLE_OK;
+    int code = 0;
+    /// Latency from submission to completion, retries included
+    std::chrono::microseconds latency{ 0 };
+    std::string error;
+    std::string etag;
+    std::string last_modified;
+    std::string body;
+} cassette_entry;
+
+/// On-disk record of request/response pairs for offline replay of whole update cycles.
+/// Requests are matched by method, URL and a hash of the body, so credentials in headers and bodies are not
+/// stored. Recorded responses of a request are replayed in order, the last one repeats once they run out.
+class HttpCassette
+{
+public:
+    static HttpCassette & getInstance()
+    {
+        static HttpCassette instance;
+        return instance;
+    }
+
+    /// \brief Open cassette file
+    /// \param mode Cassette mode, Off closes it
+    /// \param file_path Cassette file, truncated when recording
+    /// \param latency_scale Replayed latencies are multiplied by it, 0 replays without delay
+    /// \return Operation result
+    bool open(CassetteMode mode, const std::string & file_path, double latency_scale);
+
+    /// \brief Get cassette mode
+    /// \return Cassette mode
+    CassetteMode getMode() const { return _mode; }
+
+    /// \brief Append a request/response pair
+    /// \param req Request
+    /// \param entry Response
+    void record(const http_request & req, const cassette_entry & entry);
+
+    /// \brief Get next recorded response of a request
+    /// \param req Request
+    /// \param out_entry Response, its latency already scaled
+    /// \return If the request was recorded
+    bool replay(const http_request & req, cassette_entry & out_entry);
+
+private:
+    /// Recorded responses of one request
+    typedef struct track_
+    {
+        std::vector<cassette_entry> entries;
+        size_t next = 0;
+    } track;
+
+    HttpCassette() = default;
+    HttpCassette(HttpCassette const &) = delete;
+    HttpCassette & operator=(HttpCassette const &) = delete;
+
+    static std::string getKey(const http_request & req);
+    bool load(const std::string & file_path);
+
+    /// Cassette mode
+    std::atomic<CassetteMode> _mode{ CassetteMode::Off };
+    /// Latency scale of replay
+    double _latency_scale = 1.0;
+    /// Guards _file and _tracks
+    std::mutex _mutex;
+    /// Cassette file being recorded
+    std::ofstream _file;
+    /// Replayed responses by request key
+    std::unordered_map<std::string, track> _tracks;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_HTTP_HTTP_CASSETTE_H
@@ -0,0 +1,149 @@
+#include "http_circuit_breaker.h"
+
+#include "curl/curl.h"
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+
+#include "../config.h"
+#include "../metrics.h"
+
+static const char * get_state_name(const CircuitState state)
+{
+    switch (state)
+    {
+        case CircuitState::Closed:
+            return "closed";
+        case CircuitState::Open:
+            return "open";
+        case CircuitState::HalfOpen:
+            return "half-open";
+    }
+    return "unknown";
+}
+
+std::string HttpCircuitBreaker::getEndpoint(const std::string & url)
+{
+    CURLU * h = curl_url();
+    if (nullptr == h)
+    {
+        SPDLOG_ERROR("Failed to curl_url!");
+        return "";
+    }
+
+    std::string endpoint;
+    char * scheme = nullptr;
+    char * host = nullptr;
+    char * port = nullptr;
+    if (CURLUE_OK == curl_url_set(h, CURLUPART_URL, url.c_str(), 0) &&
+        CURLUE_OK == curl_url_get(h, CURLUPART_SCHEME, &scheme, 0) &&
+        CURLUE_OK == curl_url_get(h, CURLUPART_HOST, &host, 0) &&
+        CURLUE_OK == curl_url_get(h, CURLUPART_PORT, &port, CURLU_DEFAULT_PORT))
+        endpoint = fmt::format("{}://{}:{}", scheme, host, port);
+    else
+        SPDLOG_WARN("Failed to parse url '{}'!", url);
+
+    curl_free(scheme);
+    curl_free(host);
+    curl_free(port);
+    curl_url_cleanup(h);
+
+    return endpoint;
+}
+
+bool HttpCircuitBreaker::allow(const std::string & endpoint, bool & is_probe)
+{
+    is_probe = false;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto & c = _circuits[endpoint];
+    switch (c.state)
+    {
+        case CircuitState::Closed:
+            return true;
+        case CircuitState::Open:
+            if (std::chrono::steady_clock::now() < c.open_until)
+                break;
+            transition(endpoint, c, CircuitState::HalfOpen);
+            // fall through
+        case CircuitState::HalfOpen:
+            if (c.probing)
+                break;
+            c.probing = true;
+            is_probe = true;
+            return true;
+    }
+
+    Metrics::getInstance().add(fmt::format("http_circuit_rejected_total{{endpoint=\"{}\"}}", endpoint));
+    return false;
+}
+
+void HttpCircuitBreaker::record(const std::string & endpoint, const bool success)
+{
+    const auto & config = Config::getInstance()._http_circuit_breaker;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto & c = _circuits[endpoint];
+    if (CircuitState::HalfOpen == c.state)
+    {
+        c.probing = false;
+        if (success)
+            transition(endpoint, c, CircuitState::Closed);
+        else
+        {
+            c.open_until = std::chrono::steady_clock::now() + config.open_duration;
+            transition(endpoint, c, CircuitState::Open);
+        }
+        return;
+    }
+    // Late outcome of a request allowed before the circuit opened
+    if (CircuitState::Open == c.state)
+        return;
+
+    c.outcomes.push_back(!success);
+    if (!success)
+        ++c.failures;
+    while (c.outcomes.size() > static_cast<size_t>(config.window))
+    {
+        if (c.outcomes.front())
+            --c.failures;
+        c.outcomes.pop_front();
+    }
+
+    const auto calls = static_cast<int>(c.outcomes.size());
+    if (calls >= config.min_calls && c.failures >= config.failure_rate * calls)
+    {
+        SPDLOG_WARN("Endpoint '{}' failed {} of last {} calls!", endpoint, c.failures, calls);
+        c.open_until = std::chrono::steady_clock::now() + config.open_duration;
+        transition(endpoint, c, CircuitState::Open);
+    }
+}
+
+void HttpCircuitBreaker::cancelProbe(const std::string & endpoint)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto found = _circuits.find(endpoint);
+    if (_circuits.end() != found && CircuitState::HalfOpen == found->second.state)
+        found->second.probing = false;
+}
+
+CircuitState HttpCircuitBreaker::getState(const std::string & endpoint) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto found = _circuits.find(endpoint);
+    return _circuits.end() != found ? found->second.state : CircuitState::Closed;
+}
+
+void HttpCircuitBreaker::transition(const std::string & endpoint, circuit & c, const CircuitState state)
+{
+    if (CircuitState::Open == state)
+        SPDLOG_WARN("Circuit of '{}' {}, requests fail fast for {} ms!", endpoint, get_state_name(state),
+                    Config::getInstance()._http_circuit_breaker.open_duration.count());
+    else
+        SPDLOG_INFO("Circuit of '{}' {}.", endpoint, get_state_name(state));
+
+    c.state = state;
+    c.outcomes.clear();
+    c.failures = 0;
+    Metrics::getInstance().set(fmt::format("http_circuit_state{{endpoint=\"{}\"}}", endpoint),
+                               static_cast<double>(state));
+}
@@ -0,0 +1,84 @@
+#ifndef PVE_DDNS_CLIENT_SRC_HTTP_HTTP_CIRCUIT_BREAKER_H
+#define PVE_DDNS_CLIENT_SRC_HTTP_HTTP_CIRCUIT_BREAKER_H
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/// Circuit state
+enum class CircuitState
+{
+    /// Requests pass, outcomes are tracked
+    Closed = 0,
+    /// Requests fail immediately until open duration elapses
+    Open = 1,
+    /// One probe request is let through, its outcome closes or re-opens the circuit
+    HalfOpen = 2,
+};
+
+/// Circuit breaker per remote endpoint (scheme://host:port)
+class HttpCircuitBreaker
+{
+public:
+    static HttpCircuitBreaker & getInstance()
+    {
+        static HttpCircuitBreaker instance;
+        return instance;
+    }
+
+    /// \brief Get endpoint key (scheme://host:port) of given url
+    /// \param url URL
+    /// \return Endpoint key or empty string if url is invalid
+    static std::string getEndpoint(const std::string & url);
+
+    /// \brief Check if a request to endpoint may be sent
+    /// \param endpoint Endpoint key
+    /// \param is_probe Set if the request is the half-open probe and has to be kept cheap
+    /// \return If allowed, each allowed request must be followed by record()
+    bool allow(const std::string & endpoint, bool & is_probe);
+
+    /// \brief Record outcome of an allowed request
+    /// \param endpoint Endpoint key
+    /// \param success If endpoint responded (any non-5xx response)
+    void record(const std::string & endpoint, bool success);
+
+    /// \brief Release the half-open probe of endpoint without an outcome, e.g. when it ran out of cycle budget
+    /// or was aborted, so the next request becomes the probe. Circuit state is kept.
+    /// \param endpoint Endpoint key
+    void cancelProbe(const std::string & endpoint);
+
+    /// \brief Get circuit state of endpoint
+    /// \param endpoint Endpoint key
+    /// \return Circuit state
+    CircuitState getState(const std::string & endpoint) const;
+
+private:
+    /// Circuit of one endpoint
+    typedef struct circuit_
+    {
+        CircuitState state = CircuitState::Closed;
+        /// Recent outcomes, true for failure
+        std::deque<bool> outcomes;
+        /// Failures in outcomes
+        int failures = 0;
+        /// When open circuit turns half-open
+        std::chrono::steady_clock::time_point open_until;
+        /// Half-open probe in flight
+        bool probing = false;
+    } circuit;
+
+    HttpCircuitBreaker() = default;
+    HttpCircuitBreaker(HttpCircuitBreaker const &) = delete;
+    HttpCircuitBreaker & operator=(HttpCircuitBreaker const &) = delete;
+
+    static void transition(const std::string & endpoint, circuit & c, CircuitState state);
+
+    /// Guards _circuits
+    mutable std::mutex _mutex;
+    /// Circuits by endpoint
+    std::unordered_map<std::string, circuit> _circuits;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_HTTP_HTTP_CIRCUIT_BREAKER_H
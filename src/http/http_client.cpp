@@ -0,0 +1,1022 @@
+#include "http_client.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+
+#include "../config.h"
+#include "http_handle_pool.h"
+#include "http_share.h"
+#include "http_retry.h"
+#include "http_rate_limiter.h"
+#include "http_circuit_breaker.h"
+#include "http_cache.h"
+#include "http_stats.h"
+#include "http_cassette.h"
+#include "http_fault_injector.h"
+#include "../metrics.h"
+
+// In-flight transfer
+struct HttpClient::transfer
+{
+    http_request req;
+    http_response resp;
+    http_callback cb;
+    CURL * curl = nullptr;
+    curl_slist * headers = nullptr;
+    char errbuf[CURL_ERROR_SIZE] = {};
+    /// First body chunk of current attempt received
+    bool body_started = false;
+    /// Streamed body is passed to on_data (2xx response)
+    bool stream_data = false;
+    /// Body was passed to on_data, such transfer can not be retried
+    bool data_delivered = false;
+    /// Retry policy of the endpoint
+    http_retry_policy retry;
+    /// Attempts made so far
+    int attempt = 0;
+    /// Rate limiter token taken for current attempt
+    bool admitted = false;
+    /// Circuit breaker endpoint (scheme://host:port)
+    std::string endpoint;
+    /// Current attempt is the half-open circuit probe
+    bool probe = false;
+    /// Start of current attempt
+    std::chrono::steady_clock::time_point started;
+    /// Phase whose deadline aborted current attempt
+    const char * timed_out_phase = nullptr;
+    /// Total timeout of current attempt was cut to the remaining cycle budget or request deadline
+    bool budget_capped = false;
+    /// Body bytes of current attempt after content decoding
+    curl_off_t decoded_bytes = 0;
+    /// Response is served from cassette, held in resp until its recorded latency elapsed
+    bool replayed = false;
+    /// Recorded latency of replayed response, already scaled
+    std::chrono::microseconds replay_latency{ 0 };
+    /// Fault injection was drawn for current attempt
+    bool fault_drawn = false;
+    /// Outcome injected into current attempt
+    HttpFault fault = HttpFault::None;
+};
+
+// Body prefix kept for diagnostics when response is streamed
+static constexpr size_t STREAMED_BODY_PREFIX_LEN = 512;
+
+HttpClient::HttpClient() = default;
+
+HttpClient::~HttpClient()
+{
+    stop();
+}
+
+bool HttpClient::start()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return startLocked();
+}
+
+bool HttpClient::startLocked()
+{
+    if (_running)
+        return true;
+
+    if (_thread.joinable())
+    {
+        SPDLOG_WARN("HTTP engine thread is stopping!");
+        return false;
+    }
+
+    _multi = curl_multi_init();
+    if (nullptr == _multi)
+    {
+        SPDLOG_ERROR("Failed to curl_multi_init!");
+        return false;
+    }
+
+    const auto & cfg = Config::getInstance();
+    _http2 = false;
+    if (cfg._http2)
+    {
+        const curl_version_info_data * ver = curl_version_info(CURLVERSION_NOW);
+        if (nullptr != ver && (ver->features & CURL_VERSION_HTTP2))
+        {
+            _http2 = true;
+            // Concurrent requests to the same host share one connection as separate streams
+            curl_multi_setopt(_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#if LIBCURL_VERSION_NUM >= 0x074300
+            curl_multi_setopt(_multi, CURLMOPT_MAX_CONCURRENT_STREAMS, cfg._http2_max_streams);
+#endif
+            SPDLOG_INFO("HTTP/2 multiplexing enabled.");
+        }
+        else
+            SPDLOG_WARN("HTTP/2 enabled in config but libcurl is built without HTTP/2 support, using HTTP/1.1!");
+    }
+    _connect_to = HttpHeaders(cfg._http_connect_to);
+    for (const auto & item : cfg._http_connect_to)
+        SPDLOG_INFO("HTTP connections redirected: {}.", item);
+    _compression = false;
+    if (cfg._http_compression)
+    {
+        const curl_version_info_data * ver = curl_version_info(CURLVERSION_NOW);
+        if (nullptr != ver && (ver->features & (CURL_VERSION_LIBZ | CURL_VERSION_BROTLI)))
+        {
+            _compression = true;
+            SPDLOG_INFO("Compressed responses enabled ({}{}).",
+                        (ver->features & CURL_VERSION_LIBZ) ? "gzip deflate" : "",
+                        (ver->features & CURL_VERSION_BROTLI) ? " br" : "");
+        }
+        else
+            SPDLOG_WARN("Compression enabled in config but libcurl is built without zlib/brotli, not negotiated!");
+    }
+    if (HttpFaultInjector::isEnabled())
+    {
+        const auto & fault = cfg._http_fault_injection;
+        SPDLOG_INFO("HTTP fault injection enabled, latency {}ms, jitter {}ms, error rate {}, HTTP error rate {}.",
+                    fault.latency.count(), fault.jitter.count(), fault.error_rate, fault.http_error_rate);
+    }
+
+    _running = true;
+    _thread = std::thread(&HttpClient::run, this);
+    SPDLOG_DEBUG("HTTP engine started.");
+
+    return true;
+}
+
+void HttpClient::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_running)
+            return;
+        _running = false;
+        curl_multi_wakeup(_multi);
+    }
+
+    if (_thread.joinable())
+        _thread.join();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    curl_multi_cleanup(_multi);
+    _multi = nullptr;
+    SPDLOG_DEBUG("HTTP engine stopped.");
+}
+
+void HttpClient::request(http_request req, http_callback cb)
+{
+    auto t = std::make_unique<transfer>();
+    t->req = std::move(req);
+    t->cb = std::move(cb);
+
+    const CassetteMode cassette_mode = HttpCassette::getInstance().getMode();
+    if (CassetteMode::Record == cassette_mode)
+        recordToCassette(*t);
+    else if (CassetteMode::Replay == cassette_mode && !replayFromCassette(*t))
+    {
+        SPDLOG_WARN("No recorded response of '{}' in cassette!", t->req.url);
+        t->resp.curl_code = CURLE_COULDNT_CONNECT;
+        t->resp.error = "No recorded response in cassette";
+        complete(*t);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (startLocked())
+        {
+            _pending.emplace_back(std::move(t));
+            curl_multi_wakeup(_multi);
+            return;
+        }
+    }
+
+    t->resp.curl_code = CURLE_FAILED_INIT;
+    t->resp.error = "HTTP engine not running";
+    complete(*t);
+}
+
+std::future<http_response> HttpClient::request(http_request req)
+{
+    auto promise = std::make_shared<std::promise<http_response>>();
+    auto future = promise->get_future();
+    request(std::move(req), [promise](http_response & resp)
+    {
+        promise->set_value(std::move(resp));
+    });
+    return future;
+}
+
+void HttpClient::setDeadline(const std::chrono::steady_clock::time_point deadline)
+{
+    _deadline = deadline.time_since_epoch().count();
+}
+
+void HttpClient::clearDeadline()
+{
+    _deadline = std::chrono::steady_clock::time_point::max().time_since_epoch().count();
+}
+
+void HttpClient::drain(const std::chrono::milliseconds grace)
+{
+    _drain_deadline = (std::chrono::steady_clock::now() + grace).time_since_epoch().count();
+    // Delayed transfers past it are dropped on next engine loop
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (nullptr != _multi)
+        curl_multi_wakeup(_multi);
+}
+
+std::chrono::milliseconds HttpClient::remainingBudget(const http_request & req) const
+{
+    const std::chrono::steady_clock::time_point deadline = std::min({
+        std::chrono::steady_clock::time_point{ std::chrono::steady_clock::duration(_deadline) },
+        std::chrono::steady_clock::time_point{ std::chrono::steady_clock::duration(_drain_deadline) },
+        req.deadline });
+    if (std::chrono::steady_clock::time_point::max() == deadline)
+        return std::chrono::milliseconds::max();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+}
+
+bool HttpClient::perform(http_request req, http_response & resp)
+{
+    if (std::this_thread::get_id() == _thread_id)
+    {
+        SPDLOG_ERROR("Blocking request to '{}' from HTTP engine thread would deadlock!", req.url);
+        return false;
+    }
+
+    resp = request(std::move(req)).get();
+    return resp.ok;
+}
+
+size_t HttpClient::writeCallback(const char * bufptr, size_t size, size_t nitems, void * userp)
+{
+    if (nullptr == bufptr || nullptr == userp)
+    {
+        SPDLOG_WARN("Invalid curl write callback function params bufptr and/or userp!");
+        return nitems;
+    }
+    if (size < 1 || nitems < 1)
+    {
+        SPDLOG_WARN("Invalid curl write callback function params, size is '{}', nitems is '{}'!", size, nitems);
+        return nitems;
+    }
+
+    auto * t = reinterpret_cast<transfer *>(userp);
+    const size_t len = size * nitems;
+    t->decoded_bytes += static_cast<curl_off_t>(len);
+    if (t->req.on_data)
+    {
+        if (t->resp.body.length() < STREAMED_BODY_PREFIX_LEN)
+            t->resp.body.append(bufptr, std::min(len, STREAMED_BODY_PREFIX_LEN - t->resp.body.length()));
+        if (!t->body_started)
+        {
+            // Error bodies are only kept as prefix, so a failed attempt can be retried with a clean consumer
+            t->body_started = true;
+            long code = 0;
+            curl_easy_getinfo(t->curl, CURLINFO_RESPONSE_CODE, &code);
+            t->stream_data = code >= 200 && code < 300;
+        }
+        if (!t->stream_data)
+            return nitems;
+        t->data_delivered = true;
+        // Returning less than passed in aborts the transfer with CURLE_WRITE_ERROR
+        return t->req.on_data(bufptr, len) ? nitems : 0;
+    }
+
+    std::string & body = nullptr != t->req.body_buffer ? *t->req.body_buffer : t->resp.body;
+    if (!t->body_started)
+    {
+        // Size body once from Content-Length (-1 if unknown) instead of growing it chunk by chunk
+        t->body_started = true;
+        curl_off_t content_length = -1;
+        if (CURLE_OK == curl_easy_getinfo(t->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length)
+            && content_length > 0)
+            body.reserve(body.length() + static_cast<size_t>(content_length));
+    }
+    body.append(bufptr, len);
+    return nitems;
+}
+
+int HttpClient::progressCallback(void * clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+{
+    auto * t = static_cast<transfer *>(clientp);
+    const auto & req = t->req;
+
+    // Deadline may be moved closer while the transfer runs, e.g. on shutdown
+    if (getInstance().remainingBudget(req).count() <= 0)
+    {
+        t->timed_out_phase = "deadline";
+        t->budget_capped = true;
+        return 1;
+    }
+    if (req.connect_timeout_ms <= 0 && req.tls_timeout_ms <= 0 && req.first_byte_timeout_ms <= 0)
+        return 0;
+
+    const long long elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - t->started).count();
+
+    // Phase times are relative to transfer start, 0 until the phase is reached. They may stay 0 on
+    // a reused connection, so a sent request also marks the connection as established.
+    curl_off_t connect_us = 0, pretransfer_us = 0, starttransfer_us = 0;
+    long request_size = 0;
+    curl_easy_getinfo(t->curl, CURLINFO_CONNECT_TIME_T, &connect_us);
+    curl_easy_getinfo(t->curl, CURLINFO_PRETRANSFER_TIME_T, &pretransfer_us);
+    curl_easy_getinfo(t->curl, CURLINFO_STARTTRANSFER_TIME_T, &starttransfer_us);
+    curl_easy_getinfo(t->curl, CURLINFO_REQUEST_SIZE, &request_size);
+    if (0 == pretransfer_us && 0 == request_size)
+    {
+        if (0 == connect_us)
+        {
+            if (req.connect_timeout_ms > 0 && elapsed_us > req.connect_timeout_ms * 1000LL)
+                t->timed_out_phase = "connect";
+        }
+        else if (req.tls_timeout_ms > 0 && elapsed_us - connect_us > req.tls_timeout_ms * 1000LL)
+            t->timed_out_phase = "TLS handshake";
+    }
+    else if (0 == starttransfer_us && req.first_byte_timeout_ms > 0
+             && elapsed_us - pretransfer_us > req.first_byte_timeout_ms * 1000LL)
+        t->timed_out_phase = "first byte";
+
+    // Non-zero aborts the transfer with CURLE_ABORTED_BY_CALLBACK
+    return nullptr != t->timed_out_phase ? 1 : 0;
+}
+
+void HttpClient::run()
+{
+    _thread_id = std::this_thread::get_id();
+    while (_running)
+    {
+        addDelayed();
+        addPending();
+
+        int still_running = 0;
+        const CURLMcode ret = curl_multi_perform(_multi, &still_running);
+        if (CURLM_OK != ret)
+            SPDLOG_WARN("curl_multi_perform fail, error is '{}'!", curl_multi_strerror(ret));
+
+        int msgs_left = 0;
+        while (CURLMsg * msg = curl_multi_info_read(_multi, &msgs_left))
+        {
+            if (CURLMSG_DONE == msg->msg)
+                finishTransfer(msg->easy_handle, msg->data.result);
+        }
+
+        // Woken up early by curl_multi_wakeup when requests are submitted or engine is stopping
+        curl_multi_poll(_multi, nullptr, 0, static_cast<int>(pollTimeoutMs()), nullptr);
+    }
+
+    abortAll();
+    _thread_id = std::thread::id();
+}
+
+void HttpClient::addPending()
+{
+    std::deque<std::unique_ptr<transfer>> pending;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        pending.swap(_pending);
+    }
+
+    for (auto & t : pending)
+    {
+        if (t->replayed)
+        {
+            // Replayed responses skip rate limiter, circuit breaker and curl, only latency is reproduced
+            _delayed.emplace(std::chrono::steady_clock::now() + t->replay_latency, std::move(t));
+            continue;
+        }
+        t->endpoint = HttpCircuitBreaker::getEndpoint(t->req.url);
+        t->retry = get_http_retry_policy(t->req.url);
+        if (t->req.max_attempts > 0)
+            t->retry.max_attempts = t->req.max_attempts;
+        if (!t->req.cache_key.empty())
+        {
+            for (auto & header : HttpCache::getInstance().getConditionalHeaders(t->req.cache_key))
+                t->req.headers.emplace_back(std::move(header));
+        }
+        admit(std::move(t));
+    }
+}
+
+void HttpClient::addDelayed()
+{
+    const auto now = std::chrono::steady_clock::now();
+    while (!_delayed.empty() && _delayed.begin()->first <= now)
+    {
+        std::unique_ptr<transfer> t = std::move(_delayed.begin()->second);
+        _delayed.erase(_delayed.begin());
+        if (t->replayed)
+            deliverReplayed(*t);
+        else
+            admit(std::move(t));
+    }
+
+    // Retries and rate limited requests whose deadline passed fail now rather than when due
+    for (auto it = _delayed.begin(); it != _delayed.end();)
+    {
+        if (it->second->replayed || remainingBudget(it->second->req).count() > 0)
+        {
+            ++it;
+            continue;
+        }
+        std::unique_ptr<transfer> t = std::move(it->second);
+        it = _delayed.erase(it);
+        addTransfer(std::move(t));
+    }
+}
+
+void HttpClient::admit(std::unique_ptr<transfer> t)
+{
+    if (!t->req.rate_limit_key.empty() && !t->admitted)
+    {
+        t->admitted = true;
+        const auto wait = HttpRateLimiter::getInstance().reserve(t->req.rate_limit_key);
+        if (wait.count() > 0)
+        {
+            // Queued instead of failing, the token is already reserved so it is sent when due
+            _delayed.emplace(std::chrono::steady_clock::now() + wait, std::move(t));
+            return;
+        }
+    }
+
+    if (!t->fault_drawn && HttpFaultInjector::isEnabled())
+    {
+        t->fault_drawn = true;
+        const http_injected_fault injected = HttpFaultInjector::getInstance().next();
+        t->fault = injected.fault;
+        // Injected latency is spent like a slow response would: it times the attempt out once it reaches the
+        // attempt timeout, and the attempt is dropped once the cycle budget, request deadline or drain runs out
+        auto latency = injected.latency;
+        if (latency.count() >= t->req.timeout_ms)
+        {
+            latency = std::chrono::milliseconds(t->req.timeout_ms);
+            t->fault = HttpFault::Timeout;
+        }
+        latency = std::min(latency, std::max(std::chrono::milliseconds(0), remainingBudget(t->req)));
+        if (latency.count() > 0)
+        {
+            _delayed.emplace(std::chrono::steady_clock::now() + latency, std::move(t));
+            return;
+        }
+    }
+
+    addTransfer(std::move(t));
+}
+
+void HttpClient::addTransfer(std::unique_ptr<transfer> t)
+{
+    ++t->attempt;
+    if (remainingBudget(t->req).count() <= 0)
+    {
+        SPDLOG_WARN("Deadline passed, request to '{}' dropped!", t->req.url);
+        // A probe held from a previous attempt is handed on rather than kept forever
+        if (t->probe)
+        {
+            HttpCircuitBreaker::getInstance().cancelProbe(t->endpoint);
+            t->probe = false;
+        }
+        t->resp.curl_code = CURLE_OPERATION_TIMEDOUT;
+        t->resp.error = "Deadline passed";
+        complete(*t);
+        return;
+    }
+
+    auto & breaker = HttpCircuitBreaker::getInstance();
+    if (!breaker.allow(t->endpoint, t->probe))
+    {
+        SPDLOG_WARN("Circuit of '{}' is open, request to '{}' rejected!", t->endpoint, t->req.url);
+        t->resp.curl_code = CURLE_COULDNT_CONNECT;
+        t->resp.error = "Circuit open";
+        complete(*t);
+        return;
+    }
+
+    if (HttpFault::None != t->fault)
+    {
+        injectFault(std::move(t));
+        return;
+    }
+
+    t->curl = HttpHandlePool::getInstance().acquire();
+    if (nullptr == t->curl)
+    {
+        SPDLOG_ERROR("Failed to acquire curl handle!");
+        breaker.record(t->endpoint, false);
+        t->resp.curl_code = CURLE_FAILED_INIT;
+        t->resp.error = "Failed to acquire curl handle";
+        complete(*t);
+        return;
+    }
+
+    setupTransfer(*t);
+    const CURLMcode ret = curl_multi_add_handle(_multi, t->curl);
+    if (CURLM_OK != ret)
+    {
+        SPDLOG_WARN("curl_multi_add_handle fail, error is '{}', url is '{}'!",
+                    curl_multi_strerror(ret), t->req.url);
+        HttpHandlePool::getInstance().release(t->curl, false);
+        curl_slist_free_all(t->headers);
+        breaker.record(t->endpoint, false);
+        t->resp.curl_code = CURLE_FAILED_INIT;
+        t->resp.error = curl_multi_strerror(ret);
+        complete(*t);
+        return;
+    }
+    _active.emplace_back(std::move(t));
+}
+
+void HttpClient::setupTransfer(transfer & t)
+{
+    CURL * curl = t.curl;
+    const auto & req = t.req;
+
+    HttpShare::getInstance().apply(curl);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, static_cast<void *>(&t));
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_3);
+    curl_easy_setopt(curl, CURLOPT_URL, req.url.c_str());
+    // Half-open probe only checks if endpoint is back, so it must not hang for the full timeout
+    long timeout_ms = req.timeout_ms;
+    if (t.probe)
+        timeout_ms = std::min(timeout_ms, static_cast<long>(
+            Config::getInstance()._http_circuit_breaker.probe_timeout.count()));
+    const auto budget = remainingBudget(req);
+    t.budget_capped = budget.count() < timeout_ms;
+    if (t.budget_capped)
+        timeout_ms = std::max(1L, static_cast<long>(budget.count()));
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout_ms);
+    // curl's connect timeout covers TCP and TLS, each phase is checked separately by progress callback
+    if (req.connect_timeout_ms > 0)
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, req.connect_timeout_ms + req.tls_timeout_ms);
+    t.started = std::chrono::steady_clock::now();
+    t.timed_out_phase = nullptr;
+    t.decoded_bytes = 0;
+    // Empty string offers every encoding libcurl was built with (gzip/deflate, br), decoded as it streams in
+    if (_compression)
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    // Checks phase timeouts and a deadline moved closer by drain
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progressCallback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, static_cast<void *>(&t));
+    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, t.errbuf);
+    if (!_connect_to.empty())
+        curl_easy_setopt(curl, CURLOPT_CONNECT_TO, _connect_to.list());
+    if (_http2)
+    {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        // Wait for an existing connection to multiplex on rather than opening a new one
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    }
+
+    if (!req.method.empty() && "get" != req.method && "post" != req.method)
+    {
+        std::string custom_req = req.method;
+        std::transform(custom_req.begin(), custom_req.end(), custom_req.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, custom_req.c_str());
+    }
+    if (!req.body.empty())
+    {
+        if (req.method.empty() || "post" == req.method)
+            curl_easy_setopt(curl, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req.body.c_str());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(req.body.length()));
+    }
+
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, static_cast<void *>(&t));
+
+//#ifndef NDEBUG
+//    curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+//#endif
+    if (req.headers.empty())
+    {
+        // Prebuilt list is only read by curl, no per-transfer copy needed
+        if (!req.header_list.empty())
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, req.header_list.list());
+        return;
+    }
+    for (const curl_slist * item = req.header_list.list(); nullptr != item; item = item->next)
+        t.headers = curl_slist_append(t.headers, item->data);
+    for (const auto & header : req.headers)
+        t.headers = curl_slist_append(t.headers, header.c_str());
+    if (nullptr != t.headers)
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, t.headers);
+}
+
+void HttpClient::finishTransfer(CURL * curl, const CURLcode result)
+{
+    auto found = std::find_if(_active.begin(), _active.end(), [curl](const std::unique_ptr<transfer> & t)
+    {
+        return t->curl == curl;
+    });
+    if (_active.end() == found)
+    {
+        SPDLOG_WARN("Finished curl handle not found in active transfers!");
+        curl_multi_remove_handle(_multi, curl);
+        return;
+    }
+
+    std::unique_ptr<transfer> t = std::move(*found);
+    _active.erase(found);
+    curl_multi_remove_handle(_multi, curl);
+
+    auto & resp = t->resp;
+    resp.curl_code = result;
+    std::chrono::milliseconds retry_after(0);
+    if (CURLE_ABORTED_BY_CALLBACK == result && nullptr != t->timed_out_phase)
+    {
+        resp.curl_code = CURLE_OPERATION_TIMEDOUT;
+        resp.error = fmt::format("{} timeout", t->timed_out_phase);
+    }
+    else if (CURLE_OK != result)
+        resp.error = '\0' != t->errbuf[0] ? t->errbuf : curl_easy_strerror(result);
+    else
+    {
+        resp.ok = true;
+        long code = 0;
+        const CURLcode ret = curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+        if (CURLE_OK != ret)
+            SPDLOG_WARN("curl_easy_getinfo fail, curl_code is '{}', error is '{}'!",
+                        static_cast<int>(ret), t->errbuf);
+        else
+            resp.code = static_cast<int>(code);
+#if LIBCURL_VERSION_NUM >= 0x074200
+        // Retry-After in seconds or as HTTP date, already converted to seconds by curl
+        curl_off_t retry_after_sec = 0;
+        if (CURLE_OK == curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retry_after_sec) && retry_after_sec > 0)
+            retry_after = std::chrono::seconds(retry_after_sec);
+#endif
+        if (!t->req.rate_limit_key.empty())
+            updateRateLimit(*t, curl, retry_after);
+        if (!t->req.cache_key.empty())
+            updateCache(*t, curl);
+        if (_compression)
+            updateCompressionMetrics(*t, curl);
+    }
+    recordTiming(*t, curl);
+
+    HttpHandlePool::getInstance().release(curl, resp.ok);
+    t->curl = nullptr;
+    curl_slist_free_all(t->headers);
+    t->headers = nullptr;
+
+    finishAttempt(std::move(t), retry_after);
+}
+
+void HttpClient::injectFault(std::unique_ptr<transfer> t)
+{
+    auto & resp = t->resp;
+    if (HttpFault::ConnectError == t->fault)
+    {
+        resp.curl_code = CURLE_COULDNT_CONNECT;
+        resp.error = "Injected connection error";
+    }
+    else if (HttpFault::Timeout == t->fault)
+    {
+        resp.curl_code = CURLE_OPERATION_TIMEDOUT;
+        resp.error = "Injected latency reached total timeout";
+    }
+    else
+        resp.code = 503;
+    t->budget_capped = false;
+    SPDLOG_DEBUG("Fault injected into request to '{}': {}.", t->req.url, 0 != resp.code ? "HTTP 503" : resp.error);
+    deliverBody(t->req, resp);
+    finishAttempt(std::move(t), std::chrono::milliseconds(0));
+}
+
+void HttpClient::finishAttempt(std::unique_ptr<transfer> t, const std::chrono::milliseconds retry_after)
+{
+    const auto & resp = t->resp;
+    // Endpoint is considered down on transport errors and 5xx, other responses show it is serving.
+    // Running out of cycle budget or request deadline says nothing about the endpoint.
+    const bool endpoint_failed = (CURLE_OK != resp.curl_code
+        && HttpResultClass::Retryable == classify_http_result(resp.curl_code, 0))
+        || (resp.code >= 500 && !t->req.app_server_errors);
+    if (!(t->budget_capped && CURLE_OPERATION_TIMEDOUT == resp.curl_code))
+        HttpCircuitBreaker::getInstance().record(t->endpoint, !endpoint_failed);
+    else if (t->probe)
+        HttpCircuitBreaker::getInstance().cancelProbe(t->endpoint);
+    t->probe = false;
+
+    if (retryLater(t, retry_after))
+        return;
+
+    if (CURLE_OK != resp.curl_code)
+        SPDLOG_WARN("curl transfer fail, curl code is '{}', error is '{}', url is '{}'!",
+                    static_cast<int>(resp.curl_code), resp.error, t->req.url);
+    else if ((resp.code >= 200 && resp.code < 300) || 304 == resp.code)
+    {
+        // 304 is the expected answer of a conditional request whose cached values are still valid
+        if (200 != resp.code)
+            SPDLOG_DEBUG("'{}' answered with response code '{}'.", t->req.url, resp.code);
+    }
+    else
+        SPDLOG_WARN("'{}' request failed, response code is '{}'!", t->req.url, resp.code);
+
+    complete(*t);
+}
+
+void HttpClient::updateRateLimit(const transfer & t, CURL * curl, const std::chrono::milliseconds retry_after)
+{
+    auto & limiter = HttpRateLimiter::getInstance();
+    if (429 == t.resp.code)
+    {
+        limiter.throttle(t.req.rate_limit_key, retry_after);
+        return;
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x075400
+    // IETF RateLimit-* headers, or the X-RateLimit-* variants some providers still send
+    const auto get_header = [curl](const char * name, const char * alt_name, long long & value)
+    {
+        curl_header * h = nullptr;
+        if (CURLHE_OK != curl_easy_header(curl, name, 0, CURLH_HEADER, -1, &h)
+            && CURLHE_OK != curl_easy_header(curl, alt_name, 0, CURLH_HEADER, -1, &h))
+            return false;
+        char * end = nullptr;
+        value = std::strtoll(h->value, &end, 10);
+        return end != h->value;
+    };
+
+    long long remaining = -1, reset = 0;
+    if (!get_header("RateLimit-Remaining", "X-RateLimit-Remaining", remaining))
+        return;
+    if (get_header("RateLimit-Reset", "X-RateLimit-Reset", reset))
+    {
+        // Reset is usually delta seconds, but some providers send an epoch timestamp
+        const long long now_sec = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        if (reset > now_sec / 2)
+            reset = std::max(0LL, reset - now_sec);
+    }
+    limiter.update(t.req.rate_limit_key, static_cast<long>(remaining), std::chrono::seconds(reset));
+#else
+    (void)curl;
+#endif
+}
+
+void HttpClient::recordTiming(const transfer & t, CURL * curl)
+{
+    // curl times are cumulative from transfer start, 0 for phases not reached (or skipped on reuse)
+    curl_off_t namelookup_us = 0, connect_us = 0, appconnect_us = 0, starttransfer_us = 0, total_us = 0;
+    curl_off_t sent = 0, received = 0;
+    long connects = 0, header_size = 0, request_size = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &namelookup_us);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect_us);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &appconnect_us);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &starttransfer_us);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total_us);
+    curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &sent);
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &received);
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+    curl_easy_getinfo(curl, CURLINFO_HEADER_SIZE, &header_size);
+    curl_easy_getinfo(curl, CURLINFO_REQUEST_SIZE, &request_size);
+
+    http_request_timing timing;
+    timing.dns = std::chrono::microseconds(namelookup_us);
+    if (connect_us > namelookup_us)
+        timing.connect = std::chrono::microseconds(connect_us - namelookup_us);
+    if (appconnect_us > connect_us)
+        timing.tls = std::chrono::microseconds(appconnect_us - connect_us);
+    timing.first_byte = std::chrono::microseconds(starttransfer_us);
+    timing.total = std::chrono::microseconds(total_us);
+    timing.bytes_sent = static_cast<uint64_t>(request_size + sent);
+    timing.bytes_received = static_cast<uint64_t>(header_size + received);
+    timing.reused = 0 == connects && CURLE_OK == t.resp.curl_code;
+    timing.failed = CURLE_OK != t.resp.curl_code || t.resp.code >= 400;
+    HttpStats::getInstance().record(t.req.stats_name.empty() ? t.endpoint : t.req.stats_name, timing);
+}
+
+void HttpClient::updateCompressionMetrics(const transfer & t, CURL * curl)
+{
+    // Downloaded size counts body bytes as received, before content decoding
+    curl_off_t wire_bytes = 0;
+    if (CURLE_OK != curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &wire_bytes) || wire_bytes <= 0)
+        return;
+
+    auto & metrics = Metrics::getInstance();
+    metrics.add("http_body_wire_bytes_total", static_cast<double>(wire_bytes));
+    metrics.add("http_body_decoded_bytes_total", static_cast<double>(t.decoded_bytes));
+    metrics.set("http_compression_ratio",
+                metrics.get("http_body_decoded_bytes_total") / metrics.get("http_body_wire_bytes_total"));
+}
+
+void HttpClient::updateCache(transfer & t, CURL * curl)
+{
+    if (200 != t.resp.code)
+        return;
+
+#if LIBCURL_VERSION_NUM >= 0x075400
+    curl_header * h = nullptr;
+    if (CURLHE_OK == curl_easy_header(curl, "ETag", 0, CURLH_HEADER, -1, &h))
+        t.resp.etag = h->value;
+    if (CURLHE_OK == curl_easy_header(curl, "Last-Modified", 0, CURLH_HEADER, -1, &h))
+        t.resp.last_modified = h->value;
+#else
+    (void)curl;
+#endif
+    // Stored before the caller gets the response, so its extracted values always match these validators
+    HttpCache::getInstance().setValidators(t.req.cache_key, t.resp.etag, t.resp.last_modified);
+}
+
+bool HttpClient::retryLater(std::unique_ptr<transfer> & t, const std::chrono::milliseconds retry_after)
+{
+    if (HttpResultClass::Retryable != classify_http_result(t->resp.curl_code, t->resp.code))
+        return false;
+    if (t->resp.code >= 500 && t->req.app_server_errors)
+        return false;
+    if (t->attempt >= t->retry.max_attempts || t->data_delivered)
+        return false;
+    if (retry_after > t->retry.max_delay)
+    {
+        SPDLOG_WARN("'{}' asks to retry after {} ms, longer than max retry delay, giving up!",
+                    t->req.url, retry_after.count());
+        return false;
+    }
+
+    const auto delay = std::max(retry_after, get_http_retry_backoff(t->retry, t->attempt));
+    if (delay >= remainingBudget(t->req))
+        return false;
+    if (CURLE_OK != t->resp.curl_code)
+        SPDLOG_WARN("'{}' attempt {}/{} failed, error is '{}', retry in {} ms...", t->req.url,
+                    t->attempt, t->retry.max_attempts, t->resp.error, delay.count());
+    else
+        SPDLOG_WARN("'{}' attempt {}/{} failed, response code is '{}', retry in {} ms...", t->req.url,
+                    t->attempt, t->retry.max_attempts, t->resp.code, delay.count());
+
+    t->resp = http_response();
+    if (nullptr != t->req.body_buffer)
+        t->req.body_buffer->clear();
+    t->errbuf[0] = '\0';
+    t->body_started = false;
+    t->stream_data = false;
+    t->admitted = false;
+    t->fault_drawn = false;
+    t->fault = HttpFault::None;
+    _delayed.emplace(std::chrono::steady_clock::now() + delay, std::move(t));
+
+    return true;
+}
+
+long HttpClient::pollTimeoutMs() const
+{
+    static constexpr long MAX_POLL_TIMEOUT_MS = 1000;
+    // Phase timeouts are checked from the progress callback, which only runs when curl is driven
+    static constexpr long PHASE_CHECK_INTERVAL_MS = 50;
+    long max_timeout_ms = _active.empty() ? MAX_POLL_TIMEOUT_MS : PHASE_CHECK_INTERVAL_MS;
+    if (_delayed.empty())
+        return max_timeout_ms;
+    // Delayed transfers are dropped once the drain deadline passes
+    const std::chrono::steady_clock::time_point drain_deadline{ std::chrono::steady_clock::duration(_drain_deadline) };
+    if (std::chrono::steady_clock::time_point::max() != drain_deadline)
+    {
+        const auto drain_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            drain_deadline - std::chrono::steady_clock::now()).count();
+        max_timeout_ms = std::max(0L, std::min(max_timeout_ms, static_cast<long>(drain_ms) + 1));
+    }
+
+    const auto due = std::chrono::duration_cast<std::chrono::milliseconds>(
+        _delayed.begin()->first - std::chrono::steady_clock::now()).count();
+    return std::max(0L, std::min(max_timeout_ms, static_cast<long>(due)));
+}
+
+void HttpClient::recordToCassette(transfer & t)
+{
+    // Streamed bodies are only kept as prefix in response, so the full body is captured on its way
+    auto streamed = std::make_shared<std::string>();
+    if (t.req.on_data)
+    {
+        auto on_data = std::move(t.req.on_data);
+        t.req.on_data = [on_data, streamed](const char * data, size_t len)
+        {
+            streamed->append(data, len);
+            return on_data(data, len);
+        };
+    }
+
+    http_request key_req;
+    key_req.url = t.req.url;
+    key_req.method = t.req.method;
+    key_req.body = t.req.body;
+    std::string * body_buffer = t.req.body_buffer;
+    const auto submitted = std::chrono::steady_clock::now();
+    t.cb = [cb = std::move(t.cb), key_req, body_buffer, streamed, submitted](http_response & resp)
+    {
+        cassette_entry entry;
+        entry.curl_code = resp.curl_code;
+        entry.code = resp.code;
+        entry.latency = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - submitted);
+        entry.error = resp.error;
+        entry.etag = resp.etag;
+        entry.last_modified = resp.last_modified;
+        if (!streamed->empty())
+            entry.body = *streamed;
+        else
+            entry.body = nullptr != body_buffer ? *body_buffer : resp.body;
+        HttpCassette::getInstance().record(key_req, entry);
+        if (cb)
+            cb(resp);
+    };
+}
+
+bool HttpClient::replayFromCassette(transfer & t)
+{
+    cassette_entry entry;
+    if (!HttpCassette::getInstance().replay(t.req, entry))
+        return false;
+
+    t.replayed = true;
+    t.replay_latency = entry.latency;
+    t.resp.curl_code = entry.curl_code;
+    t.resp.code = entry.code;
+    t.resp.error = std::move(entry.error);
+    t.resp.etag = std::move(entry.etag);
+    t.resp.last_modified = std::move(entry.last_modified);
+    t.resp.body = std::move(entry.body);
+    return true;
+}
+
+void HttpClient::deliverBody(const http_request & req, http_response & resp)
+{
+    resp.ok = CURLE_OK == resp.curl_code;
+    if (resp.ok && 200 == resp.code && !req.cache_key.empty())
+        HttpCache::getInstance().setValidators(req.cache_key, resp.etag, resp.last_modified);
+
+    if (req.on_data)
+    {
+        if (resp.ok && resp.code >= 200 && resp.code < 300 && !req.on_data(resp.body.data(), resp.body.length()))
+        {
+            resp.ok = false;
+            resp.curl_code = CURLE_WRITE_ERROR;
+            resp.error = "Aborted by stream consumer";
+        }
+        if (resp.body.length() > STREAMED_BODY_PREFIX_LEN)
+            resp.body.resize(STREAMED_BODY_PREFIX_LEN);
+    }
+    else if (nullptr != req.body_buffer)
+    {
+        req.body_buffer->assign(resp.body);
+        resp.body.clear();
+    }
+}
+
+void HttpClient::deliverReplayed(transfer & t)
+{
+    deliverBody(t.req, t.resp);
+    complete(t);
+}
+
+void HttpClient::complete(transfer & t)
+{
+    if (!t.cb)
+        return;
+    try
+    {
+        t.cb(t.resp);
+    }
+    catch (const std::exception & ex)
+    {
+        SPDLOG_WARN("Exception from completion callback of '{}': {}!", t.req.url, ex.what());
+    }
+}
+
+void HttpClient::abortAll()
+{
+    for (auto & t : _active)
+    {
+        // Aborted probe says nothing about the endpoint
+        if (t->probe)
+            HttpCircuitBreaker::getInstance().cancelProbe(t->endpoint);
+        curl_multi_remove_handle(_multi, t->curl);
+        HttpHandlePool::getInstance().release(t->curl, false);
+        curl_slist_free_all(t->headers);
+        t->resp.curl_code = CURLE_ABORTED_BY_CALLBACK;
+        t->resp.error = "HTTP engine stopped";
+        complete(*t);
+    }
+    _active.clear();
+
+    for (auto & item : _delayed)
+    {
+        item.second->resp.curl_code = CURLE_ABORTED_BY_CALLBACK;
+        item.second->resp.error = "HTTP engine stopped";
+        complete(*item.second);
+    }
+    _delayed.clear();
+
+    std::deque<std::unique_ptr<transfer>> pending;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        pending.swap(_pending);
+    }
+    for (auto & t : pending)
+    {
+        t->resp.curl_code = CURLE_ABORTED_BY_CALLBACK;
+        t->resp.error = "HTTP engine stopped";
+        complete(*t);
+    }
+}
@@ -0,0 +1,205 @@
+#ifndef PVE_DDNS_CLIENT_SRC_HTTP_HTTP_CLIENT_H
+#define PVE_DDNS_CLIENT_SRC_HTTP_HTTP_CLIENT_H
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "curl/curl.h"
+
+#include "http_headers.h"
+
+/// HTTP request
+typedef struct http_request_
+{
+    /// URL
+    std::string url;
+    /// Request body, POST is used if not empty and no method specified
+    std::string body;
+    /// Method name in lower case, e.g. put, delete, patch (empty for GET/POST)
+    std::string method;
+    /// Prebuilt headers shared by requests of a service
+    HttpHeaders header_list;
+    /// Additional per-request headers
+    std::vector<std::string> headers;
+    /// Total timeout
+    long timeout_ms = 30000;
+    /// TCP connect timeout, 0 for none
+    long connect_timeout_ms = 0;
+    /// TLS handshake timeout, 0 for none
+    long tls_timeout_ms = 0;
+    /// Timeout from request sent to first response byte, 0 for none
+    long first_byte_timeout_ms = 0;
+    /// Deadline over all attempts, the update cycle deadline applies as well
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    /// Optional streaming body consumer, called on the engine thread for each chunk as it arrives.
+    /// When set, only a short prefix of the body is kept in response for diagnostics.
+    /// Return false to abort the transfer.
+    std::function<bool(const char * data, size_t len)> on_data;
+    /// Optional caller owned buffer receiving the body instead of response, it must outlive the transfer.
+    /// Capacity is reserved from Content-Length so a reused buffer does not reallocate.
+    std::string * body_buffer = nullptr;
+    /// Max attempts overriding the retry policy configured for the endpoint, 0 to use the policy
+    int max_attempts = 0;
+    /// 5xx responses are answers of the resource rather than endpoint failures (e.g. PVE guest agent not running),
+    /// they are neither retried nor counted against the endpoint circuit
+    bool app_server_errors = false;
+    /// Rate limiter bucket (see HttpRateLimiter::getKey), empty for no limit. Limited requests are queued.
+    std::string rate_limit_key;
+    /// Conditional request cache entry (see HttpCache::getKey), empty for none. Validators of a 200 response
+    /// are stored in it, and once the caller stored extracted values the next request may get a 304.
+    std::string cache_key;
+    /// Logical endpoint timings are aggregated under (see HttpStats), e.g. "cloudflare.patch_record".
+    /// Defaults to scheme://host:port.
+    std::string stats_name;
+} http_request;
+
+/// HTTP response
+typedef struct http_response_
+{
+    /// If transfer succeeded (any HTTP response code)
+    bool ok = false;
+    /// HTTP response code
+    int code = 0;
+    /// curl result code
+    CURLcode curl_code = CURLE_OK;
+    /// curl error message if transfer failed
+    std::string error;
+    /// Response body (only a short prefix if request is streamed through on_data, empty if received into
+    /// request body_buffer)
+    std::string body;
+    /// ETag response header, only filled for requests with cache_key
+    std::string etag;
+    /// Last-Modified response header, only filled for requests with cache_key
+    std::string last_modified;
+} http_response;
+
+/// Completion callback, invoked on the HTTP engine thread so it must not block
+using http_callback = std::function<void(http_response & resp)>;
+
+/// Asynchronous HTTP engine driving all transfers on a single thread with curl_multi
+class HttpClient
+{
+public:
+    static HttpClient & getInstance()
+    {
+        static HttpClient instance;
+        return instance;
+    }
+
+    /// \brief Start engine thread (also started lazily by first request)
+    /// \return Operation result
+    bool start();
+
+    /// \brief Stop engine thread, in-flight and queued requests are aborted
+    void stop();
+
+    /// \brief Submit request, callback is called on completion
+    /// \param req Request
+    /// \param cb Completion callback
+    void request(http_request req, http_callback cb);
+
+    /// \brief Submit request, response is delivered through a future
+    /// \param req Request
+    /// \return Future of response
+    std::future<http_response> request(http_request req);
+
+    /// \brief Set deadline of current update cycle, request timeouts are shortened to the remaining budget
+    /// and requests due after it fail immediately
+    /// \param deadline Deadline
+    void setDeadline(std::chrono::steady_clock::time_point deadline);
+
+    /// \brief Clear update cycle deadline
+    void clearDeadline();
+
+    /// \brief Give in-flight and queued requests a grace period to finish, after it they are aborted and new
+    /// ones fail immediately. Used on shutdown, not cleared by clearDeadline.
+    /// \param grace Grace period
+    void drain(std::chrono::milliseconds grace);
+
+    /// \brief Blocking request, thin wrapper over the asynchronous engine
+    /// \param req Request
+    /// \param resp Response
+    /// \return If transfer succeeded
+    bool perform(http_request req, http_response & resp);
+
+    /// \brief Deliver a complete in-memory body the way a network transfer would (stream consumer, caller
+    /// buffer, cache validators), for responses not received through the engine
+    /// \param req Request
+    /// \param resp Response, ok is set from curl_code
+    static void deliverBody(const http_request & req, http_response & resp);
+
+private:
+    struct transfer;
+
+    HttpClient();
+    ~HttpClient();
+    HttpClient(HttpClient const &) = delete;
+    HttpClient & operator=(HttpClient const &) = delete;
+
+    bool startLocked();
+    static size_t writeCallback(const char * bufptr, size_t size, size_t nitems, void * userp);
+    static int progressCallback(void * clientp, curl_off_t dltotal, curl_off_t dlnow,
+                                curl_off_t ultotal, curl_off_t ulnow);
+    std::chrono::milliseconds remainingBudget(const http_request & req) const;
+    void run();
+    void addPending();
+    void addDelayed();
+    void admit(std::unique_ptr<transfer> t);
+    void addTransfer(std::unique_ptr<transfer> t);
+    void setupTransfer(transfer & t);
+    void finishTransfer(CURL * curl, CURLcode result);
+    void injectFault(std::unique_ptr<transfer> t);
+    void finishAttempt(std::unique_ptr<transfer> t, std::chrono::milliseconds retry_after);
+    static void updateRateLimit(const transfer & t, CURL * curl, std::chrono::milliseconds retry_after);
+    static void updateCache(transfer & t, CURL * curl);
+    static void updateCompressionMetrics(const transfer & t, CURL * curl);
+    static void recordTiming(const transfer & t, CURL * curl);
+    static void recordToCassette(transfer & t);
+    static bool replayFromCassette(transfer & t);
+    static void deliverReplayed(transfer & t);
+    bool retryLater(std::unique_ptr<transfer> & t, std::chrono::milliseconds retry_after);
+    long pollTimeoutMs() const;
+    static void complete(transfer & t);
+    void abortAll();
+
+    /// curl multi handle
+    CURLM * _multi = nullptr;
+    /// Engine thread
+    std::thread _thread;
+    /// Engine thread id
+    std::atomic<std::thread::id> _thread_id;
+    /// Engine running flag
+    std::atomic<bool> _running{false};
+    /// Update cycle deadline (steady clock ticks), max if none
+    std::atomic<std::chrono::steady_clock::rep> _deadline{ std::chrono::steady_clock::time_point::max()
+                                                               .time_since_epoch().count() };
+    /// Shutdown drain deadline (steady clock ticks), max if not draining
+    std::atomic<std::chrono::steady_clock::rep> _drain_deadline{ std::chrono::steady_clock::time_point::max()
+                                                                     .time_since_epoch().count() };
+    /// Use HTTP/2 with multiplexing (config enabled and supported by libcurl)
+    bool _http2 = false;
+    /// Offer compressed responses (config enabled and supported by libcurl)
+    bool _compression = false;
+    /// Connection redirects (CURLOPT_CONNECT_TO) from config
+    HttpHeaders _connect_to;
+    /// Guards _multi lifetime, _thread and _pending
+    std::mutex _mutex;
+    /// Submitted requests not yet added to multi handle
+    std::deque<std::unique_ptr<transfer>> _pending;
+    /// Transfers added to multi handle (engine thread only)
+    std::vector<std::unique_ptr<transfer>> _active;
+    /// Rate limited transfers and failed transfers waiting for their next attempt, by due time
+    /// (engine thread only)
+    std::multimap<std::chrono::steady_clock::time_point, std::unique_ptr<transfer>> _delayed;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_HTTP_HTTP_CLIENT_H
@@ -0,0 +1,27 @@
+#include "http_fault_injector.h"
+
+#include "../config.h"
+
+bool HttpFaultInjector::isEnabled()
+{
+    return Config::getInstance()._http_fault_injection.enabled;
+}
+
+http_injected_fault HttpFaultInjector::next()
+{
+    const auto & config = Config::getInstance()._http_fault_injection;
+    http_injected_fault injected;
+    injected.latency = config.latency;
+    if (config.jitter.count() > 0)
+    {
+        std::uniform_int_distribution<long long> dist(0, config.jitter.count());
+        injected.latency += std::chrono::milliseconds(dist(_random));
+    }
+
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    if (dist(_random) < config.error_rate)
+        injected.fault = HttpFault::ConnectError;
+    else if (dist(_random) < config.http_error_rate)
+        injected.fault = HttpFault::HttpError;
+    return injected;
+}
@@ -0,0 +1,53 @@
+#ifndef PVE_DDNS_CLIENT_SRC_HTTP_HTTP_FAULT_INJECTOR_H
+#define PVE_DDNS_CLIENT_SRC_HTTP_HTTP_FAULT_INJECTOR_H
+
+#include <chrono>
+#include <random>
+
+/// Injected outcome of a request attempt
+enum class HttpFault
+{
+    None = 0,
+    /// Fails as a connection error
+    ConnectError = 1,
+    /// Gets a 503 response
+    HttpError = 2,
+    /// Injected latency reached the attempt timeout, set by the engine rather than drawn
+    Timeout = 3,
+};
+
+/// Injected latency and outcome of a request attempt
+typedef struct http_injected_fault_
+{
+    std::chrono::milliseconds latency{ 0 };
+    HttpFault fault = HttpFault::None;
+} http_injected_fault;
+
+/// Latency and failures injected into request attempts by the HTTP engine (see Config::_http_fault_injection),
+/// so they go through the same timeouts, retries, backoff and circuit breaker as real ones. Engine thread only.
+class HttpFaultInjector
+{
+public:
+    static HttpFaultInjector & getInstance()
+    {
+        static HttpFaultInjector instance;
+        return instance;
+    }
+
+    /// \brief Check if fault injection is enabled in config
+    /// \return If enabled
+    static bool isEnabled();
+
+    /// \brief Draw latency and outcome of next request attempt
+    /// \return Injected fault
+    http_injected_fault next();
+
+private:
+    HttpFaultInjector() : _random(std::random_device()()) {}
+    HttpFaultInjector(HttpFaultInjector const &) = delete;
+    HttpFaultInjector & operator=(HttpFaultInjector const &) = delete;
+
+    std::mt19937 _random;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_HTTP_HTTP_FAULT_INJECTOR_H
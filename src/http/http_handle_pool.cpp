@@ -0,0 +1,81 @@
+#include "http_handle_pool.h"
+
+#include "spdlog/spdlog.h"
+
+#include "../config.h"
+
+HttpHandlePool::~HttpHandlePool()
+{
+    cleanup();
+}
+
+CURL * HttpHandlePool::acquire()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        evictIdleLocked(std::chrono::steady_clock::now());
+        if (!_idle.empty())
+        {
+            CURL * curl = _idle.back().curl;
+            _idle.pop_back();
+            curl_easy_reset(curl);
+            return curl;
+        }
+    }
+
+    CURL * curl = curl_easy_init();
+    if (nullptr == curl)
+        SPDLOG_ERROR("Failed to curl_easy_init!");
+    return curl;
+}
+
+void HttpHandlePool::release(CURL * curl, const bool reusable)
+{
+    if (nullptr == curl)
+        return;
+
+    const auto & cfg = Config::getInstance();
+    if (!reusable || cfg._http_pool_max_idle < 1)
+    {
+        curl_easy_cleanup(curl);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto now = std::chrono::steady_clock::now();
+    evictIdleLocked(now);
+    if (_idle.size() >= cfg._http_pool_max_idle)
+    {
+        // Oldest handle is at front
+        const auto excess = _idle.size() - cfg._http_pool_max_idle + 1;
+        for (size_t i = 0; i < excess; ++i)
+            curl_easy_cleanup(_idle[i].curl);
+        _idle.erase(_idle.begin(), _idle.begin() + static_cast<std::ptrdiff_t>(excess));
+    }
+    _idle.emplace_back(idle_handle{ curl, now });
+}
+
+void HttpHandlePool::cleanup()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto & h : _idle)
+        curl_easy_cleanup(h.curl);
+    _idle.clear();
+}
+
+void HttpHandlePool::evictIdleLocked(const std::chrono::steady_clock::time_point now)
+{
+    const auto idle_timeout = Config::getInstance()._http_pool_idle_timeout;
+    // Handles are ordered by last used time, oldest first
+    auto expired_end = _idle.begin();
+    while (expired_end != _idle.end() && now - expired_end->last_used > idle_timeout)
+    {
+        curl_easy_cleanup(expired_end->curl);
+        ++expired_end;
+    }
+    if (expired_end != _idle.begin())
+    {
+        SPDLOG_DEBUG("Evicted {} idle curl handle(s).", expired_end - _idle.begin());
+        _idle.erase(_idle.begin(), expired_end);
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef PVE_DDNS_CLIENT_SRC_HTTP_HTTP_HANDLE_POOL_H
+#define PVE_DDNS_CLIENT_SRC_HTTP_HTTP_HANDLE_POOL_H
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "curl/curl.h"
+
+/// Free list of curl easy handles, saving curl_easy_init and the buffers kept across curl_easy_reset.
+/// Handles do not own connections: transfers run on the HttpClient multi handle and share connections,
+/// DNS and TLS sessions through HttpShare, so keep-alive does not depend on this pool.
+class HttpHandlePool
+{
+public:
+    static HttpHandlePool & getInstance()
+    {
+        static HttpHandlePool instance;
+        return instance;
+    }
+
+    /// \brief Acquire an easy handle, reusing an idle one if possible
+    /// \return Easy handle with all options reset, or nullptr if failed
+    CURL * acquire();
+
+    /// \brief Release an easy handle back to pool
+    /// \param curl Easy handle
+    /// \param reusable False to close the handle instead of pooling it (e.g. after transfer error)
+    void release(CURL * curl, bool reusable);
+
+    /// \brief Close all pooled handles
+    void cleanup();
+
+private:
+    // Idle pooled handle
+    typedef struct idle_handle_
+    {
+        CURL * curl;
+        std::chrono::steady_clock::time_point last_used;
+    } idle_handle;
+
+    HttpHandlePool() = default;
+    ~HttpHandlePool();
+    HttpHandlePool(HttpHandlePool const &) = delete;
+    HttpHandlePool & operator=(HttpHandlePool const &) = delete;
+
+    void evictIdleLocked(std::chrono::steady_clock::time_point now);
+
+    /// Guards _idle
+    std::mutex _mutex;
+    /// Idle handles, most recently used at back
+    std::vector<idle_handle> _idle;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_HTTP_HTTP_HANDLE_POOL_H
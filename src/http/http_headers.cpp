@@ -0,0 +1,21 @@
+#include "http_headers.h"
+
+#include "spdlog/spdlog.h"
+
+HttpHeaders::HttpHeaders(const std::vector<std::string> & lines)
+{
+    curl_slist * list = nullptr;
+    for (const auto & line : lines)
+    {
+        curl_slist * appended = curl_slist_append(list, line.c_str());
+        if (nullptr == appended)
+        {
+            SPDLOG_WARN("curl_slist_append fail, header is '{}'!", line);
+            curl_slist_free_all(list);
+            return;
+        }
+        list = appended;
+    }
+    if (nullptr != list)
+        _list.reset(list, curl_slist_free_all);
+}
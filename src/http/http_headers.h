@@ -0,0 +1,35 @@
+#ifndef PVE_DDNS_CLIENT_SRC_HTTP_HTTP_HEADERS_H
+#define PVE_DDNS_CLIENT_SRC_HTTP_HTTP_HEADERS_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "curl/curl.h"
+
+/// \brief Immutable prebuilt curl header list, cheap to copy and safe to share between concurrent transfers
+///
+/// Services build one per credential set so the request path does not format headers or allocate a curl_slist.
+class HttpHeaders
+{
+public:
+    HttpHeaders() = default;
+
+    /// \brief Build header list
+    /// \param lines Header lines, e.g. "Authorization: Bearer xxx"
+    explicit HttpHeaders(const std::vector<std::string> & lines);
+
+    /// \brief Check if there is no header
+    /// \return If empty
+    bool empty() const { return nullptr == _list; }
+
+    /// \brief Get curl header list, must not be modified or freed
+    /// \return Header list, nullptr if empty
+    curl_slist * list() const { return _list.get(); }
+
+private:
+    /// Shared header list
+    std::shared_ptr<curl_slist> _list;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_HTTP_HTTP_HEADERS_H
@@ -0,0 +1,127 @@
+#include "http_rate_limiter.h"
+
+#include <algorithm>
+
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+
+#include "../utils.h"
+
+std::string HttpRateLimiter::getKey(const std::string & provider, const std::string & credentials)
+{
+    const std::string key = fmt::format("{}:{:x}", provider, get_dns_service_key(provider, credentials));
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_buckets.find(key) == _buckets.end())
+    {
+        const auto & limits = Config::getInstance()._http_rate_limits;
+        const auto found = limits.find(provider);
+
+        bucket b;
+        b.provider = provider;
+        if (limits.end() != found)
+            b.limit = found->second;
+        b.tokens = b.limit.burst;
+        b.last = std::chrono::steady_clock::now();
+        _buckets.emplace(key, b);
+    }
+
+    return key;
+}
+
+void HttpRateLimiter::reloadLimits()
+{
+    const auto & limits = Config::getInstance()._http_rate_limits;
+    const auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto & kv : _buckets)
+    {
+        auto & b = kv.second;
+        // Tokens earned under the old rate are settled first
+        if (b.limit.rate > 0)
+            refill(b, now);
+        const auto found = limits.find(b.provider);
+        const http_rate_limit limit = limits.end() != found ? found->second : http_rate_limit();
+        if (b.limit.rate <= 0 && limit.rate > 0)
+            b.tokens = limit.burst;
+        b.limit = limit;
+        b.tokens = std::min(b.tokens, b.limit.burst);
+        b.last = now;
+    }
+}
+
+void HttpRateLimiter::refill(bucket & b, const std::chrono::steady_clock::time_point now)
+{
+    const std::chrono::duration<double> elapsed = now - b.last;
+    b.tokens = std::min(b.limit.burst, b.tokens + elapsed.count() * b.limit.rate);
+    b.last = now;
+}
+
+std::chrono::milliseconds HttpRateLimiter::reserve(const std::string & key)
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto found = _buckets.find(key);
+    if (_buckets.end() == found)
+        return std::chrono::milliseconds(0);
+
+    auto & b = found->second;
+    std::chrono::milliseconds wait(0);
+    if (b.limit.rate > 0)
+    {
+        refill(b, now);
+        // Tokens go negative while requests are queued, each one waits for its own refill
+        b.tokens -= 1;
+        if (b.tokens < 0)
+            wait = std::chrono::milliseconds(static_cast<long long>(-b.tokens / b.limit.rate * 1000));
+    }
+    if (b.blocked_until > now)
+        wait = std::max(wait, std::chrono::duration_cast<std::chrono::milliseconds>(b.blocked_until - now));
+
+    if (wait.count() > 0)
+        SPDLOG_DEBUG("Rate limit '{}' queues request for {} ms.", key, wait.count());
+
+    return wait;
+}
+
+void HttpRateLimiter::update(const std::string & key, const long remaining, const std::chrono::milliseconds reset)
+{
+    if (remaining < 0)
+        return;
+
+    const auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto found = _buckets.find(key);
+    if (_buckets.end() == found)
+        return;
+
+    auto & b = found->second;
+    if (0 == remaining)
+    {
+        b.blocked_until = std::max(b.blocked_until, now + reset);
+        SPDLOG_WARN("Rate limit quota of '{}' exhausted, requests are held for {} ms!", key, reset.count());
+    }
+    else if (b.limit.rate > 0)
+    {
+        refill(b, now);
+        b.tokens = std::min(b.tokens, static_cast<double>(remaining));
+    }
+}
+
+void HttpRateLimiter::throttle(const std::string & key, const std::chrono::milliseconds retry_after)
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto found = _buckets.find(key);
+    if (_buckets.end() == found)
+        return;
+
+    // Without Retry-After back off for a second
+    const auto delay = retry_after.count() > 0 ? retry_after : std::chrono::milliseconds(1000);
+    found->second.blocked_until = std::max(found->second.blocked_until, now + delay);
+    SPDLOG_WARN("'{}' is rate limited by provider, requests are held for {} ms!", key, delay.count());
+}
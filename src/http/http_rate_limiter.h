@@ -0,0 +1,72 @@
+#ifndef PVE_DDNS_CLIENT_SRC_HTTP_HTTP_RATE_LIMITER_H
+#define PVE_DDNS_CLIENT_SRC_HTTP_HTTP_RATE_LIMITER_H
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "../config.h"
+
+/// Token bucket rate limiter per provider and credentials, fed by provider rate-limit response headers
+class HttpRateLimiter
+{
+public:
+    static HttpRateLimiter & getInstance()
+    {
+        static HttpRateLimiter instance;
+        return instance;
+    }
+
+    /// \brief Get bucket key of a provider account, creating the bucket with limit configured for the provider
+    /// \param provider Provider (dns service type)
+    /// \param credentials Credentials string
+    /// \return Bucket key to set as request rate_limit_key
+    std::string getKey(const std::string & provider, const std::string & credentials);
+
+    /// \brief Apply configured provider limits to existing buckets, called after config reload.
+    /// Tokens are capped at the new burst, blocks requested by providers are kept.
+    void reloadLimits();
+
+    /// \brief Take a token, requests keep their order as later ones wait behind earlier reservations
+    /// \param key Bucket key
+    /// \return How long the request has to wait before being sent
+    std::chrono::milliseconds reserve(const std::string & key);
+
+    /// \brief Update bucket from rate-limit state reported by the provider
+    /// \param key Bucket key
+    /// \param remaining Remaining requests in current window, negative if unknown
+    /// \param reset Time until window reset
+    void update(const std::string & key, long remaining, std::chrono::milliseconds reset);
+
+    /// \brief Block bucket after provider rejected a request with 429
+    /// \param key Bucket key
+    /// \param retry_after How long provider asked to wait
+    void throttle(const std::string & key, std::chrono::milliseconds retry_after);
+
+private:
+    /// Token bucket
+    typedef struct bucket_
+    {
+        /// Provider whose configured limit applies
+        std::string provider;
+        http_rate_limit limit;
+        double tokens = 0;
+        std::chrono::steady_clock::time_point last;
+        /// No request is sent before this time (provider quota exhausted)
+        std::chrono::steady_clock::time_point blocked_until;
+    } bucket;
+
+    HttpRateLimiter() = default;
+    HttpRateLimiter(HttpRateLimiter const &) = delete;
+    HttpRateLimiter & operator=(HttpRateLimiter const &) = delete;
+
+    static void refill(bucket & b, std::chrono::steady_clock::time_point now);
+
+    /// Guards _buckets
+    std::mutex _mutex;
+    /// Buckets by key
+    std::unordered_map<std::string, bucket> _buckets;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_HTTP_HTTP_RATE_LIMITER_H
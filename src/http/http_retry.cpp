@@ -0,0 +1,78 @@
+#include "http_retry.h"
+
+#include <algorithm>
+#include <random>
+
+HttpResultClass classify_http_result(const CURLcode curl_code, const int resp_code)
+{
+    switch (curl_code)
+    {
+        case CURLE_OK:
+            break;
+        case CURLE_COULDNT_RESOLVE_PROXY:
+        case CURLE_COULDNT_RESOLVE_HOST:
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_HTTP2:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_SSL_CONNECT_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_HTTP2_STREAM:
+            return HttpResultClass::Retryable;
+        default:
+            return HttpResultClass::Fatal;
+    }
+
+    switch (resp_code)
+    {
+        case 408:
+        case 429:
+        case 500:
+        case 502:
+        case 503:
+        case 504:
+            return HttpResultClass::Retryable;
+        default:
+            return resp_code < 400 ? HttpResultClass::Success : HttpResultClass::Fatal;
+    }
+}
+
+http_retry_policy get_http_retry_policy(const std::string & url)
+{
+    const auto & config = Config::getInstance();
+    if (config._http_retry_endpoints.empty())
+        return config._http_retry;
+
+    std::string host;
+    CURLU * h = curl_url();
+    if (nullptr != h)
+    {
+        char * part = nullptr;
+        if (CURLUE_OK == curl_url_set(h, CURLUPART_URL, url.c_str(), 0)
+            && CURLUE_OK == curl_url_get(h, CURLUPART_HOST, &part, 0))
+        {
+            host = part;
+            curl_free(part);
+        }
+        curl_url_cleanup(h);
+    }
+
+    const auto found = config._http_retry_endpoints.find(host);
+    return config._http_retry_endpoints.end() != found ? found->second : config._http_retry;
+}
+
+std::chrono::milliseconds get_http_retry_backoff(const http_retry_policy & policy, const int attempt)
+{
+    static thread_local std::mt19937_64 rng{ std::random_device{}() };
+
+    // Cap shift so base_delay * 2^n can not overflow
+    const int shift = std::min(std::max(attempt - 1, 0), 20);
+    const auto ceiling = std::min(policy.max_delay.count(), policy.base_delay.count() << shift);
+    if (ceiling <= 0)
+        return std::chrono::milliseconds(0);
+
+    std::uniform_int_distribution<std::chrono::milliseconds::rep> dist(0, ceiling);
+    return std::chrono::milliseconds(dist(rng));
+}
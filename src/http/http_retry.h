@@ -0,0 +1,39 @@
+#ifndef PVE_DDNS_CLIENT_SRC_HTTP_HTTP_RETRY_H
+#define PVE_DDNS_CLIENT_SRC_HTTP_HTTP_RETRY_H
+
+#include <chrono>
+#include <string>
+
+#include "curl/curl.h"
+
+#include "../config.h"
+
+/// Outcome class of a finished transfer
+enum class HttpResultClass
+{
+    /// 2xx/3xx response
+    Success,
+    /// Transient failure worth retrying (network errors, timeouts, 408, 429, 5xx)
+    Retryable,
+    /// Failure that will not go away by retrying (bad request, auth, TLS verification...)
+    Fatal,
+};
+
+/// \brief Classify transfer result
+/// \param curl_code curl result code
+/// \param resp_code HTTP response code (only checked if curl_code is CURLE_OK)
+/// \return Result class
+HttpResultClass classify_http_result(CURLcode curl_code, int resp_code);
+
+/// \brief Get retry policy configured for the URL host, default policy if none
+/// \param url URL
+/// \return Retry policy
+http_retry_policy get_http_retry_policy(const std::string & url);
+
+/// \brief Exponential backoff with full jitter, uniformly random in [0, min(max_delay, base_delay * 2^(attempt-1))]
+/// \param policy Retry policy
+/// \param attempt Number of failed attempts so far (starting from 1)
+/// \return Delay before next attempt
+std::chrono::milliseconds get_http_retry_backoff(const http_retry_policy & policy, int attempt);
+
+#endif //PVE_DDNS_CLIENT_SRC_HTTP_HTTP_RETRY_H
@@ -0,0 +1,99 @@
+#include "http_share.h"
+
+#include "spdlog/spdlog.h"
+
+#include "../config.h"
+
+bool HttpShare::init()
+{
+    if (nullptr != _share)
+    {
+        SPDLOG_WARN("Share object already inited!");
+        return true;
+    }
+
+    _share = curl_share_init();
+    if (nullptr == _share)
+    {
+        SPDLOG_ERROR("Failed to curl_share_init!");
+        return false;
+    }
+
+    curl_share_setopt(_share, CURLSHOPT_LOCKFUNC, lock);
+    curl_share_setopt(_share, CURLSHOPT_UNLOCKFUNC, unlock);
+    curl_share_setopt(_share, CURLSHOPT_USERDATA, static_cast<void *>(this));
+
+    const curl_lock_data shared_data[] = {
+        CURL_LOCK_DATA_DNS, CURL_LOCK_DATA_SSL_SESSION, CURL_LOCK_DATA_CONNECT
+    };
+    for (const auto data : shared_data)
+    {
+        const CURLSHcode ret = curl_share_setopt(_share, CURLSHOPT_SHARE, data);
+        if (CURLSHE_OK != ret)
+            SPDLOG_WARN("Failed to share curl lock data '{}', error is '{}'!",
+                        static_cast<int>(data), curl_share_strerror(ret));
+    }
+
+    // Resolve CA bundle path once, curl then keeps the parsed store cached in memory
+    _ca_file = Config::getInstance()._http_ca_file;
+#if LIBCURL_VERSION_NUM >= 0x075400
+    if (_ca_file.empty())
+    {
+        CURL * curl = curl_easy_init();
+        if (nullptr != curl)
+        {
+            char * ca_info = nullptr;
+            if (CURLE_OK == curl_easy_getinfo(curl, CURLINFO_CAINFO, &ca_info) && nullptr != ca_info)
+                _ca_file = ca_info;
+            curl_easy_cleanup(curl);
+        }
+    }
+#endif
+    SPDLOG_INFO("HTTP share inited, CA bundle '{}'.", _ca_file.empty() ? "<built-in>" : _ca_file);
+
+    return true;
+}
+
+void HttpShare::cleanup()
+{
+    if (nullptr == _share)
+        return;
+
+    const CURLSHcode ret = curl_share_cleanup(_share);
+    if (CURLSHE_OK != ret)
+        SPDLOG_WARN("Failed to curl_share_cleanup, error is '{}'!", curl_share_strerror(ret));
+    _share = nullptr;
+}
+
+void HttpShare::apply(CURL * curl) const
+{
+    if (nullptr == curl)
+        return;
+
+    if (nullptr != _share)
+        curl_easy_setopt(curl, CURLOPT_SHARE, _share);
+    if (!_ca_file.empty())
+        curl_easy_setopt(curl, CURLOPT_CAINFO, _ca_file.c_str());
+#if LIBCURL_VERSION_NUM >= 0x075700
+    // Parsed CA store is kept in memory and reused instead of re-reading the bundle for every new connection
+    const auto ca_cache_timeout = std::chrono::duration_cast<std::chrono::seconds>(
+        Config::getInstance()._http_ca_cache_timeout);
+    curl_easy_setopt(curl, CURLOPT_CA_CACHE_TIMEOUT, static_cast<long>(ca_cache_timeout.count()));
+#endif
+}
+
+void HttpShare::lock(CURL * /*handle*/, const curl_lock_data data, curl_lock_access /*access*/, void * userptr)
+{
+    auto * self = static_cast<HttpShare *>(userptr);
+    if (nullptr == self || data < 0 || data >= CURL_LOCK_DATA_LAST)
+        return;
+    self->_locks[data].lock();
+}
+
+void HttpShare::unlock(CURL * /*handle*/, const curl_lock_data data, void * userptr)
+{
+    auto * self = static_cast<HttpShare *>(userptr);
+    if (nullptr == self || data < 0 || data >= CURL_LOCK_DATA_LAST)
+        return;
+    self->_locks[data].unlock();
+}
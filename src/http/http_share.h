@@ -0,0 +1,46 @@
+#ifndef PVE_DDNS_CLIENT_SRC_HTTP_HTTP_SHARE_H
+#define PVE_DDNS_CLIENT_SRC_HTTP_HTTP_SHARE_H
+
+#include <mutex>
+#include <string>
+
+#include "curl/curl.h"
+
+/// Process-wide curl share object (DNS cache, TLS session cache, connection cache) and CA store settings
+class HttpShare
+{
+public:
+    static HttpShare & getInstance()
+    {
+        static HttpShare instance;
+        return instance;
+    }
+
+    /// \brief Create the share object and resolve CA bundle, must be called after curl_global_init
+    /// \return Operation result
+    bool init();
+
+    /// \brief Release the share object, all easy handles using it must be cleaned up first
+    void cleanup();
+
+    /// \brief Attach share object and CA store options to an easy handle
+    /// \param curl Easy handle
+    void apply(CURL * curl) const;
+
+private:
+    HttpShare() = default;
+    HttpShare(HttpShare const &) = delete;
+    HttpShare & operator=(HttpShare const &) = delete;
+
+    static void lock(CURL * handle, curl_lock_data data, curl_lock_access access, void * userptr);
+    static void unlock(CURL * handle, curl_lock_data data, void * userptr);
+
+    /// Share handle
+    CURLSH * _share = nullptr;
+    /// One lock per shared data type
+    std::mutex _locks[CURL_LOCK_DATA_LAST];
+    /// CA bundle file path, empty to use curl built-in default
+    std::string _ca_file;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_HTTP_HTTP_SHARE_H
@@ -0,0 +1,64 @@
+#include "http_stats.h"
+
+#include <algorithm>
+
+#include "fmt/format.h"
+
+void HttpStats::record(const std::string & name, const http_request_timing & timing)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    http_endpoint_stats & s = _stats[name];
+    ++s.requests;
+    if (timing.failed)
+        ++s.failures;
+    if (timing.reused)
+        ++s.reused;
+    s.bytes_sent += timing.bytes_sent;
+    s.bytes_received += timing.bytes_received;
+    s.dns += timing.dns;
+    s.connect += timing.connect;
+    s.tls += timing.tls;
+    s.first_byte += timing.first_byte;
+    s.total += timing.total;
+    s.max_total = std::max(s.max_total, timing.total);
+}
+
+bool HttpStats::get(const std::string & name, http_endpoint_stats & out_stats) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto found = _stats.find(name);
+    if (_stats.end() == found)
+        return false;
+    out_stats = found->second;
+    return true;
+}
+
+std::map<std::string, http_endpoint_stats> HttpStats::getAll() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+std::string HttpStats::dump() const
+{
+    // Average of a summed duration in milliseconds
+    const auto avg_ms = [](const std::chrono::microseconds sum, const uint64_t count)
+    {
+        return static_cast<double>(sum.count()) / 1000.0 / static_cast<double>(count);
+    };
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::string result;
+    for (const auto & item : _stats)
+    {
+        const auto & s = item.second;
+        result.append(fmt::format(
+            "{} requests={} failures={} reused={} avg_ms(dns={:.1f} connect={:.1f} tls={:.1f} ttfb={:.1f} "
+            "total={:.1f}) max_total_ms={:.1f} sent={} received={}",
+            item.first, s.requests, s.failures, s.reused, avg_ms(s.dns, s.requests),
+            avg_ms(s.connect, s.requests), avg_ms(s.tls, s.requests), avg_ms(s.first_byte, s.requests),
+            avg_ms(s.total, s.requests), avg_ms(s.max_total, 1), s.bytes_sent, s.bytes_received));
+        result.push_back('\n');
+    }
+    return result;
+}
@@ -0,0 +1,82 @@
+#ifndef PVE_DDNS_CLIENT_SRC_HTTP_HTTP_STATS_H
+#define PVE_DDNS_CLIENT_SRC_HTTP_HTTP_STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+/// Timings and sizes of one request attempt, phase durations are not cumulative
+typedef struct http_request_timing_
+{
+    std::chrono::microseconds dns{ 0 };
+    std::chrono::microseconds connect{ 0 };
+    std::chrono::microseconds tls{ 0 };
+    /// From transfer start to first response byte
+    std::chrono::microseconds first_byte{ 0 };
+    std::chrono::microseconds total{ 0 };
+    uint64_t bytes_sent = 0;
+    uint64_t bytes_received = 0;
+    bool reused = false;
+    bool failed = false;
+} http_request_timing;
+
+/// Aggregated timings of a logical endpoint, durations are sums over all requests
+typedef struct http_endpoint_stats_
+{
+    uint64_t requests = 0;
+    uint64_t failures = 0;
+    /// Requests sent over a reused connection
+    uint64_t reused = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t bytes_received = 0;
+    std::chrono::microseconds dns{ 0 };
+    std::chrono::microseconds connect{ 0 };
+    std::chrono::microseconds tls{ 0 };
+    std::chrono::microseconds first_byte{ 0 };
+    std::chrono::microseconds total{ 0 };
+    std::chrono::microseconds max_total{ 0 };
+} http_endpoint_stats;
+
+/// Per request phase timings aggregated by logical endpoint, e.g. "cloudflare.patch_record"
+class HttpStats
+{
+public:
+    static HttpStats & getInstance()
+    {
+        static HttpStats instance;
+        return instance;
+    }
+
+    /// \brief Record a request attempt
+    /// \param name Logical endpoint name
+    /// \param timing Timings of the attempt
+    void record(const std::string & name, const http_request_timing & timing);
+
+    /// \brief Get stats of a logical endpoint
+    /// \param name Logical endpoint name
+    /// \param out_stats Stats
+    /// \return If endpoint has any request recorded
+    bool get(const std::string & name, http_endpoint_stats & out_stats) const;
+
+    /// \brief Get stats of all logical endpoints
+    /// \return Stats by endpoint name
+    std::map<std::string, http_endpoint_stats> getAll() const;
+
+    /// \brief Dump averages of all logical endpoints sorted by name
+    /// \return One line per endpoint
+    std::string dump() const;
+
+private:
+    HttpStats() = default;
+    HttpStats(HttpStats const &) = delete;
+    HttpStats & operator=(HttpStats const &) = delete;
+
+    /// Guards _stats
+    mutable std::mutex _mutex;
+    /// Stats by endpoint name
+    std::map<std::string, http_endpoint_stats> _stats;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_HTTP_HTTP_STATS_H
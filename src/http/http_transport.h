@@ -0,0 +1,26 @@
+#ifndef PVE_DDNS_CLIENT_SRC_HTTP_HTTP_TRANSPORT_H
+#define PVE_DDNS_CLIENT_SRC_HTTP_HTTP_TRANSPORT_H
+
+#include <memory>
+
+#include "http_client.h"
+
+/// HTTP transport interface, injected into every service issuing HTTP requests
+class IHttpTransport
+{
+public:
+    virtual ~IHttpTransport() = default;
+
+    /// \brief Submit request, callback is called on completion (possibly on another thread, it must not block)
+    /// \param req Request
+    /// \param cb Completion callback
+    virtual void request(http_request req, http_callback cb) = 0;
+
+    /// \brief Blocking request
+    /// \param req Request
+    /// \param resp Response
+    /// \return If transfer succeeded
+    virtual bool perform(http_request req, http_response & resp) = 0;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_HTTP_HTTP_TRANSPORT_H
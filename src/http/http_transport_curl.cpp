@@ -0,0 +1,11 @@
+#include "http_transport_curl.h"
+
+void HttpTransportCurl::request(http_request req, http_callback cb)
+{
+    HttpClient::getInstance().request(std::move(req), std::move(cb));
+}
+
+bool HttpTransportCurl::perform(http_request req, http_response & resp)
+{
+    return HttpClient::getInstance().perform(std::move(req), resp);
+}
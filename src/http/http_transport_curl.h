@@ -0,0 +1,14 @@
+#ifndef PVE_DDNS_CLIENT_SRC_HTTP_HTTP_TRANSPORT_CURL_H
+#define PVE_DDNS_CLIENT_SRC_HTTP_HTTP_TRANSPORT_CURL_H
+
+#include "http_transport.h"
+
+/// Transport over the curl_multi engine (HttpClient)
+class HttpTransportCurl : public IHttpTransport
+{
+public:
+    void request(http_request req, http_callback cb) override;
+    bool perform(http_request req, http_response & resp) override;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_HTTP_HTTP_TRANSPORT_CURL_H
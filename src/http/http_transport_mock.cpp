@@ -0,0 +1,81 @@
+#include "http_transport_mock.h"
+
+void HttpTransportMock::setRoute(const std::string & method, const std::string & url_prefix,
+                                 http_mock_handler handler)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _routes.push_back({ method, url_prefix, std::move(handler) });
+}
+
+void HttpTransportMock::setRoute(const std::string & method, const std::string & url_prefix,
+                                 const http_mock_response & resp)
+{
+    setRoute(method, url_prefix, [resp](const http_request &) { return resp; });
+}
+
+void HttpTransportMock::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _routes.clear();
+    _calls.clear();
+}
+
+std::vector<http_mock_call> HttpTransportMock::getCalls() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _calls;
+}
+
+void HttpTransportMock::request(http_request req, http_callback cb)
+{
+    http_response resp;
+    perform(std::move(req), resp);
+    if (cb)
+        cb(resp);
+}
+
+bool HttpTransportMock::perform(http_request req, http_response & resp)
+{
+    // Same defaults the engine applies, an empty method is GET or POST depending on body
+    const std::string method = !req.method.empty() ? req.method : (req.body.empty() ? "get" : "post");
+
+    http_mock_handler handler;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _calls.push_back({ method, req.url, req.body });
+        size_t best_len = 0;
+        for (const auto & r : _routes)
+        {
+            if ((!r.method.empty() && r.method != method)
+                || 0 != req.url.compare(0, r.url_prefix.length(), r.url_prefix))
+                continue;
+            if (!handler || r.url_prefix.length() >= best_len)
+            {
+                handler = r.handler;
+                best_len = r.url_prefix.length();
+            }
+        }
+    }
+
+    resp = http_response();
+    if (!handler)
+    {
+        resp.curl_code = CURLE_COULDNT_CONNECT;
+        resp.error = "No mock route";
+        return false;
+    }
+
+    http_mock_response mock_resp = handler(req);
+    resp.curl_code = mock_resp.curl_code;
+    resp.code = CURLE_OK == mock_resp.curl_code ? mock_resp.code : 0;
+    if (CURLE_OK != mock_resp.curl_code)
+        resp.error = curl_easy_strerror(mock_resp.curl_code);
+    resp.body = std::move(mock_resp.body);
+    if (!req.cache_key.empty())
+    {
+        resp.etag = std::move(mock_resp.etag);
+        resp.last_modified = std::move(mock_resp.last_modified);
+    }
+    HttpClient::deliverBody(req, resp);
+    return resp.ok;
+}
@@ -0,0 +1,76 @@
+#ifndef PVE_DDNS_CLIENT_SRC_HTTP_HTTP_TRANSPORT_MOCK_H
+#define PVE_DDNS_CLIENT_SRC_HTTP_HTTP_TRANSPORT_MOCK_H
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "http_transport.h"
+
+/// Canned response of a mock route
+typedef struct http_mock_response_
+{
+    /// curl result code, anything but CURLE_OK fails the transfer
+    CURLcode curl_code = CURLE_OK;
+    int code = 200;
+    std::string body;
+    std::string etag;
+    std::string last_modified;
+} http_mock_response;
+
+/// Request received by the mock transport
+typedef struct http_mock_call_
+{
+    std::string method;
+    std::string url;
+    std::string body;
+} http_mock_call;
+
+/// Mock route handler
+using http_mock_handler = std::function<http_mock_response(const http_request & req)>;
+
+/// In-process transport serving requests from registered routes, nothing is sent.
+/// Requests complete on the calling thread.
+class HttpTransportMock : public IHttpTransport
+{
+public:
+    /// \brief Register route, the longest matching URL prefix wins
+    /// \param method Method name in lower case, empty matches any
+    /// \param url_prefix URL prefix
+    /// \param handler Response handler
+    void setRoute(const std::string & method, const std::string & url_prefix, http_mock_handler handler);
+
+    /// \brief Register route with a fixed response
+    /// \param method Method name in lower case, empty matches any
+    /// \param url_prefix URL prefix
+    /// \param resp Response
+    void setRoute(const std::string & method, const std::string & url_prefix, const http_mock_response & resp);
+
+    /// \brief Remove all routes and received requests
+    void clear();
+
+    /// \brief Get requests received so far
+    /// \return Received requests in order
+    std::vector<http_mock_call> getCalls() const;
+
+    void request(http_request req, http_callback cb) override;
+    bool perform(http_request req, http_response & resp) override;
+
+private:
+    typedef struct route_
+    {
+        std::string method;
+        std::string url_prefix;
+        http_mock_handler handler;
+    } route;
+
+    /// Guards _routes and _calls
+    mutable std::mutex _mutex;
+    /// Registered routes
+    std::vector<route> _routes;
+    /// Received requests
+    std::vector<http_mock_call> _calls;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_HTTP_HTTP_TRANSPORT_MOCK_H
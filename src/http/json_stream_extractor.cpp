@@ -0,0 +1,420 @@
+#include "json_stream_extractor.h"
+
+#include <cctype>
+#include <cstring>
+
+#include "fmt/format.h"
+
+// Max nesting depth of objects/arrays
+static constexpr size_t MAX_DEPTH = 256;
+// Max length of number/true/false/null literal
+static constexpr size_t MAX_LITERAL_LEN = 256;
+
+static bool is_ws(const char c)
+{
+    return ' ' == c || '\t' == c || '\n' == c || '\r' == c;
+}
+
+static int hex_value(const char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Check literal against JSON number grammar: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+static bool is_json_number(const std::string & s)
+{
+    size_t i = 0;
+    const size_t n = s.length();
+    if (i < n && '-' == s[i])
+        ++i;
+    if (i >= n || !std::isdigit(static_cast<unsigned char>(s[i])))
+        return false;
+    if ('0' == s[i])
+        ++i;
+    else
+        while (i < n && std::isdigit(static_cast<unsigned char>(s[i])))
+            ++i;
+    if (i < n && '.' == s[i])
+    {
+        ++i;
+        if (i >= n || !std::isdigit(static_cast<unsigned char>(s[i])))
+            return false;
+        while (i < n && std::isdigit(static_cast<unsigned char>(s[i])))
+            ++i;
+    }
+    if (i < n && ('e' == s[i] || 'E' == s[i]))
+    {
+        ++i;
+        if (i < n && ('+' == s[i] || '-' == s[i]))
+            ++i;
+        if (i >= n || !std::isdigit(static_cast<unsigned char>(s[i])))
+            return false;
+        while (i < n && std::isdigit(static_cast<unsigned char>(s[i])))
+            ++i;
+    }
+    return i == n;
+}
+
+void JsonStreamExtractor::onValue(const std::string & path, value_handler handler)
+{
+    _value_handlers[path] = std::move(handler);
+}
+
+void JsonStreamExtractor::onEnd(const std::string & path, end_handler handler)
+{
+    _end_handlers[path] = std::move(handler);
+}
+
+bool JsonStreamExtractor::feed(const char * data, const size_t len)
+{
+    if (State::Error == _state)
+        return false;
+    if (nullptr == data)
+        return 0 == len;
+
+    for (size_t i = 0; i < len; ++i, ++_offset)
+    {
+        if (!step(data[i]))
+            return false;
+    }
+    return true;
+}
+
+bool JsonStreamExtractor::finish()
+{
+    if (State::Error == _state)
+        return false;
+    // A number/literal at document root is only terminated by end of input
+    if (State::Literal == _state && !finishLiteral())
+        return false;
+    if (State::Done != _state)
+        return fail("Unexpected end of document");
+    return true;
+}
+
+void JsonStreamExtractor::reset()
+{
+    _state = State::Value;
+    _stack.clear();
+    _path.clear();
+    _token.clear();
+    _in_key = false;
+    _capture = false;
+    _unicode = 0;
+    _unicode_digits = 0;
+    _high_surrogate = 0;
+    _offset = 0;
+    _error.clear();
+}
+
+bool JsonStreamExtractor::step(const char c)
+{
+    switch (_state)
+    {
+    case State::Value:
+        if (is_ws(c))
+            return true;
+        return beginValue(c);
+
+    case State::ObjectKeyOrEnd:
+    case State::ObjectKey:
+        if (is_ws(c))
+            return true;
+        if ('}' == c && State::ObjectKeyOrEnd == _state)
+            return endContainer(false);
+        if ('"' != c)
+            return fail("Expected object key");
+        // Keys are always copied as they extend the path
+        _in_key = true;
+        _capture = true;
+        _token.clear();
+        _state = State::String;
+        return true;
+
+    case State::Colon:
+        if (is_ws(c))
+            return true;
+        if (':' != c)
+            return fail("Expected ':'");
+        _state = State::Value;
+        return true;
+
+    case State::ObjectCommaOrEnd:
+        if (is_ws(c))
+            return true;
+        if (',' == c)
+        {
+            _state = State::ObjectKey;
+            return true;
+        }
+        if ('}' == c)
+            return endContainer(false);
+        return fail("Expected ',' or '}'");
+
+    case State::ArrayValueOrEnd:
+        if (is_ws(c))
+            return true;
+        if (']' == c)
+            return endContainer(true);
+        return beginValue(c);
+
+    case State::ArrayCommaOrEnd:
+        if (is_ws(c))
+            return true;
+        if (',' == c)
+        {
+            _state = State::Value;
+            return true;
+        }
+        if (']' == c)
+            return endContainer(true);
+        return fail("Expected ',' or ']'");
+
+    case State::String:
+        if (0 != _high_surrogate && '\\' != c)
+            return fail("Invalid surrogate pair");
+        if ('"' == c)
+        {
+            if (_in_key)
+            {
+                const frame & top = _stack.back();
+                _path.resize(top.path_len);
+                if (!_path.empty())
+                    _path.push_back('.');
+                _path.append(_token);
+                _token.clear();
+                _in_key = false;
+                _state = State::Colon;
+            }
+            else
+                endScalar(JsonValueType::String);
+            return true;
+        }
+        if ('\\' == c)
+        {
+            _state = State::StringEscape;
+            return true;
+        }
+        if (static_cast<unsigned char>(c) < 0x20)
+            return fail("Control character in string");
+        if (_capture)
+            _token.push_back(c);
+        return true;
+
+    case State::StringEscape:
+    {
+        if (0 != _high_surrogate && 'u' != c)
+            return fail("Invalid surrogate pair");
+        char unescaped = 0;
+        switch (c)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            unescaped = c;
+            break;
+        case 'b':
+            unescaped = '\b';
+            break;
+        case 'f':
+            unescaped = '\f';
+            break;
+        case 'n':
+            unescaped = '\n';
+            break;
+        case 'r':
+            unescaped = '\r';
+            break;
+        case 't':
+            unescaped = '\t';
+            break;
+        case 'u':
+            _unicode = 0;
+            _unicode_digits = 0;
+            _state = State::StringUnicode;
+            return true;
+        default:
+            return fail("Invalid escape sequence");
+        }
+        if (_capture)
+            _token.push_back(unescaped);
+        _state = State::String;
+        return true;
+    }
+
+    case State::StringUnicode:
+    {
+        const int v = hex_value(c);
+        if (v < 0)
+            return fail("Invalid unicode escape");
+        _unicode = (_unicode << 4) | static_cast<unsigned>(v);
+        if (++_unicode_digits < 4)
+            return true;
+        _state = State::String;
+        return appendUnicode();
+    }
+
+    case State::Literal:
+        if (std::isalnum(static_cast<unsigned char>(c)) || '+' == c || '-' == c || '.' == c)
+        {
+            if (_token.length() >= MAX_LITERAL_LEN)
+                return fail("Literal too long");
+            _token.push_back(c);
+            return true;
+        }
+        if (!finishLiteral())
+            return false;
+        // Delimiter belongs to the enclosing container
+        return step(c);
+
+    case State::Done:
+        if (is_ws(c))
+            return true;
+        return fail("Trailing characters after document");
+
+    case State::Error:
+    default:
+        return false;
+    }
+}
+
+bool JsonStreamExtractor::beginValue(const char c)
+{
+    switch (c)
+    {
+    case '{':
+        if (_stack.size() >= MAX_DEPTH)
+            return fail("Max nesting depth exceeded");
+        _stack.emplace_back(frame{ false, _path.length() });
+        _state = State::ObjectKeyOrEnd;
+        return true;
+    case '[':
+        if (_stack.size() >= MAX_DEPTH)
+            return fail("Max nesting depth exceeded");
+        _stack.emplace_back(frame{ true, _path.length() });
+        _path.append("[]");
+        _state = State::ArrayValueOrEnd;
+        return true;
+    case '"':
+        _in_key = false;
+        // Unregistered string values are skipped without copying
+        _capture = _value_handlers.find(_path) != _value_handlers.end();
+        _token.clear();
+        _state = State::String;
+        return true;
+    default:
+        if ('-' == c || std::isalnum(static_cast<unsigned char>(c)))
+        {
+            _token.assign(1, c);
+            _state = State::Literal;
+            return true;
+        }
+        return fail("Unexpected character");
+    }
+}
+
+void JsonStreamExtractor::endScalar(const JsonValueType type)
+{
+    auto found = _value_handlers.find(_path);
+    if (_value_handlers.end() != found && found->second)
+        found->second(_token, type);
+    _token.clear();
+    _capture = false;
+    afterValue();
+}
+
+bool JsonStreamExtractor::endContainer(const bool is_array)
+{
+    if (_stack.empty() || _stack.back().is_array != is_array)
+        return fail("Mismatched bracket");
+
+    _path.resize(_stack.back().path_len);
+    _stack.pop_back();
+
+    auto found = _end_handlers.find(_path);
+    if (_end_handlers.end() != found && found->second)
+        found->second();
+    afterValue();
+    return true;
+}
+
+void JsonStreamExtractor::afterValue()
+{
+    if (_stack.empty())
+        _state = State::Done;
+    else
+        _state = _stack.back().is_array ? State::ArrayCommaOrEnd : State::ObjectCommaOrEnd;
+}
+
+bool JsonStreamExtractor::finishLiteral()
+{
+    JsonValueType type = JsonValueType::Number;
+    if ("true" == _token || "false" == _token)
+        type = JsonValueType::Bool;
+    else if ("null" == _token)
+        type = JsonValueType::Null;
+    else if (!is_json_number(_token))
+        return fail("Invalid literal");
+
+    endScalar(type);
+    return true;
+}
+
+bool JsonStreamExtractor::appendUnicode()
+{
+    unsigned cp = _unicode;
+    if (0 != _high_surrogate)
+    {
+        if (cp < 0xDC00 || cp > 0xDFFF)
+            return fail("Invalid surrogate pair");
+        cp = 0x10000 + ((_high_surrogate - 0xD800) << 10) + (cp - 0xDC00);
+        _high_surrogate = 0;
+    }
+    else if (cp >= 0xD800 && cp <= 0xDBFF)
+    {
+        // Wait for low surrogate
+        _high_surrogate = cp;
+        return true;
+    }
+    else if (cp >= 0xDC00 && cp <= 0xDFFF)
+        return fail("Invalid surrogate pair");
+
+    if (!_capture)
+        return true;
+
+    // Encode code point as UTF-8
+    if (cp < 0x80)
+        _token.push_back(static_cast<char>(cp));
+    else if (cp < 0x800)
+    {
+        _token.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        _token.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else if (cp < 0x10000)
+    {
+        _token.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        _token.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        _token.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else
+    {
+        _token.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        _token.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        _token.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        _token.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    return true;
+}
+
+bool JsonStreamExtractor::fail(const char * reason)
+{
+    _state = State::Error;
+    _error = fmt::format("{} at offset {}", reason, _offset);
+    return false;
+}
@@ -0,0 +1,123 @@
+#ifndef PVE_DDNS_CLIENT_SRC_HTTP_JSON_STREAM_EXTRACTOR_H
+#define PVE_DDNS_CLIENT_SRC_HTTP_JSON_STREAM_EXTRACTOR_H
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// JSON scalar value type
+enum class JsonValueType
+{
+    String,
+    Number,
+    Bool,
+    Null
+};
+
+/// \brief Incremental (push) JSON parser extracting values of registered paths without building a DOM
+///
+/// Chunks are fed as they arrive, only values of registered paths are copied out.
+/// Path syntax: object keys joined by '.', array elements as '[]',
+/// e.g. "data.result[].ip-addresses[].ip-address".
+class JsonStreamExtractor
+{
+public:
+    /// Called with each scalar value found at a registered path
+    using value_handler = std::function<void(const std::string & value, JsonValueType type)>;
+    /// Called when an object or array at a registered path ends
+    using end_handler = std::function<void()>;
+
+    /// \brief Register handler for scalar values at path
+    /// \param path JSON path
+    /// \param handler Value handler
+    void onValue(const std::string & path, value_handler handler);
+
+    /// \brief Register handler for end of object/array at path, e.g. "data.result[]" for each element of result
+    /// \param path JSON path
+    /// \param handler End handler
+    void onEnd(const std::string & path, end_handler handler);
+
+    /// \brief Feed next chunk of JSON text
+    /// \param data Chunk data
+    /// \param len Chunk length
+    /// \return False if a syntax error occurred
+    bool feed(const char * data, size_t len);
+
+    /// \brief Finish parsing
+    /// \return If a complete and valid JSON document has been fed
+    bool finish();
+
+    /// \brief Reset parse state, registered handlers are kept
+    void reset();
+
+    /// \brief Check if a complete and valid JSON document has been parsed
+    /// \return Result
+    bool isComplete() const { return State::Done == _state; }
+
+    /// \brief Get error description of last failure
+    /// \return Error string
+    const std::string & error() const { return _error; }
+
+private:
+    enum class State
+    {
+        Value,
+        ObjectKeyOrEnd,
+        ObjectKey,
+        Colon,
+        ObjectCommaOrEnd,
+        ArrayValueOrEnd,
+        ArrayCommaOrEnd,
+        String,
+        StringEscape,
+        StringUnicode,
+        Literal,
+        Done,
+        Error
+    };
+
+    // Open object/array
+    typedef struct frame_
+    {
+        bool is_array;
+        size_t path_len;
+    } frame;
+
+    bool step(char c);
+    bool beginValue(char c);
+    void endScalar(JsonValueType type);
+    bool endContainer(bool is_array);
+    void afterValue();
+    bool finishLiteral();
+    bool appendUnicode();
+    bool fail(const char * reason);
+
+    /// Registered value handlers
+    std::unordered_map<std::string, value_handler> _value_handlers;
+    /// Registered end handlers
+    std::unordered_map<std::string, end_handler> _end_handlers;
+
+    /// Parse state
+    State _state = State::Value;
+    /// Open containers
+    std::vector<frame> _stack;
+    /// Current path
+    std::string _path;
+    /// Current string/literal text (only filled for keys and captured values)
+    std::string _token;
+    /// If current string is an object key
+    bool _in_key = false;
+    /// If current value is copied out
+    bool _capture = false;
+    /// Pending \uXXXX code unit and high surrogate
+    unsigned _unicode = 0;
+    unsigned _unicode_digits = 0;
+    unsigned _high_surrogate = 0;
+    /// Bytes consumed, for error reporting
+    size_t _offset = 0;
+    /// Error description
+    std::string _error;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_HTTP_JSON_STREAM_EXTRACTOR_H
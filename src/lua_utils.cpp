@@ -5,6 +5,7 @@
 
 #include "config.h"
 #include "utils.h"
+#include "http/http_transport.h"
 
 extern "C" int luaopen_rapidjson(lua_State * L);
 
@@ -89,7 +90,7 @@ end)|";
     return true;
 }
 
-static int http_request(lua_State * ls)
+static int http_request_lua(lua_State * ls)
 {
     std::string req_url, req_body;
     std::vector<std::string> req_headers;
@@ -112,9 +113,13 @@ static int http_request(lua_State * ls)
         }
     }
 
+    // Transport of the module is bound as upvalue by lua_open_http_api
+    auto * transport = static_cast<IHttpTransport *>(lua_touserdata(ls, lua_upvalueindex(1)));
+
     int resp_code = 0;
     std::string resp_data;
-    bool ret = http_req(req_url, req_body, Config::getInstance()._http_timeout_ms, req_headers, resp_code, resp_data);
+    bool ret = http_req(*transport, req_url, req_body, Config::getInstance()._http_timeouts.total.count(), req_headers,
+                        resp_code, resp_data);
 
     lua_pushboolean(ls, ret);
     lua_pushinteger(ls, resp_code);
@@ -123,21 +128,22 @@ static int http_request(lua_State * ls)
     return 3;
 }
 
-bool lua_open_http_api(lua_State * ls)
+bool lua_open_http_api(lua_State * ls, IHttpTransport * transport)
 {
-    if (nullptr == ls)
+    if (nullptr == ls || nullptr == transport)
     {
-        SPDLOG_WARN("Invalid param ls!");
+        SPDLOG_WARN("Invalid param ls or transport!");
         return false;
     }
 
-    lua_pushcfunction(ls, http_request);
+    lua_pushlightuserdata(ls, transport);
+    lua_pushcclosure(ls, http_request_lua, 1);
     lua_setglobal(ls, "http_request");
 
     return true;
 }
 
-lua_State * lua_init_module(const std::string & module_path)
+lua_State * lua_init_module(const std::string & module_path, IHttpTransport * transport)
 {
     auto * ls = luaL_newstate();
     if (nullptr == ls)
@@ -154,7 +160,7 @@ lua_State * lua_init_module(const std::string & module_path)
         return nullptr;
     }
 
-    if (!lua_open_http_api(ls))
+    if (!lua_open_http_api(ls, transport))
     {
         lua_close(ls);
         SPDLOG_WARN("Failed to lua_open_http_api for module {}!", module_path);
@@ -182,9 +188,9 @@ void lua_uninit_module(lua_State * ls)
         lua_close(ls);
 }
 
-lua_State * lua_load_module(const std::string & type, const std::string & module_path)
+lua_State * lua_load_module(const std::string & type, const std::string & module_path, IHttpTransport * transport)
 {
-    auto * ls = lua_init_module(module_path);
+    auto * ls = lua_init_module(module_path, transport);
     if (nullptr == ls)
     {
         SPDLOG_WARN("Failed to lua_init_module {}", module_path);
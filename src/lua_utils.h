@@ -5,6 +5,7 @@
 // #include <utility>
 
 typedef struct lua_State lua_State;
+class IHttpTransport;
 
 /// \brief spdlog API LUA binding
 /// \param ls lua_State*
@@ -13,13 +14,15 @@ bool lua_open_log_api(lua_State * ls);
 
 /// \brief HTTP request API LUA binding
 /// \param ls lua_State*
+/// \param transport HTTP transport requests are sent through, it must outlive ls
 /// \return Boolean result
-bool lua_open_http_api(lua_State * ls);
+bool lua_open_http_api(lua_State * ls, IHttpTransport * transport);
 
 /// \brief Load a LUA service module
 /// \param module_path Full path to .lua file
+/// \param transport HTTP transport of the module, it must outlive the module
 /// \return On success return lua_State*, otherwise return nullptr
-lua_State * lua_init_module(const std::string & module_path);
+lua_State * lua_init_module(const std::string & module_path, IHttpTransport * transport);
 
 /// \brief Unload LUA service module instance
 /// \param ls lua_State* of the loaded module
@@ -28,8 +31,9 @@ void lua_uninit_module(lua_State * ls);
 /// \brief Load LUA module helper function
 /// \param type Type string used for logging
 /// \param module_path Full path to .lua file
+/// \param transport HTTP transport of the module, it must outlive the module
 /// \return On success return lua_State*, otherwise return nullptr
-lua_State * lua_load_module(const std::string & type, const std::string & module_path);
+lua_State * lua_load_module(const std::string & type, const std::string & module_path, IHttpTransport * transport);
 
 /// \brief Set credentials for a loaded LUA module
 /// \param ls lua_State*
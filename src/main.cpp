@@ -1,13 +1,11 @@
+#include <algorithm>
+#include <atomic>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <unordered_map>
 
-//#ifdef WIN32
-//#include <windows.h>
-//#else
-//#include <signal.h>
-//#endif
-
 #include "fmt/format.h"
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
@@ -17,14 +15,29 @@
 
 #include "config.h"
 #include "utils.h"
+#include "metrics.h"
+#include "netlink_addr_watcher.h"
+#include "signal_waiter.h"
+#include "http/http_client.h"
+#include "http/http_handle_pool.h"
+#include "http/http_rate_limiter.h"
+#include "http/http_share.h"
+#include "http/http_stats.h"
+#include "http/http_cassette.h"
+#include "http/http_transport_curl.h"
 #include "public_ip/public_ip_getter.h"
 #include "dns_service/dns_service.h"
 #include "notify_service/notify_service.h"
 #include "pve/pve_api_client.h"
 #include "pve/pve_pct_wrapper.h"
-
-// Main loop running flag
-static volatile bool g_running = true;
+#include "pipeline/host_v6_sync.h"
+#include "pipeline/update_pipeline.h"
+#include "pipeline/update_scheduler.h"
+
+// Main loop running flag, cleared by stop signal on the signal watcher thread
+static std::atomic<bool> g_running{ true };
+// HTTP transport shared by all services
+static std::shared_ptr<IHttpTransport> g_http_transport;
 // Public IP getter service instance
 static std::shared_ptr<IPublicIpGetter> g_ip_getter;
 // Notify service instance
@@ -32,22 +45,6 @@ static std::shared_ptr<INotifyService> g_notify_service;
 // DNS service instances
 static std::shared_ptr<std::unordered_map<size_t, IDnsService *>> g_dns_services;
 
-//#ifdef WIN32
-//static BOOL WINAPI ctrl_handler(DWORD fdw_ctrl_type)
-//{
-//    if (CTRL_C_EVENT == fdw_ctrl_type)
-//    {
-//        SPDLOG_INFO("Received ctrl+c event, stopping...");
-//        g_running = false;
-//        return TRUE;
-//    }
-//
-//    SPDLOG_WARN("Received ctrl event: {}, ignored!", fdw_ctrl_type);
-//    return FALSE;
-//}
-//#else
-//#endif
-
 // Command line params handling
 static bool parse_cmd(int argc, char * argv[])
 {
@@ -124,7 +121,7 @@ static bool init_public_ip_getter()
     }
 
     auto & cfg = Config::getInstance();
-    auto * ip_getter = PublicIpGetterFactory::create(cfg._public_ip_service);
+    auto * ip_getter = PublicIpGetterFactory::create(cfg._public_ip_service, g_http_transport);
     if (nullptr == ip_getter)
     {
         SPDLOG_WARN("Failed to create public ip getter {}!", cfg._public_ip_service);
@@ -163,7 +160,7 @@ static bool init_notify_service()
         SPDLOG_INFO("No notify service specified!");
         return true;
     }
-    auto * notify_service = NotifyServiceFactory::create(cfg._notify_service);
+    auto * notify_service = NotifyServiceFactory::create(cfg._notify_service, g_http_transport);
     if (nullptr == notify_service)
     {
         SPDLOG_WARN("Failed to create notify service {}!", cfg._notify_service);
@@ -215,7 +212,7 @@ static bool create_dns_service(const std::string & dns_type, const std::string &
     const size_t key = get_dns_service_key(dns_type, credentials);
     if (g_dns_services->find(key) == g_dns_services->end())
     {
-        IDnsService * dns_service = DnsServiceFactory::create(dns_type);
+        IDnsService * dns_service = DnsServiceFactory::create(dns_type, g_http_transport);
         if (nullptr == dns_service)
         {
             SPDLOG_WARN("Failed to create dns service {}!", dns_type);
@@ -333,239 +330,8 @@ static void init_dns_records()
     }
 }
 
-static bool update_dns_records_v4(const config_node & config_node, const std::string & ip, IDnsService * dns_service)
-{
-    if (ip.empty() || nullptr == dns_service)
-    {
-        SPDLOG_WARN("Invalid params!");
-        return false;
-    }
-    auto & cfg = Config::getInstance();
-    for (const auto & domain : config_node.ipv4_domains)
-    {
-        auto found = cfg._ipv4_records.find(domain);
-        if (cfg._ipv4_records.end() == found)
-        {
-            SPDLOG_WARN("IPv4 domain '{}' dns record not found!", domain);
-            return false;
-        }
-        if (found->second.last_ip != ip)
-        {
-            SPDLOG_INFO("IPv4 domain '{}' dns record address changed from '{}' to '{}', updating...", 
-                domain, found->second.last_ip, ip);
-            if (dns_service->setIpv4(domain, ip))
-            {
-                SPDLOG_INFO("IPv4 record of domain '{}' successfully updated from '{}' to '{}'.", 
-                    domain, found->second.last_ip, ip);
-                if (g_notify_service != nullptr)
-                {
-                    if (!g_notify_service->notifyIpChange(false, domain, found->second.last_ip, ip))
-                    {
-                        SPDLOG_WARN("Failed to notifyIpChange using service {}!", g_notify_service->getServiceName());
-                    }
-                    else
-                    {
-                        SPDLOG_DEBUG("notifyIpChange using service {} successfully called.",
-                                     g_notify_service->getServiceName());
-                    }
-                }
-                found->second.last_ip = ip;
-                found->second.last_get_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    std::chrono::system_clock::now().time_since_epoch()
-                );
-            }
-            else
-                SPDLOG_WARN("Failed to update IPv4 record from '{}' to '{}' of domain '{}'!", 
-                    found->second.last_ip, ip, domain);
-        }
-//        else
-//            SPDLOG_INFO("IPv4 domain '{}' dns record address '{}' not changed.", domain, ip);
-    }
-    return true;
-}
-
-static bool update_dns_records_v6(const config_node & config_node, const std::string & ip, IDnsService * dns_service)
-{
-    if (ip.empty() || nullptr == dns_service)
-    {
-        SPDLOG_WARN("Invalid params!");
-        return false;
-    }
-    auto & cfg = Config::getInstance();
-    for (const auto & domain : config_node.ipv6_domains)
-    {
-        auto found = cfg._ipv6_records.find(domain);
-        if (cfg._ipv6_records.end() == found)
-        {
-            SPDLOG_WARN("IPv6 domain '{}' dns record not found!", domain);
-            return false;
-        }
-        if (found->second.last_ip != ip)
-        {
-            SPDLOG_INFO("IPv6 domain '{}' dns record address changed from '{}' to '{}', updating...", 
-                domain, found->second.last_ip, ip);
-            if (dns_service->setIpv6(domain, ip))
-            {
-                SPDLOG_INFO("IPv6 record of domain '{}' successfully updated from '{}' to '{}'.", 
-                    domain, found->second.last_ip, ip);
-                if (g_notify_service != nullptr)
-                {
-                    if (!g_notify_service->notifyIpChange(true, domain, found->second.last_ip, ip))
-                    {
-                        SPDLOG_WARN("Failed to notifyIpChange using service {}!", g_notify_service->getServiceName());
-                    }
-                    else
-                    {
-                        SPDLOG_DEBUG("notifyIpChange using service {} successfully called.",
-                                     g_notify_service->getServiceName());
-                    }
-                }                    
-                found->second.last_ip = ip;
-                found->second.last_get_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    std::chrono::system_clock::now().time_since_epoch()
-                );
-            }
-            else
-                SPDLOG_WARN("Failed to update IPv6 record from '{}' to '{}' of domain '{}'!", 
-                    found->second.last_ip, ip, domain);
-        }
-//        else
-//            SPDLOG_INFO("IPv6 domain '{}' dns record address '{}' not changed.", domain, ip);
-    }
-    return true;
-}
-
-static bool update_dns_records(const config_node & config_node, const std::string & ip, const bool is_v4)
-{
-    auto & cfg = Config::getInstance();
-    size_t dns_service_key = get_dns_service_key(config_node.dns_type, config_node.credentials);
-    auto * dns_service = get_dns_service(dns_service_key);
-    if (nullptr == dns_service)
-    {
-        SPDLOG_WARN("Failed to find dns service of '{}'!", config_node.dns_type);
-        return false;
-    }
-
-    if (is_v4)
-    {
-        if (!update_dns_records_v4(config_node, ip, dns_service))
-            return false;
-    }
-    else
-    {
-        if (!update_dns_records_v6(config_node, ip, dns_service))
-            return false;
-    }
-
-    return true;
-}
-
-static bool sync_host_static_v6_address(const std::shared_ptr<PveApiClient> & pve_api_client,
-                                        const std::string & host_v4_addr, const std::string & host_v6_addr,
-                                        const std::string & guest_v6_addr)
-{
-    if (host_v6_addr.empty() || guest_v6_addr.empty())
-        return true;
-
-    int counter = 1;
-    auto host_4th_colon_pos = host_v6_addr.find(':');
-    while (host_4th_colon_pos != std::string::npos && counter < 4)
-    {
-        host_4th_colon_pos = host_v6_addr.find(':', host_4th_colon_pos + 1);
-        ++counter;
-    }
-    if (counter != 4)
-    {
-        SPDLOG_WARN("Invalid host v6 address '{}'!", host_v6_addr);
-        return false;
-    }
-
-    const std::string host_1st_part = host_v6_addr.substr(0, host_4th_colon_pos);
-    const std::string host_2nd_part = host_v6_addr.substr(host_4th_colon_pos + 1);
-
-    counter = 1;
-    auto guest_4th_colon_pos = guest_v6_addr.find(':');
-    while (guest_4th_colon_pos != std::string::npos && counter < 4)
-    {
-        guest_4th_colon_pos = guest_v6_addr.find(':', guest_4th_colon_pos + 1);
-        ++counter;
-    }
-    if (counter != 4)
-    {
-        SPDLOG_WARN("Invalid guest v6 address '{}'!", guest_v6_addr);
-        return false;
-    }
-
-    const std::string guest_1st_part = guest_v6_addr.substr(0, guest_4th_colon_pos);
-    if (host_1st_part == guest_1st_part)
-    {
-//        SPDLOG_INFO("No need to sync host v6 static address, 1st part '{}' not changed.", host_1st_part);
-        return true;
-    }
-
-    const std::string new_host_v6_address = fmt::format("{}:{}", guest_1st_part, host_2nd_part);
-    SPDLOG_INFO("Host v6 static address 1st part changed from '{}' to '{}', "
-        "updating host static IPv6 address to '{}'...", 
-        host_1st_part, guest_1st_part, new_host_v6_address);
-
-    int retry_count = 0;
-    while(retry_count < 5)
-    {
-        const auto & cfg = Config::getInstance();
-        if (!pve_api_client->setHostNetworkAddress(cfg._host_config.node, cfg._host_config.iface,
-                                                   host_v4_addr, new_host_v6_address))
-        {
-            SPDLOG_WARN("Failed to update synced host static IPv6 address, retry in 1 minute({})...", retry_count);
-
-            if (!pve_api_client->revertHostNetworkChange(cfg._host_config.node))
-                SPDLOG_WARN("Failed to revert host network change!");
-            else
-                SPDLOG_INFO("Host network change successfully reverted.");
-
-            std::this_thread::sleep_for(std::chrono::minutes(1));
-            ++retry_count;
-            continue;
-        }
-
-        SPDLOG_INFO("Host static IPv6 address successfully updated, applying change...");
-        if (!pve_api_client->applyHostNetworkChange(cfg._host_config.node))
-        {
-            SPDLOG_WARN("Failed to apply host network change, retry in 1 minute({})...", retry_count);
-
-            if (!pve_api_client->revertHostNetworkChange(cfg._host_config.node))
-                SPDLOG_WARN("Failed to revert host network change!");
-            else
-                SPDLOG_INFO("Host network change successfully reverted.");
-
-            std::this_thread::sleep_for(std::chrono::minutes(1));
-            ++retry_count;
-            continue;
-        }
-        SPDLOG_INFO("Host network change successfully applied!");
-
-        std::this_thread::sleep_for(std::chrono::seconds(10));
-
-        if (!update_dns_records(cfg._host_config, new_host_v6_address, false))
-        {
-            SPDLOG_WARN("Failed to update synced host v6 dns records, retry in 1 minute({})", retry_count);
-            std::this_thread::sleep_for(std::chrono::minutes(1));
-            ++retry_count;
-            continue;
-        }
-        else
-            SPDLOG_INFO("Synced host v6 dns records successfully updated!");
-
-        break;
-    }
-
-    return true;
-}
-
 static bool initialize(int argc, char * argv[])
 {
-//#ifdef WIN32
-//    SetConsoleCtrlHandler(ctrl_handler, TRUE);
-//#endif
     if (!parse_cmd(argc, argv))
         return false;
 
@@ -599,10 +365,51 @@ static bool initialize(int argc, char * argv[])
     spdlog::set_level(cfg._log_level);
 
     curl_global_init(CURL_GLOBAL_ALL);
+    const auto & cassette = cfg._http_cassette;
+    if ("record" == cassette.mode || "replay" == cassette.mode)
+    {
+        const CassetteMode mode = "record" == cassette.mode ? CassetteMode::Record : CassetteMode::Replay;
+        if (!HttpCassette::getInstance().open(mode, cassette.file, cassette.latency_scale))
+        {
+            SPDLOG_ERROR("Failed to open HTTP cassette '{}'!", cassette.file);
+            return false;
+        }
+    }
+    else if ("off" != cassette.mode)
+        SPDLOG_WARN("Unknown HTTP cassette mode '{}', cassette is not used!", cassette.mode);
+    if (!HttpShare::getInstance().init())
+        SPDLOG_WARN("Failed to init HTTP share, DNS/TLS session caches will not be shared!");
+    if (!HttpClient::getInstance().start())
+    {
+        SPDLOG_ERROR("Failed to start HTTP engine!");
+        return false;
+    }
+    g_http_transport = std::make_shared<HttpTransportCurl>();
 
     return true;
 }
 
+// Release services created by initialize_services, the pipeline using them must be stopped first
+static void cleanup_services()
+{
+    cleanup_dns_services();
+    cleanup_public_ip_getter();
+    g_notify_service.reset();
+}
+
+// Parse config file on SIGHUP, it is applied once the current services are stopped. An invalid file is
+// ignored and the current config keeps running.
+static bool prepare_reload()
+{
+    Config & cfg = Config::getInstance();
+    if (!cfg.prepareReload(cfg._yml_path))
+    {
+        SPDLOG_ERROR("Failed to reload config from '{}', keeping current config!", cfg._yml_path);
+        return false;
+    }
+    return true;
+}
+
 static bool initialize_services(std::shared_ptr<PveApiClient> & pve_api_client,
                                 std::shared_ptr<PvePctWrapper> & pve_pct_wrapper)
 {
@@ -633,7 +440,7 @@ static bool initialize_services(std::shared_ptr<PveApiClient> & pve_api_client,
     if (!cfg._host_config.ipv4_domains.empty() || !cfg._host_config.ipv6_domains.empty() ||
         !cfg._guest_configs.empty())
     {
-        pve_api_client = std::make_shared<PveApiClient>();
+        pve_api_client = std::make_shared<PveApiClient>(g_http_transport);
         if (nullptr == pve_api_client)
         {
             SPDLOG_ERROR("Failed to allocate PveApiClient!");
@@ -662,127 +469,76 @@ static bool initialize_services(std::shared_ptr<PveApiClient> & pve_api_client,
     return true;
 }
 
-static void update_client()
-{
-    Config & cfg = Config::getInstance();
-    if (!cfg._client_config.ipv4_domains.empty())
-    {
-        cfg._my_public_ipv4 = g_ip_getter->getIpv4();
-        if (cfg._my_public_ipv4.empty())
-            SPDLOG_WARN("Failed to get client public IPv4 address!");
-        else if (!update_dns_records(cfg._client_config, cfg._my_public_ipv4, true))
-            SPDLOG_WARN("Failed to update client v4 dns records!");
-    }
-
-    if (!cfg._client_config.ipv6_domains.empty())
-    {
-        cfg._my_public_ipv6 = g_ip_getter->getIpv6();
-        if (cfg._my_public_ipv6.empty())
-            SPDLOG_WARN("Failed to get client public IPv6 address!");
-        else if (!update_dns_records(cfg._client_config, cfg._my_public_ipv6, false))
-            SPDLOG_WARN("Failed to update client v6 dns record!");
-    }
-}
-
-static void update_host(const std::shared_ptr<PveApiClient> & pve_api_client,
-                        std::string & host_v4_addr, std::string & host_v6_addr)
+// Local interfaces whose addresses client and host targets take, by interface
+static std::map<std::string, std::vector<update_target>> get_iface_targets()
 {
     const Config & cfg = Config::getInstance();
-    const bool enabled = !cfg._host_config.ipv4_domains.empty() || !cfg._host_config.ipv6_domains.empty();
-
-    if (nullptr == pve_api_client && enabled)
-    {
-        SPDLOG_WARN("Invalid pve_api_client while host update is needed!");
-        return;
-    }
-
-    if (enabled)
-    {
-        auto ret = pve_api_client->getHostIp(cfg._host_config.node, cfg._host_config.iface);
-        host_v4_addr = ret.first;
-        host_v6_addr = ret.second;
-        if (!cfg._host_config.ipv4_domains.empty() && ret.first.empty())
-        {
-            SPDLOG_WARN("Failed to get host IPv4 address!");
-            g_running = false;
-        }
-        else if (!cfg._host_config.ipv4_domains.empty() && !ret.first.empty())
-        {
-            if (!update_dns_records(cfg._host_config, ret.first, true))
-                SPDLOG_WARN("Failed to update host v4 dns records!");
-        }
-
-        if (!cfg._host_config.ipv6_domains.empty() && ret.second.empty())
-        {
-            SPDLOG_WARN("Failed to get host IPv6 address!");
-            g_running = false;
-        }
-        else if (!cfg._host_config.ipv6_domains.empty() && !ret.second.empty())
-        {
-            if (!update_dns_records(cfg._host_config, ret.second, false))
-                SPDLOG_WARN("Failed to update host v6 dns records!");
-        }
-    }
+    std::map<std::string, std::vector<update_target>> iface_targets;
+    if ((!cfg._client_config.ipv4_domains.empty() || !cfg._client_config.ipv6_domains.empty()) &&
+        str_iequals(cfg._public_ip_service, PUBLIC_IP_GETTER_IFACE))
+        iface_targets[cfg._public_ip_credentials].push_back({ UpdateTargetType::Client, 0 });
+    // Only present locally if running on the PVE host
+    if ((!cfg._host_config.ipv4_domains.empty() || !cfg._host_config.ipv6_domains.empty()) &&
+        !cfg._host_config.iface.empty())
+        iface_targets[cfg._host_config.iface].push_back({ UpdateTargetType::Host, 0 });
+    return iface_targets;
 }
 
-static void update_guests(const std::shared_ptr<PveApiClient> & pve_api_client,
-                          const std::shared_ptr<PvePctWrapper> & pve_pct_wrapper,
-                          const std::string & host_v4_addr, const std::string & host_v6_addr)
+// Schedule every configured target on its own interval, general update interval if not set. Targets updated on
+// address events are polled at the address watch interval instead.
+static void init_scheduler(UpdateScheduler & scheduler, const std::vector<update_target> & watched)
 {
     const Config & cfg = Config::getInstance();
-
-    if ((nullptr == pve_api_client || nullptr == pve_pct_wrapper) && !cfg._guest_configs.empty())
+    const auto add = [&scheduler, &cfg, &watched](const update_target & target, const config_node & node)
     {
-        SPDLOG_WARN("Invalid pve_api_client and/or pve_pct_wrapper while guest update is needed!");
-        return;
-    }
-
-    std::string kvm_guest_v6_addr, lxc_guest_v6_addr;
-    for (auto & guest : cfg._guest_configs)
-    {
-        std::pair<std::string, std::string> ret = {};
-        if (pve_pct_wrapper->isLxcGuest(guest.first))
+        auto interval = node.update_interval.count() > 0 ? node.update_interval : cfg._update_interval;
+        if (std::any_of(watched.begin(), watched.end(), [&target](const update_target & t)
+            {
+                return t.type == target.type && t.vmid == target.vmid;
+            }))
         {
-            ret = pve_pct_wrapper->getGuestIp(guest.first, guest.second.iface);
-            if (!ret.second.empty() && lxc_guest_v6_addr.empty())
-                lxc_guest_v6_addr = ret.second;
+            interval = std::max(interval, cfg._addr_watch.poll_interval);
+            SPDLOG_INFO("Updating {} on address change events.", get_update_target_name(target));
         }
+        scheduler.add(target, interval, node.adaptive);
+        if (node.adaptive.enabled)
+            SPDLOG_INFO("Updating {} every {} ms, adaptive between {} ms and {} ms.", get_update_target_name(target),
+                        interval.count(), std::min(interval, node.adaptive.fast_interval).count(),
+                        std::max(interval, node.adaptive.max_interval).count());
         else
-        {
-            ret = pve_api_client->getGuestIp(guest.second.node, guest.first, guest.second.iface);
-            if (!ret.second.empty() && kvm_guest_v6_addr.empty())
-                kvm_guest_v6_addr = ret.second;
-        }
-        if (!guest.second.ipv4_domains.empty() && ret.first.empty())
-        {
-            SPDLOG_WARN("Failed to get guest(vmid: {}) IPv4 address!", guest.first);
-            g_running = false;
-        }
-        else if (!guest.second.ipv4_domains.empty() && !ret.first.empty())
-        {
-            if (!update_dns_records(guest.second, ret.first, true))
-                SPDLOG_WARN("Failed to update guest(vmid: {}) v4 dns records!", guest.first);
-        }
+            SPDLOG_INFO("Updating {} every {} ms.", get_update_target_name(target), interval.count());
+    };
+    if (!cfg._client_config.ipv4_domains.empty() || !cfg._client_config.ipv6_domains.empty())
+        add({ UpdateTargetType::Client, 0 }, cfg._client_config);
+    if (!cfg._host_config.ipv4_domains.empty() || !cfg._host_config.ipv6_domains.empty())
+        add({ UpdateTargetType::Host, 0 }, cfg._host_config);
+    // Guests without domains are observed too, their IPv6 address may be synced to the host
+    for (const auto & guest : cfg._guest_configs)
+        add({ UpdateTargetType::Guest, guest.first }, guest.second);
+}
 
-        if (!guest.second.ipv6_domains.empty() && ret.second.empty())
-        {
-            SPDLOG_WARN("Failed to get guest(vmid: {}) IPv6 address!", guest.first);
-            g_running = false;
-        }
-        else if (!guest.second.ipv6_domains.empty() && !ret.second.empty())
-        {
-            if (!update_dns_records(guest.second, ret.second, false))
-                SPDLOG_WARN("Failed to update guest(vmid: {}) v6 dns records!", guest.first);
-        }
-    }
+// Run one update cycle of due targets through the pipeline, report observations to the scheduler for adaptive
+// polling, then start host static IPv6 address sync if enabled and needed
+static void update_cycle(UpdatePipeline & pipeline, UpdateScheduler & scheduler, HostV6Sync & host_v6_sync,
+                         const std::vector<update_target> & targets)
+{
+    const cycle_result result = pipeline.runCycle(targets);
+    const auto now = std::chrono::steady_clock::now();
+    for (const auto & observation : result.observations)
+        scheduler.report(observation.first, observation.second, now);
+    // Host address may be missing while the host network reloads for a sync
+    if (result.address_missing && !host_v6_sync.busy())
+        g_running = false;
+    if (result.failed_writes > 0)
+        SPDLOG_WARN("{} dns record update(s) failed, retry next cycle...", result.failed_writes);
 
-    std::string guest_v6_addr = kvm_guest_v6_addr.empty() ? lxc_guest_v6_addr : kvm_guest_v6_addr;
+    const Config & cfg = Config::getInstance();
     if ((!cfg._host_config.ipv4_domains.empty() || !cfg._host_config.ipv6_domains.empty()) &&
-        cfg._sync_host_static_v6_address)
+        cfg._sync_host_static_v6_address && result.pve_observed)
     {
-        if (guest_v6_addr.empty())
+        if (result.guest_v6_addr.empty())
             SPDLOG_WARN("Sync host static IPv6 address enabled but no valid guest IPv6 address!");
-        else if (!sync_host_static_v6_address(pve_api_client, host_v4_addr, host_v6_addr, guest_v6_addr))
+        else if (!host_v6_sync.check(result.host_v4_addr, result.host_v6_addr, result.guest_v6_addr, now))
             SPDLOG_WARN("Failed to sync host static IPv6 address!");
     }
 }
@@ -797,40 +553,140 @@ int main(int argc, char * argv[])
     SPDLOG_INFO("Starting up, ver {}, config loaded from '{}'.", get_version_string(), cfg._yml_path);
     SPDLOG_INFO("{} in service mode...", (cfg._service_mode ? "Running" : "Not running"));
 
+    // Stop signal leaves in-flight requests a grace period, then the main loop is woken up and leaves
+    auto & signal_waiter = SignalWaiter::getInstance();
+    if (!signal_waiter.start([&cfg]()
+        {
+            g_running = false;
+            HttpClient::getInstance().drain(cfg._shutdown_grace);
+        }))
+        SPDLOG_WARN("Failed to start signal waiter, stop and reload signals are not handled gracefully!");
+
+    bool reload = false;
+    // Config was just reloaded, reverted if services fail to initialize with it
+    bool reloaded = false;
     do
     {
+        reload = false;
         std::shared_ptr<PveApiClient> pve_api_client;
         std::shared_ptr<PvePctWrapper> pve_pct_wrapper;
         if (!initialize_services(pve_api_client, pve_pct_wrapper))
         {
             SPDLOG_WARN("Failed to initialize_services!");
-            break;
+            if (!reloaded)
+                break;
+            SPDLOG_ERROR("Reloaded config failed to initialize services, reverting to previous config!");
+            cleanup_services();
+            cfg.applyReload();
+            HttpRateLimiter::getInstance().reloadLimits();
+            reloaded = false;
+            reload = true;
+            continue;
         }
-
-        // Service loop
-        while (g_running)
+        reloaded = false;
+        UpdatePipeline pipeline({ g_ip_getter, g_notify_service, g_dns_services, pve_api_client, pve_pct_wrapper },
+                                cfg._pipeline_queue_size, cfg._dns_write_concurrency);
+        pipeline.start();
+        HostV6Sync host_v6_sync(pipeline, pve_api_client, cfg._sync_host_static_v6_verify_interval,
+                                cfg._sync_host_static_v6_verify_timeout);
+        // Targets made due by address events on the watcher thread, taken by the main loop
+        std::mutex addr_changed_mutex;
+        std::vector<update_target> addr_changed;
+        const auto iface_targets = get_iface_targets();
+        NetlinkAddrWatcher addr_watcher;
+        std::vector<update_target> watched;
+        if (cfg._addr_watch.enabled && cfg._service_mode && !iface_targets.empty())
         {
-            auto elasped_time = std::chrono::system_clock::now().time_since_epoch() - cfg._last_update_time;
-            if (elasped_time > cfg._update_interval)
+            std::vector<std::string> ifaces;
+            for (const auto & kv : iface_targets)
+                ifaces.push_back(kv.first);
+            const auto on_change = [&](const std::string & iface)
             {
-                cfg._last_update_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    std::chrono::system_clock::now().time_since_epoch()
-                );
-                update_client();
-                std::string host_v4_addr, host_v6_addr;
-                update_host(pve_api_client, host_v4_addr, host_v6_addr);
-                update_guests(pve_api_client, pve_pct_wrapper, host_v4_addr, host_v6_addr);
+                {
+                    std::lock_guard<std::mutex> lock(addr_changed_mutex);
+                    const auto & targets = iface_targets.at(iface);
+                    addr_changed.insert(addr_changed.end(), targets.begin(), targets.end());
+                }
+                signal_waiter.wake();
+            };
+            for (const auto & iface : addr_watcher.start(ifaces, cfg._addr_watch.debounce, on_change))
+            {
+                const auto & targets = iface_targets.at(iface);
+                watched.insert(watched.end(), targets.begin(), targets.end());
             }
-            else if (!cfg._service_mode)
-                break;
-            else
-                std::this_thread::sleep_for(cfg._update_interval - elasped_time);
         }
-    } while (false);
+        UpdateScheduler scheduler;
+        init_scheduler(scheduler, watched);
+        if (scheduler.empty())
+            SPDLOG_WARN("No client, host or guest to update!");
+
+        bool updated = false;
+        // Service loop, all targets are due at start so a non service mode run updates each once (and finishes
+        // a host static IPv6 sync it started). Sync transitions run between cycles, a reloading host network no
+        // longer holds back other targets.
+        while (g_running && !scheduler.empty())
+        {
+            const auto now = std::chrono::steady_clock::now();
+            {
+                std::lock_guard<std::mutex> lock(addr_changed_mutex);
+                for (const auto & target : addr_changed)
+                    scheduler.wake(target, now);
+                addr_changed.clear();
+            }
+            if (host_v6_sync.nextDue() <= now)
+            {
+                host_v6_sync.step(now);
+                continue;
+            }
+            // Targets are due again only in service mode
+            const auto next_due = cfg._service_mode || !updated ? scheduler.nextDue()
+                                                                : std::chrono::steady_clock::time_point::max();
+            if (next_due > now)
+            {
+                if (!cfg._service_mode && !host_v6_sync.busy())
+                    break;
+                if (SignalEvent::Reload == signal_waiter.waitUntil(std::min(next_due, host_v6_sync.nextDue())) &&
+                    prepare_reload())
+                {
+                    reload = true;
+                    break;
+                }
+                continue;
+            }
+            const std::vector<update_target> targets = scheduler.popDue(now);
+            if (targets.empty())
+                continue;
+            updated = true;
+            // requests still pending when the cycle budget runs out are abandoned until next cycle
+            HttpClient::getInstance().setDeadline(now +
+                (cfg._cycle_budget.count() > 0 ? cfg._cycle_budget : scheduler.minInterval(targets)));
+            update_cycle(pipeline, scheduler, host_v6_sync, targets);
+            HttpClient::getInstance().clearDeadline();
+            SPDLOG_DEBUG("Metrics:\n{}", Metrics::getInstance().dump());
+            SPDLOG_DEBUG("HTTP endpoint timings:\n{}", HttpStats::getInstance().dump());
+        }
+
+        // Apply lanes hold the DNS services, they are stopped before services are released
+        addr_watcher.stop();
+        pipeline.stop();
+        if (reload)
+        {
+            cleanup_services();
+            cfg.applyReload();
+            HttpRateLimiter::getInstance().reloadLimits();
+            reloaded = true;
+            SPDLOG_INFO("Config reloaded from '{}'.", cfg._yml_path);
+        }
+    } while (reload && g_running);
 
     SPDLOG_INFO("Shutting down...");
+    signal_waiter.stop();
     cleanup_dns_services();
     cleanup_public_ip_getter();
+    g_http_transport.reset();
+    HttpClient::getInstance().stop();
+    HttpHandlePool::getInstance().cleanup();
+    HttpShare::getInstance().cleanup();
     curl_global_cleanup();
     spdlog::shutdown();
 
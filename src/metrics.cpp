@@ -0,0 +1,34 @@
+#include "metrics.h"
+
+#include "fmt/format.h"
+
+void Metrics::add(const std::string & name, const double value)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _values[name] += value;
+}
+
+void Metrics::set(const std::string & name, const double value)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _values[name] = value;
+}
+
+double Metrics::get(const std::string & name) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto found = _values.find(name);
+    return _values.end() != found ? found->second : 0;
+}
+
+std::string Metrics::dump() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::string result;
+    for (const auto & item : _values)
+    {
+        result.append(fmt::format("{} {}", item.first, item.second));
+        result.push_back('\n');
+    }
+    return result;
+}
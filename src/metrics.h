@@ -0,0 +1,48 @@
+#ifndef PVE_DDNS_CLIENT_SRC_METRICS_H
+#define PVE_DDNS_CLIENT_SRC_METRICS_H
+
+#include <map>
+#include <mutex>
+#include <string>
+
+/// Process-wide registry of counters and gauges, names may carry labels e.g. name{endpoint="x"}
+class Metrics
+{
+public:
+    static Metrics & getInstance()
+    {
+        static Metrics instance;
+        return instance;
+    }
+
+    /// \brief Add to counter
+    /// \param name Metric name
+    /// \param value Value to add
+    void add(const std::string & name, double value = 1);
+
+    /// \brief Set gauge
+    /// \param name Metric name
+    /// \param value Value
+    void set(const std::string & name, double value);
+
+    /// \brief Get metric value
+    /// \param name Metric name
+    /// \return Value, 0 if not present
+    double get(const std::string & name) const;
+
+    /// \brief Dump all metrics sorted by name
+    /// \return One "name value" per line
+    std::string dump() const;
+
+private:
+    Metrics() = default;
+    Metrics(Metrics const &) = delete;
+    Metrics & operator=(Metrics const &) = delete;
+
+    /// Guards _values
+    mutable std::mutex _mutex;
+    /// Metric values by name
+    std::map<std::string, double> _values;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_METRICS_H
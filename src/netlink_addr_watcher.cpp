@@ -0,0 +1,180 @@
+#include "netlink_addr_watcher.h"
+
+#include <algorithm>
+#include <map>
+
+#ifdef __linux__
+#include <cerrno>
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "spdlog/spdlog.h"
+
+#include "metrics.h"
+
+NetlinkAddrWatcher::~NetlinkAddrWatcher()
+{
+    stop();
+}
+
+std::vector<std::string> NetlinkAddrWatcher::start(const std::vector<std::string> & ifaces,
+                                                   const std::chrono::milliseconds debounce,
+                                                   addr_change_callback on_change)
+{
+    std::vector<std::string> watched;
+#ifdef __linux__
+    if (_running)
+    {
+        SPDLOG_WARN("Netlink address watcher is already running!");
+        return watched;
+    }
+    _ifaces.clear();
+    for (const auto & iface : ifaces)
+    {
+        const unsigned int index = if_nametoindex(iface.c_str());
+        if (0 == index)
+        {
+            SPDLOG_DEBUG("Interface '{}' not present on this machine, not watched.", iface);
+            continue;
+        }
+        if (std::none_of(_ifaces.begin(), _ifaces.end(), [index](const auto & i) { return i.first == index; }))
+            _ifaces.emplace_back(index, iface);
+    }
+    if (_ifaces.empty())
+        return watched;
+
+    _sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (_sock < 0)
+    {
+        SPDLOG_WARN("Failed to open netlink route socket, error is {}!", errno);
+        return watched;
+    }
+    sockaddr_nl addr = {};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+    if (0 != bind(_sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)))
+    {
+        SPDLOG_WARN("Failed to bind netlink route socket, error is {}!", errno);
+        close(_sock);
+        _sock = -1;
+        return watched;
+    }
+    _stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_stop_fd < 0)
+    {
+        SPDLOG_WARN("Failed to create eventfd, error is {}!", errno);
+        close(_sock);
+        _sock = -1;
+        return watched;
+    }
+
+    _debounce = debounce;
+    _on_change = std::move(on_change);
+    _running = true;
+    _watcher = std::thread(&NetlinkAddrWatcher::watch, this);
+    for (const auto & iface : _ifaces)
+        watched.push_back(iface.second);
+#else
+    (void)ifaces;
+    (void)debounce;
+    (void)on_change;
+    SPDLOG_DEBUG("Netlink is not available on this platform, interfaces are polled.");
+#endif
+    return watched;
+}
+
+void NetlinkAddrWatcher::stop()
+{
+#ifdef __linux__
+    if (!_running.exchange(false))
+        return;
+    const uint64_t one = 1;
+    (void)!write(_stop_fd, &one, sizeof(one));
+    _watcher.join();
+    close(_stop_fd);
+    close(_sock);
+    _stop_fd = _sock = -1;
+#endif
+}
+
+void NetlinkAddrWatcher::watch()
+{
+#ifdef __linux__
+    // Callback due time by interface, set by the first event after previous callback
+    std::map<std::string, std::chrono::steady_clock::time_point> pending;
+    alignas(nlmsghdr) char buf[8192];
+    pollfd pfds[2] = { { _sock, POLLIN, 0 }, { _stop_fd, POLLIN, 0 } };
+    while (_running)
+    {
+        int timeout_ms = -1;
+        if (!pending.empty())
+        {
+            const auto due = std::min_element(pending.begin(), pending.end(), [](const auto & a, const auto & b)
+            {
+                return a.second < b.second;
+            })->second;
+            const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                due - std::chrono::steady_clock::now());
+            timeout_ms = static_cast<int>(std::max<long long>(0, wait.count() + 1));
+        }
+        pfds[0].revents = pfds[1].revents = 0;
+        if (poll(pfds, 2, timeout_ms) < 0 && EINTR != errno)
+        {
+            SPDLOG_WARN("Failed to poll netlink route socket, error is {}!", errno);
+            break;
+        }
+        if (0 != (pfds[1].revents & POLLIN))
+            break;
+
+        if (0 != (pfds[0].revents & POLLIN))
+        {
+            int len = static_cast<int>(recv(_sock, buf, sizeof(buf), MSG_DONTWAIT));
+            if (len < 0 && ENOBUFS == errno)
+            {
+                // Events were dropped, any watched interface may have changed
+                SPDLOG_WARN("Netlink route socket overrun, rechecking all watched interfaces.");
+                for (const auto & iface : _ifaces)
+                    pending.emplace(iface.second, std::chrono::steady_clock::now() + _debounce);
+            }
+            for (auto * nh = reinterpret_cast<nlmsghdr *>(buf); len > 0 && NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len))
+            {
+                if (RTM_NEWADDR != nh->nlmsg_type && RTM_DELADDR != nh->nlmsg_type)
+                    continue;
+                const auto * ifa = static_cast<const ifaddrmsg *>(NLMSG_DATA(nh));
+                // A new IPv6 address is reported again once duplicate address detection is done
+                if (RTM_NEWADDR == nh->nlmsg_type && 0 != (ifa->ifa_flags & IFA_F_TENTATIVE))
+                    continue;
+                const auto found = std::find_if(_ifaces.begin(), _ifaces.end(), [ifa](const auto & i)
+                {
+                    return i.first == ifa->ifa_index;
+                });
+                if (_ifaces.end() == found)
+                    continue;
+                SPDLOG_DEBUG("Netlink {} event of interface '{}'.",
+                             RTM_NEWADDR == nh->nlmsg_type ? "RTM_NEWADDR" : "RTM_DELADDR", found->second);
+                Metrics::getInstance().add("netlink_addr_events_total");
+                pending.emplace(found->second, std::chrono::steady_clock::now() + _debounce);
+            }
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        for (auto it = pending.begin(); it != pending.end();)
+        {
+            if (it->second > now)
+            {
+                ++it;
+                continue;
+            }
+            SPDLOG_INFO("Address of interface '{}' changed, updating now.", it->first);
+            _on_change(it->first);
+            it = pending.erase(it);
+        }
+    }
+#endif
+}
@@ -0,0 +1,52 @@
+#ifndef PVE_DDNS_CLIENT_SRC_NETLINK_ADDR_WATCHER_H
+#define PVE_DDNS_CLIENT_SRC_NETLINK_ADDR_WATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Called on the watcher thread with the interface whose addresses changed
+using addr_change_callback = std::function<void(const std::string & iface)>;
+
+/// Listens for RTM_NEWADDR/RTM_DELADDR on a Linux netlink route socket and reports address changes of given
+/// local interfaces. Events of an interface are debounced: the callback runs once, debounce after the first event,
+/// so a renumbering (old address removed, new one added, DAD completed) is reported as one change.
+/// Not available on other platforms, start fails there and targets are polled as before.
+class NetlinkAddrWatcher
+{
+public:
+    NetlinkAddrWatcher() = default;
+    ~NetlinkAddrWatcher();
+    NetlinkAddrWatcher(NetlinkAddrWatcher const &) = delete;
+    NetlinkAddrWatcher & operator=(NetlinkAddrWatcher const &) = delete;
+
+    /// \brief Start watcher thread
+    /// \param ifaces Interfaces to watch, ones not present on this machine are skipped
+    /// \param debounce Delay from first event of an interface to its callback
+    /// \param on_change Change callback
+    /// \return Interfaces being watched, empty if none is present or netlink is not available
+    std::vector<std::string> start(const std::vector<std::string> & ifaces, std::chrono::milliseconds debounce,
+                                   addr_change_callback on_change);
+
+    /// \brief Stop watcher thread, pending debounced events are dropped
+    void stop();
+
+private:
+    void watch();
+
+    /// Watched interfaces, pair of interface index and name
+    std::vector<std::pair<unsigned int, std::string>> _ifaces;
+    std::chrono::milliseconds _debounce{ 0 };
+    addr_change_callback _on_change;
+    /// Netlink route socket
+    int _sock = -1;
+    /// Wakes watcher thread up on stop
+    int _stop_fd = -1;
+    std::atomic<bool> _running{ false };
+    std::thread _watcher;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_NETLINK_ADDR_WATCHER_H
@@ -8,7 +8,8 @@
 #include "notify_service_lua.h"
 
 
-INotifyService * NotifyServiceFactory::create(const std::string & service_name)
+INotifyService * NotifyServiceFactory::create(const std::string & service_name,
+                                              const std::shared_ptr<IHttpTransport> & transport)
 {
     if (service_name.empty())
     {
@@ -17,7 +18,7 @@ INotifyService * NotifyServiceFactory::create(const std::string & service_name)
     }
 
     // Try loading the LUA module with the service_name
-    auto * notify = new(std::nothrow) NotifyServiceLua();
+    auto * notify = new(std::nothrow) NotifyServiceLua(transport);
     if (nullptr == notify)
     {
         SPDLOG_ERROR("Failed to instantiate NotifyServiceLua!");
@@ -1,8 +1,11 @@
 #ifndef PVE_DDNS_CLIENT_SRC_NOTIFY_SERVICE_NOTIFY_SERVICE_H
 #define PVE_DDNS_CLIENT_SRC_NOTIFY_SERVICE_NOTIFY_SERVICE_H
 
+#include <memory>
 #include <string>
 
+class IHttpTransport;
+
 
 /// Notify service implementations
 constexpr const char * NOTIFY_SERVICE_LUA = "lua";
@@ -36,8 +39,9 @@ class NotifyServiceFactory
 public:
     /// Create notify service instance
     /// \param service_name Service name
+    /// \param transport HTTP transport used by the instance
     /// \return Instance pointer or nullptr if failed
-    static INotifyService * create(const std::string & service_name);
+    static INotifyService * create(const std::string & service_name, const std::shared_ptr<IHttpTransport> & transport);
 
     /// Destroy notify service instance
     /// \param notify_service Instance pointer
@@ -1,7 +1,10 @@
 #ifndef PVE_DDNS_CLIENT_SRC_NOTIFY_SERVICE_NOTIFY_SERVICE_LUA_H
 #define PVE_DDNS_CLIENT_SRC_NOTIFY_SERVICE_NOTIFY_SERVICE_LUA_H
 
+#include <memory>
+
 #include "notify_service.h"
+#include "../http/http_transport.h"
 
 
 typedef struct lua_State lua_State;
@@ -10,7 +13,7 @@ typedef struct lua_State lua_State;
 class NotifyServiceLua : public INotifyService
 {
 public:
-    NotifyServiceLua() = default;
+    explicit NotifyServiceLua(std::shared_ptr<IHttpTransport> transport) : _transport(std::move(transport)) {}
     NotifyServiceLua(const NotifyServiceLua & other) = delete;
     NotifyServiceLua & operator=(const NotifyServiceLua & other) = delete;
     NotifyServiceLua(NotifyServiceLua && other) noexcept;
@@ -28,6 +31,8 @@ private:
     /// Service name
     std::string _service_name = NOTIFY_SERVICE_LUA;
     lua_State * _ls;
+    /// HTTP transport
+    std::shared_ptr<IHttpTransport> _transport;
 };
 
 #endif //PVE_DDNS_CLIENT_SRC_NOTIFY_SERVICE_NOTIFY_SERVICE_LUA_H
@@ -0,0 +1,81 @@
+#ifndef PVE_DDNS_CLIENT_SRC_PIPELINE_BOUNDED_QUEUE_H
+#define PVE_DDNS_CLIENT_SRC_PIPELINE_BOUNDED_QUEUE_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+/// Blocking FIFO queue with a capacity, connects pipeline stages so a fast producer is held back by a slow consumer
+template <typename T>
+class BoundedQueue
+{
+public:
+    /// Constructor
+    /// \param capacity Max queued items, at least 1
+    explicit BoundedQueue(const size_t capacity) : _capacity(std::max<size_t>(1, capacity)) {}
+    BoundedQueue(BoundedQueue const &) = delete;
+    BoundedQueue & operator=(BoundedQueue const &) = delete;
+
+    /// \brief Push item, blocks while the queue is full
+    /// \param item Item
+    /// \return False if the queue is closed, item is dropped
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _not_full.wait(lock, [this] { return _closed || _items.size() < _capacity; });
+        if (_closed)
+            return false;
+        _items.emplace_back(std::move(item));
+        lock.unlock();
+        _not_empty.notify_one();
+        return true;
+    }
+
+    /// \brief Pop item, blocks while the queue is empty
+    /// \param item Popped item
+    /// \return False if the queue is closed and drained
+    bool pop(T & item)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _not_empty.wait(lock, [this] { return _closed || !_items.empty(); });
+        if (_items.empty())
+            return false;
+        item = std::move(_items.front());
+        _items.pop_front();
+        lock.unlock();
+        _not_full.notify_one();
+        return true;
+    }
+
+    /// \brief Close queue, pending pushes fail and pops return what is left
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+        }
+        _not_full.notify_all();
+        _not_empty.notify_all();
+    }
+
+    /// \brief Get number of queued items
+    /// \return Item count
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _items.size();
+    }
+
+private:
+    /// Max queued items
+    const size_t _capacity;
+    /// Guards _items and _closed
+    mutable std::mutex _mutex;
+    std::condition_variable _not_full;
+    std::condition_variable _not_empty;
+    std::deque<T> _items;
+    bool _closed = false;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_PIPELINE_BOUNDED_QUEUE_H
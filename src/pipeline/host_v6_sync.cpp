@@ -0,0 +1,148 @@
+#include "host_v6_sync.h"
+
+#include <algorithm>
+
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+
+#include "update_pipeline.h"
+#include "../config.h"
+#include "../metrics.h"
+#include "../pve/pve_api_client.h"
+
+// Split IPv6 address at its 4th colon into the first 4 groups (prefix) and the rest
+static bool split_v6_address(const std::string & addr, std::string & prefix, std::string & suffix)
+{
+    int counter = 1;
+    auto colon_4th_pos = addr.find(':');
+    while (colon_4th_pos != std::string::npos && counter < 4)
+    {
+        colon_4th_pos = addr.find(':', colon_4th_pos + 1);
+        ++counter;
+    }
+    if (counter != 4 || colon_4th_pos == std::string::npos)
+        return false;
+
+    prefix = addr.substr(0, colon_4th_pos);
+    suffix = addr.substr(colon_4th_pos + 1);
+    return true;
+}
+
+HostV6Sync::HostV6Sync(UpdatePipeline & pipeline, std::shared_ptr<PveApiClient> pve_api_client,
+                       const std::chrono::milliseconds verify_interval,
+                       const std::chrono::milliseconds verify_timeout) :
+    _pipeline(pipeline), _pve_api_client(std::move(pve_api_client)),
+    _verify_interval(std::max(std::chrono::milliseconds(1), verify_interval)), _verify_timeout(verify_timeout)
+{
+}
+
+bool HostV6Sync::check(const std::string & host_v4_addr, const std::string & host_v6_addr,
+                       const std::string & guest_v6_addr, const std::chrono::steady_clock::time_point now)
+{
+    if (busy() || host_v6_addr.empty() || guest_v6_addr.empty())
+        return true;
+
+    std::string host_1st_part, host_2nd_part, guest_1st_part, guest_2nd_part;
+    if (!split_v6_address(host_v6_addr, host_1st_part, host_2nd_part))
+    {
+        SPDLOG_WARN("Invalid host v6 address '{}'!", host_v6_addr);
+        return false;
+    }
+    if (!split_v6_address(guest_v6_addr, guest_1st_part, guest_2nd_part))
+    {
+        SPDLOG_WARN("Invalid guest v6 address '{}'!", guest_v6_addr);
+        return false;
+    }
+    if (host_1st_part == guest_1st_part)
+        return true;
+
+    _host_v4_addr = host_v4_addr;
+    _new_host_v6_addr = fmt::format("{}:{}", guest_1st_part, host_2nd_part);
+    SPDLOG_INFO("Host v6 static address 1st part changed from '{}' to '{}', "
+                "updating host static IPv6 address to '{}'...",
+                host_1st_part, guest_1st_part, _new_host_v6_addr);
+    Metrics::getInstance().add("host_v6_sync_started_total");
+    transit(State::Set, now);
+    return true;
+}
+
+void HostV6Sync::step(const std::chrono::steady_clock::time_point now)
+{
+    if (now < _due)
+        return;
+
+    // Transient HTTP failures are retried by the HTTP engine, if a step still fails the prefix mismatch
+    // remains and the sync is attempted again next cycle
+    const auto & cfg = Config::getInstance();
+    switch (_state)
+    {
+        case State::Idle:
+            break;
+        case State::Set:
+            if (!_pve_api_client->setHostNetworkAddress(cfg._host_config.node, cfg._host_config.iface,
+                                                        _host_v4_addr, _new_host_v6_addr))
+            {
+                SPDLOG_WARN("Failed to update synced host static IPv6 address, retry next cycle...");
+                fail();
+                break;
+            }
+            SPDLOG_INFO("Host static IPv6 address successfully updated, applying change...");
+            transit(State::Apply, now);
+            break;
+        case State::Apply:
+            if (!_pve_api_client->applyHostNetworkChange(cfg._host_config.node))
+            {
+                SPDLOG_WARN("Failed to apply host network change, retry next cycle...");
+                fail();
+                break;
+            }
+            SPDLOG_INFO("Host network change successfully applied, waiting for host network reload...");
+            _verify_deadline = now + _verify_timeout;
+            transit(State::Verify, now + _verify_interval);
+            break;
+        case State::Verify:
+        {
+            const auto ret = _pve_api_client->getHostIp(cfg._host_config.node, cfg._host_config.iface);
+            if (ret.second == _new_host_v6_addr)
+            {
+                SPDLOG_INFO("Host static IPv6 address '{}' is in effect.", _new_host_v6_addr);
+                transit(State::UpdateDns, now);
+            }
+            else if (now >= _verify_deadline)
+            {
+                SPDLOG_WARN("Host static IPv6 address is still '{}' after {} ms, retry next cycle...",
+                            ret.second, _verify_timeout.count());
+                Metrics::getInstance().add("host_v6_sync_failures_total");
+                transit(State::Idle, now);
+            }
+            else
+                transit(State::Verify, now + _verify_interval);
+            break;
+        }
+        case State::UpdateDns:
+            // Written by the appliers in the background, a failed write is retried by next host observation
+            if (!_pipeline.setHostAddress(true, _new_host_v6_addr))
+                SPDLOG_WARN("Failed to update synced host v6 dns records, retry next cycle...");
+            else
+                SPDLOG_INFO("Synced host v6 dns records queued for update.");
+            transit(State::Idle, now);
+            break;
+    }
+}
+
+void HostV6Sync::transit(const State state, const std::chrono::steady_clock::time_point due)
+{
+    _state = state;
+    _due = State::Idle == state ? std::chrono::steady_clock::time_point::max() : due;
+}
+
+void HostV6Sync::fail()
+{
+    const auto & cfg = Config::getInstance();
+    if (!_pve_api_client->revertHostNetworkChange(cfg._host_config.node))
+        SPDLOG_WARN("Failed to revert host network change!");
+    else
+        SPDLOG_INFO("Host network change successfully reverted.");
+    Metrics::getInstance().add("host_v6_sync_failures_total");
+    transit(State::Idle, std::chrono::steady_clock::time_point::max());
+}
@@ -0,0 +1,79 @@
+#ifndef PVE_DDNS_CLIENT_SRC_PIPELINE_HOST_V6_SYNC_H
+#define PVE_DDNS_CLIENT_SRC_PIPELINE_HOST_V6_SYNC_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+class PveApiClient;
+class UpdatePipeline;
+
+/// Syncs the host static IPv6 address prefix with a guest's dynamic one as a state machine with timed transitions:
+/// set -> apply -> verify (polls host address until the reloaded network has it) -> update host v6 dns records.
+/// The main loop calls step() when nextDue() is reached, so update cycles keep running while the host network
+/// reloads instead of the loop sleeping for it.
+class HostV6Sync
+{
+public:
+    /// Constructor
+    /// \param pipeline Pipeline the synced host address is fed to
+    /// \param pve_api_client PVE API client
+    /// \param verify_interval Interval of host address polling after apply
+    /// \param verify_timeout Host address polling is given up after it, sync is attempted again next cycle
+    HostV6Sync(UpdatePipeline & pipeline, std::shared_ptr<PveApiClient> pve_api_client,
+               std::chrono::milliseconds verify_interval, std::chrono::milliseconds verify_timeout);
+
+    /// \brief Start a sync if host and guest IPv6 prefixes differ, nothing is done while a sync is in progress
+    /// \param host_v4_addr Host IPv4 address, kept as is
+    /// \param host_v6_addr Host IPv6 address
+    /// \param guest_v6_addr Guest IPv6 address
+    /// \param now Current time
+    /// \return False if an address is invalid
+    bool check(const std::string & host_v4_addr, const std::string & host_v6_addr, const std::string & guest_v6_addr,
+               std::chrono::steady_clock::time_point now);
+
+    /// \brief Run the due transition
+    /// \param now Current time
+    void step(std::chrono::steady_clock::time_point now);
+
+    /// \brief Get time the next transition is due
+    /// \return Due time, max if no sync is in progress
+    std::chrono::steady_clock::time_point nextDue() const { return _due; }
+
+    /// \brief Check if a sync is in progress
+    /// \return Result
+    bool busy() const { return State::Idle != _state; }
+
+private:
+    enum class State
+    {
+        Idle,
+        Set,
+        Apply,
+        Verify,
+        UpdateDns
+    };
+
+    /// \brief Switch state
+    /// \param state New state
+    /// \param due Time its transition is due, ignored for Idle
+    void transit(State state, std::chrono::steady_clock::time_point due);
+
+    /// \brief Revert pending host network change and go idle
+    void fail();
+
+    UpdatePipeline & _pipeline;
+    std::shared_ptr<PveApiClient> _pve_api_client;
+    std::chrono::milliseconds _verify_interval;
+    std::chrono::milliseconds _verify_timeout;
+
+    State _state = State::Idle;
+    std::chrono::steady_clock::time_point _due = std::chrono::steady_clock::time_point::max();
+    /// Verification is given up after it
+    std::chrono::steady_clock::time_point _verify_deadline;
+    /// Host IPv4 address and new host IPv6 address of the sync in progress
+    std::string _host_v4_addr;
+    std::string _new_host_v6_addr;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_PIPELINE_HOST_V6_SYNC_H
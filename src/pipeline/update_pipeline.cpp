@@ -0,0 +1,508 @@
+#include "update_pipeline.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+
+#include "../metrics.h"
+#include "../utils.h"
+#include "../dns_service/dns_service.h"
+#include "../notify_service/notify_service.h"
+#include "../public_ip/public_ip_getter.h"
+#include "../pve/pve_api_client.h"
+#include "../pve/pve_pct_wrapper.h"
+
+// Key of a record in _writing
+static std::string record_key(const bool is_v6, const std::string & domain)
+{
+    return fmt::format("{} {}", is_v6 ? 6 : 4, domain);
+}
+
+UpdatePipeline::UpdatePipeline(pipeline_services services, const size_t queue_size, const int write_concurrency) :
+    _services(std::move(services)), _discoveries(queue_size), _samples(queue_size), _queue_size(queue_size),
+    _write_concurrency(std::max(1, write_concurrency))
+{
+}
+
+UpdatePipeline::~UpdatePipeline()
+{
+    stop();
+}
+
+void UpdatePipeline::start()
+{
+    if (_planner.joinable())
+        return;
+    for (auto * obs : { &_client_observer, &_host_observer, &_guest_observer })
+        obs->thread = std::thread(&UpdatePipeline::observeLoop, this, std::ref(*obs));
+    if (nullptr != _services.pve_api_client && nullptr != _services.pve_pct_wrapper)
+    {
+        const int workers = Config::getInstance()._guest_discovery_concurrency;
+        for (int i = 0; i < workers; ++i)
+            _discovery_workers.emplace_back(&UpdatePipeline::discoverLoop, this);
+    }
+    if (nullptr != _services.dns_services)
+    {
+        for (const auto & kv : *_services.dns_services)
+        {
+            auto lane = std::make_unique<apply_lane>(_queue_size);
+            const int workers = kv.second->isConcurrentWriteSafe() ? _write_concurrency : 1;
+            for (int i = 0; i < workers; ++i)
+                lane->workers.emplace_back(&UpdatePipeline::applyLoop, this, std::ref(*lane));
+            SPDLOG_DEBUG("Apply lane of dns service {} started with {} worker(s).",
+                         kv.second->getServiceName(), workers);
+            _lanes.emplace(kv.second, std::move(lane));
+        }
+    }
+    _planner = std::thread(&UpdatePipeline::planLoop, this);
+}
+
+void UpdatePipeline::stop()
+{
+    // Upstream first, so observers are done pushing before samples are closed, and the planner before writes are
+    for (auto * obs : { &_client_observer, &_host_observer, &_guest_observer })
+    {
+        obs->jobs.close();
+        if (obs->thread.joinable())
+            obs->thread.join();
+    }
+    _discoveries.close();
+    for (auto & worker : _discovery_workers)
+        worker.join();
+    _discovery_workers.clear();
+    _samples.close();
+    if (_planner.joinable())
+        _planner.join();
+    for (auto & kv : _lanes)
+        kv.second->writes.close();
+    for (auto & kv : _lanes)
+    {
+        for (auto & worker : kv.second->workers)
+            worker.join();
+    }
+    _lanes.clear();
+}
+
+cycle_result UpdatePipeline::runCycle(const std::vector<update_target> & targets)
+{
+    bool client_due = false, host_due = false;
+    std::vector<int> guest_vmids;
+    for (const auto & target : targets)
+    {
+        if (UpdateTargetType::Client == target.type)
+            client_due = true;
+        else if (UpdateTargetType::Host == target.type)
+            host_due = true;
+        else
+            guest_vmids.push_back(target.vmid);
+    }
+
+    // Each observer fills its own result, merged once observers and the writes they caused are done
+    cycle_result client_result, host_result, guest_result;
+    if (client_due)
+        dispatch(_client_observer, { {}, &client_result });
+    if (host_due)
+        dispatch(_host_observer, { {}, &host_result });
+    const bool guests_due = !guest_vmids.empty();
+    if (guests_due)
+        dispatch(_guest_observer, { std::move(guest_vmids), &guest_result });
+    const size_t failed_writes = waitIdle();
+
+    // Targets not due this cycle keep their last known addresses
+    if (host_due)
+    {
+        _host_v4_addr = std::move(host_result.host_v4_addr);
+        _host_v6_addr = std::move(host_result.host_v6_addr);
+    }
+    cycle_result result;
+    result.host_v4_addr = _host_v4_addr;
+    result.host_v6_addr = _host_v6_addr;
+    // Lowest vmid with an IPv6 address, KVM guests preferred, so the pick does not depend on completion order
+    std::string lxc_guest_v6_addr;
+    for (const auto & kv : _guest_v6_addrs)
+    {
+        const bool is_lxc = kv.second.first;
+        const std::string & addr = kv.second.second;
+        if (addr.empty())
+            continue;
+        if (!is_lxc)
+        {
+            result.guest_v6_addr = addr;
+            break;
+        }
+        if (lxc_guest_v6_addr.empty())
+            lxc_guest_v6_addr = addr;
+    }
+    if (result.guest_v6_addr.empty())
+        result.guest_v6_addr = lxc_guest_v6_addr;
+    result.pve_observed = host_due || guests_due;
+    result.address_missing = host_result.address_missing || guest_result.address_missing;
+    for (auto * observed : { &client_result, &host_result, &guest_result })
+    {
+        result.observations.insert(result.observations.end(), observed->observations.begin(),
+                                   observed->observations.end());
+    }
+    result.failed_writes = failed_writes;
+    return result;
+}
+
+bool UpdatePipeline::observe(address_sample sample)
+{
+    {
+        std::lock_guard<std::mutex> lock(_pending_mutex);
+        ++_pending;
+    }
+    if (_samples.push(std::move(sample)))
+        return true;
+    done(false);
+    return false;
+}
+
+bool UpdatePipeline::setHostAddress(const bool is_v6, const std::string & ip)
+{
+    (is_v6 ? _host_v6_addr : _host_v4_addr) = ip;
+    const Config & cfg = Config::getInstance();
+    const auto & domains = is_v6 ? cfg._host_config.ipv6_domains : cfg._host_config.ipv4_domains;
+    return domains.empty() || observe({ &cfg._host_config, "host", is_v6, ip });
+}
+
+size_t UpdatePipeline::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(_pending_mutex);
+    _idle.wait(lock, [this] { return 0 == _pending; });
+    const size_t failed = _failed;
+    _failed = 0;
+    return failed;
+}
+
+void UpdatePipeline::done(const bool failed)
+{
+    {
+        std::lock_guard<std::mutex> lock(_pending_mutex);
+        --_pending;
+        if (failed)
+            ++_failed;
+        if (_pending > 0)
+            return;
+    }
+    _idle.notify_all();
+}
+
+void UpdatePipeline::observeLoop(observer & obs)
+{
+    observe_job job;
+    while (obs.jobs.pop(job))
+    {
+        if (UpdateTargetType::Client == obs.type)
+            observeClient(*job.result);
+        else if (UpdateTargetType::Host == obs.type)
+            observeHost(*job.result);
+        else
+            observeGuests(job.vmids, *job.result);
+        done(false);
+    }
+}
+
+void UpdatePipeline::dispatch(observer & obs, observe_job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(_pending_mutex);
+        ++_pending;
+    }
+    if (!obs.jobs.push(std::move(job)))
+        done(false);
+}
+
+void UpdatePipeline::observeClient(cycle_result & result)
+{
+    Config & cfg = Config::getInstance();
+    bool missing = false;
+    if (!cfg._client_config.ipv4_domains.empty())
+    {
+        cfg._my_public_ipv4 = _services.ip_getter->getIpv4();
+        if (cfg._my_public_ipv4.empty())
+        {
+            SPDLOG_WARN("Failed to get client public IPv4 address!");
+            missing = true;
+        }
+        else
+            observe({ &cfg._client_config, "client", false, cfg._my_public_ipv4 });
+    }
+
+    if (!cfg._client_config.ipv6_domains.empty())
+    {
+        cfg._my_public_ipv6 = _services.ip_getter->getIpv6();
+        if (cfg._my_public_ipv6.empty())
+        {
+            SPDLOG_WARN("Failed to get client public IPv6 address!");
+            missing = true;
+        }
+        else
+            observe({ &cfg._client_config, "client", true, cfg._my_public_ipv6 });
+    }
+
+    const update_target target{ UpdateTargetType::Client, 0 };
+    result.observations.emplace_back(target, compare(target, cfg._my_public_ipv4, cfg._my_public_ipv6, missing));
+}
+
+void UpdatePipeline::observeHost(cycle_result & result)
+{
+    const Config & cfg = Config::getInstance();
+    if (nullptr == _services.pve_api_client)
+    {
+        SPDLOG_WARN("Invalid pve_api_client while host update is needed!");
+        return;
+    }
+
+    auto ret = _services.pve_api_client->getHostIp(cfg._host_config.node, cfg._host_config.iface);
+    result.host_v4_addr = ret.first;
+    result.host_v6_addr = ret.second;
+    if (!cfg._host_config.ipv4_domains.empty())
+    {
+        if (ret.first.empty())
+        {
+            SPDLOG_WARN("Failed to get host IPv4 address!");
+            result.address_missing = true;
+        }
+        else
+            observe({ &cfg._host_config, "host", false, ret.first });
+    }
+
+    if (!cfg._host_config.ipv6_domains.empty())
+    {
+        if (ret.second.empty())
+        {
+            SPDLOG_WARN("Failed to get host IPv6 address!");
+            result.address_missing = true;
+        }
+        else
+            observe({ &cfg._host_config, "host", true, ret.second });
+    }
+
+    const update_target target{ UpdateTargetType::Host, 0 };
+    result.observations.emplace_back(target, compare(target, ret.first, ret.second, result.address_missing));
+}
+
+void UpdatePipeline::observeGuests(const std::vector<int> & vmids, cycle_result & result)
+{
+    const Config & cfg = Config::getInstance();
+    if (nullptr == _services.pve_api_client || nullptr == _services.pve_pct_wrapper)
+    {
+        SPDLOG_WARN("Invalid pve_api_client and/or pve_pct_wrapper while guest update is needed!");
+        return;
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    // Each result is observed as soon as it is in, the batch is waited for to time the discovery
+    guest_batch batch;
+    batch.result = &result;
+    for (const int vmid : vmids)
+    {
+        const auto found = cfg._guest_configs.find(vmid);
+        if (cfg._guest_configs.end() == found)
+            continue;
+        {
+            std::lock_guard<std::mutex> lock(batch.mutex);
+            ++batch.remaining;
+        }
+        if (!_discoveries.push({ vmid, &found->second, &batch }))
+        {
+            std::lock_guard<std::mutex> lock(batch.mutex);
+            --batch.remaining;
+        }
+    }
+    std::unique_lock<std::mutex> lock(batch.mutex);
+    batch.finished.wait(lock, [&batch] { return 0 == batch.remaining; });
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started);
+    Metrics::getInstance().set("guest_discovery_duration_ms", static_cast<double>(elapsed.count()));
+    SPDLOG_DEBUG("Discovered {} guest(s) with {} worker(s) in {} ms.", vmids.size(), _discovery_workers.size(),
+                 elapsed.count());
+}
+
+void UpdatePipeline::discoverLoop()
+{
+    guest_discovery discovery;
+    while (_discoveries.pop(discovery))
+        discoverGuest(discovery);
+}
+
+void UpdatePipeline::discoverGuest(const guest_discovery & discovery)
+{
+    const Config & cfg = Config::getInstance();
+    const int vmid = discovery.vmid;
+    const config_node & guest = *discovery.guest;
+    const bool is_lxc = _services.pve_pct_wrapper->isLxcGuest(vmid);
+    const auto ret = is_lxc
+        ? _services.pve_pct_wrapper->getGuestIp(vmid, guest.iface, cfg._guest_discovery_timeout)
+        : _services.pve_api_client->getGuestIp(guest.node, vmid, guest.iface,
+                                               std::chrono::steady_clock::now() + cfg._guest_discovery_timeout);
+
+    const std::string target = fmt::format("guest(vmid: {})", vmid);
+    bool missing = false;
+    if (!guest.ipv4_domains.empty())
+    {
+        if (ret.first.empty())
+        {
+            SPDLOG_WARN("Failed to get {} IPv4 address!", target);
+            missing = true;
+        }
+        else
+            observe({ &guest, target, false, ret.first });
+    }
+
+    if (!guest.ipv6_domains.empty())
+    {
+        if (ret.second.empty())
+        {
+            SPDLOG_WARN("Failed to get {} IPv6 address!", target);
+            missing = true;
+        }
+        else
+            observe({ &guest, target, true, ret.second });
+    }
+
+    const update_target guest_target{ UpdateTargetType::Guest, vmid };
+    const TargetObservation observation = compare(guest_target, ret.first, ret.second, missing);
+
+    guest_batch & batch = *discovery.batch;
+    std::lock_guard<std::mutex> lock(batch.mutex);
+    batch.result->address_missing = batch.result->address_missing || missing;
+    batch.result->observations.emplace_back(guest_target, observation);
+    _guest_v6_addrs[vmid] = { is_lxc, ret.second };
+    // Notified under lock, the batch lives on the guest observer stack and is gone once it sees none remaining
+    if (0 == --batch.remaining)
+        batch.finished.notify_all();
+}
+
+TargetObservation UpdatePipeline::compare(const update_target & target, const std::string & v4,
+                                          const std::string & v6, const bool failed)
+{
+    if (failed)
+        return TargetObservation::Failed;
+    const std::string addrs = fmt::format("{} {}", v4, v6);
+    std::lock_guard<std::mutex> lock(_observed_mutex);
+    const auto inserted = _observed.emplace(get_update_target_name(target), addrs);
+    if (inserted.second || inserted.first->second == addrs)
+        return TargetObservation::Unchanged;
+    inserted.first->second = addrs;
+    return TargetObservation::Changed;
+}
+
+void UpdatePipeline::planLoop()
+{
+    address_sample sample;
+    while (_samples.pop(sample))
+    {
+        plan(sample);
+        done(false);
+    }
+}
+
+void UpdatePipeline::plan(const address_sample & sample)
+{
+    const config_node & node = *sample.node;
+    IDnsService * dns_service = nullptr;
+    if (nullptr != _services.dns_services)
+    {
+        const auto it = _services.dns_services->find(get_dns_service_key(node.dns_type, node.credentials));
+        if (_services.dns_services->end() != it)
+            dns_service = it->second;
+    }
+    const auto lane = _lanes.find(dns_service);
+    if (nullptr == dns_service || _lanes.end() == lane)
+    {
+        SPDLOG_WARN("Failed to find dns service of '{}' for {}!", node.dns_type, sample.target);
+        return;
+    }
+
+    Config & cfg = Config::getInstance();
+    auto & records = sample.is_v6 ? cfg._ipv6_records : cfg._ipv4_records;
+    const auto & domains = sample.is_v6 ? node.ipv6_domains : node.ipv4_domains;
+    const int ver = sample.is_v6 ? 6 : 4;
+    for (const auto & domain : domains)
+    {
+        record_write write;
+        {
+            std::lock_guard<std::mutex> lock(_records_mutex);
+            const auto found = records.find(domain);
+            if (records.end() == found)
+            {
+                SPDLOG_WARN("IPv{} domain '{}' dns record not found!", ver, domain);
+                continue;
+            }
+            // A record already being written is compared again next cycle
+            if (found->second.last_ip == sample.ip || !_writing.insert(record_key(sample.is_v6, domain)).second)
+                continue;
+            write = { dns_service, domain, sample.is_v6, found->second.last_ip, sample.ip };
+        }
+        SPDLOG_INFO("IPv{} domain '{}' dns record address changed from '{}' to '{}', updating...",
+                    ver, domain, write.old_ip, write.new_ip);
+
+        {
+            std::lock_guard<std::mutex> lock(_pending_mutex);
+            ++_pending;
+        }
+        if (!lane->second->writes.push(std::move(write)))
+        {
+            std::lock_guard<std::mutex> lock(_records_mutex);
+            _writing.erase(record_key(sample.is_v6, domain));
+            done(false);
+        }
+    }
+}
+
+void UpdatePipeline::applyLoop(apply_lane & lane)
+{
+    record_write write;
+    while (lane.writes.pop(write))
+        apply(write);
+}
+
+void UpdatePipeline::apply(const record_write & write)
+{
+    const int ver = write.is_v6 ? 6 : 4;
+    const bool ok = write.is_v6 ? write.dns_service->setIpv6(write.domain, write.new_ip)
+                                : write.dns_service->setIpv4(write.domain, write.new_ip);
+    auto & metrics = Metrics::getInstance();
+    metrics.add("pipeline_record_writes_total");
+    if (ok)
+    {
+        SPDLOG_INFO("IPv{} record of domain '{}' successfully updated from '{}' to '{}'.",
+                    ver, write.domain, write.old_ip, write.new_ip);
+        const auto & notify_service = _services.notify_service;
+        if (nullptr != notify_service)
+        {
+            // Notify services run on a single Lua state, so notifications of all apply lanes go one at a time
+            std::lock_guard<std::mutex> lock(_notify_mutex);
+            if (!notify_service->notifyIpChange(write.is_v6, write.domain, write.old_ip, write.new_ip))
+                SPDLOG_WARN("Failed to notifyIpChange using service {}!", notify_service->getServiceName());
+            else
+                SPDLOG_DEBUG("notifyIpChange using service {} successfully called.", notify_service->getServiceName());
+        }
+    }
+    else
+    {
+        metrics.add("pipeline_record_write_failures_total");
+        SPDLOG_WARN("Failed to update IPv{} record from '{}' to '{}' of domain '{}'!",
+                    ver, write.old_ip, write.new_ip, write.domain);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_records_mutex);
+        if (ok)
+        {
+            Config & cfg = Config::getInstance();
+            auto & record = (write.is_v6 ? cfg._ipv6_records : cfg._ipv4_records)[write.domain];
+            record.last_ip = write.new_ip;
+            record.last_get_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()
+            );
+        }
+        _writing.erase(record_key(write.is_v6, write.domain));
+    }
+    done(!ok);
+}
@@ -0,0 +1,242 @@
+#ifndef PVE_DDNS_CLIENT_SRC_PIPELINE_UPDATE_PIPELINE_H
+#define PVE_DDNS_CLIENT_SRC_PIPELINE_UPDATE_PIPELINE_H
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "update_scheduler.h"
+#include "../config.h"
+
+class IDnsService;
+class INotifyService;
+class IPublicIpGetter;
+class PveApiClient;
+class PvePctWrapper;
+
+/// Services used by the update pipeline, PVE ones may be nullptr if no host or guest is configured
+typedef struct pipeline_services_
+{
+    std::shared_ptr<IPublicIpGetter> ip_getter;
+    std::shared_ptr<INotifyService> notify_service;
+    std::shared_ptr<std::unordered_map<size_t, IDnsService *>> dns_services;
+    std::shared_ptr<PveApiClient> pve_api_client;
+    std::shared_ptr<PvePctWrapper> pve_pct_wrapper;
+} pipeline_services;
+
+/// Address observed for a config node, produced by observers and consumed by the planner
+typedef struct address_sample_
+{
+    /// Config node whose domains take the address
+    const config_node * node = nullptr;
+    /// Target description for logs, e.g. client, host, guest(vmid: 100)
+    std::string target;
+    bool is_v6 = false;
+    std::string ip;
+} address_sample;
+
+/// DNS record write planned by the planner and executed by an applier
+typedef struct record_write_
+{
+    IDnsService * dns_service = nullptr;
+    std::string domain;
+    bool is_v6 = false;
+    std::string old_ip;
+    std::string new_ip;
+} record_write;
+
+/// Outcome of one update cycle
+typedef struct cycle_result_
+{
+    /// Host addresses, empty if host is not configured or failed to get
+    std::string host_v4_addr;
+    std::string host_v6_addr;
+    /// Guest IPv6 address of lowest vmid (KVM guests preferred), for host static IPv6 address sync.
+    /// Host and guest addresses are the last known ones for targets not due in the cycle.
+    std::string guest_v6_addr;
+    /// Host or a guest was observed in the cycle
+    bool pve_observed = false;
+    /// A configured host or guest address failed to get
+    bool address_missing = false;
+    /// Record writes failed in this cycle
+    size_t failed_writes = 0;
+    /// What the cycle saw of each due target, for adaptive polling
+    std::vector<std::pair<update_target, TargetObservation>> observations;
+} cycle_result;
+
+/// Update cycle split into stages connected by bounded queues: observers (client, host, guests) produce address
+/// samples concurrently, the planner diffs them against Config::_ipv4_records/_ipv6_records, and appliers
+/// write changed records and notify. A slow guest agent query no longer holds back client or host updates.
+/// Each DNS service instance has its own apply lane, so providers are written to in parallel, and instances
+/// that allow it take several writes at once (still held to the provider rate limit by the HTTP engine).
+class UpdatePipeline
+{
+public:
+    /// Constructor
+    /// \param services Services used by the stages
+    /// \param queue_size Capacity of each stage queue
+    /// \param write_concurrency Max concurrent writes per DNS service instance that allows it
+    UpdatePipeline(pipeline_services services, size_t queue_size, int write_concurrency);
+    ~UpdatePipeline();
+    UpdatePipeline(UpdatePipeline const &) = delete;
+    UpdatePipeline & operator=(UpdatePipeline const &) = delete;
+
+    /// \brief Start observer, planner and apply lane threads
+    void start();
+
+    /// \brief Stop stages, queued samples and writes are finished first
+    void stop();
+
+    /// \brief Run one update cycle, given targets are handed to the observer threads (client, host and guests run
+    /// concurrently), returns when all writes are done
+    /// \param targets Targets due in this cycle
+    /// \return Cycle result
+    cycle_result runCycle(const std::vector<update_target> & targets);
+
+    /// \brief Feed an address observed outside of runCycle, e.g. a synced host address
+    /// \param sample Address sample
+    /// \return False if the pipeline is stopped
+    bool observe(address_sample sample);
+
+    /// \brief Feed a host address changed outside of runCycle, e.g. by host static IPv6 sync, it becomes the last
+    /// known host address, only called by runCycle caller
+    /// \param is_v6 Is IPv6 address
+    /// \param ip Address
+    /// \return False if the pipeline is stopped
+    bool setHostAddress(bool is_v6, const std::string & ip);
+
+    /// \brief Wait until every observed sample is planned and every planned write is done
+    /// \return Number of writes failed since previous call
+    size_t waitIdle();
+
+private:
+    /// Observation of one cycle handed to an observer thread
+    typedef struct observe_job_
+    {
+        /// Guests to observe, only for the guest observer
+        std::vector<int> vmids;
+        /// Filled by the observer, owned by runCycle
+        cycle_result * result = nullptr;
+    } observe_job;
+
+    /// Observer thread of one target type, lives as long as the pipeline so per-thread state (e.g. HTTP arena) is
+    /// reused across cycles
+    typedef struct observer_
+    {
+        explicit observer_(const UpdateTargetType type) : type(type), jobs(1) {}
+        const UpdateTargetType type;
+        BoundedQueue<observe_job> jobs;
+        std::thread thread;
+    } observer;
+
+    /// Guests of one observeGuests call, discovered by the discovery workers
+    typedef struct guest_batch_
+    {
+        /// Guards result, remaining and _guest_v6_addrs
+        std::mutex mutex;
+        std::condition_variable finished;
+        /// Guests not yet discovered
+        size_t remaining = 0;
+        cycle_result * result = nullptr;
+    } guest_batch;
+
+    /// Address query of one guest handed to a discovery worker
+    typedef struct guest_discovery_
+    {
+        int vmid = 0;
+        const config_node * guest = nullptr;
+        guest_batch * batch = nullptr;
+    } guest_discovery;
+
+    /// Writes to one DNS service instance
+    typedef struct apply_lane_
+    {
+        explicit apply_lane_(const size_t capacity) : writes(capacity) {}
+        BoundedQueue<record_write> writes;
+        std::vector<std::thread> workers;
+    } apply_lane;
+
+    void observeLoop(observer & obs);
+    /// \brief Hand a job to an observer, it is pending until the observer is done with it
+    /// \param obs Observer
+    /// \param job Job
+    void dispatch(observer & obs, observe_job job);
+    void observeClient(cycle_result & result);
+    void observeHost(cycle_result & result);
+    void observeGuests(const std::vector<int> & vmids, cycle_result & result);
+    void discoverLoop();
+    void discoverGuest(const guest_discovery & discovery);
+
+    void planLoop();
+    void plan(const address_sample & sample);
+    void applyLoop(apply_lane & lane);
+    void apply(const record_write & write);
+
+    /// \brief Compare addresses of a target against its last observation and remember them
+    /// \param target Target
+    /// \param v4 IPv4 address
+    /// \param v6 IPv6 address
+    /// \param failed A configured address failed to get, last observation is kept
+    /// \return Observation, the first one of a target is unchanged
+    TargetObservation compare(const update_target & target, const std::string & v4, const std::string & v6,
+                              bool failed);
+
+    /// \brief Mark one observer job, sample or write done
+    /// \param failed Write failed
+    void done(bool failed);
+
+    /// Services used by the stages
+    pipeline_services _services;
+    /// Observers, fed by runCycle
+    observer _client_observer{ UpdateTargetType::Client };
+    observer _host_observer{ UpdateTargetType::Host };
+    observer _guest_observer{ UpdateTargetType::Guest };
+    /// Guest observer to discovery workers, guests are queried concurrently by a fixed pool
+    BoundedQueue<guest_discovery> _discoveries;
+    std::vector<std::thread> _discovery_workers;
+    /// Observers to planner
+    BoundedQueue<address_sample> _samples;
+    /// Capacity of each stage queue
+    size_t _queue_size;
+    /// Max concurrent writes per DNS service instance that allows it
+    int _write_concurrency;
+    std::thread _planner;
+    /// Planner to appliers, lanes by DNS service instance
+    std::unordered_map<IDnsService *, std::unique_ptr<apply_lane>> _lanes;
+
+    /// Guards record state (Config::_ipv4_records/_ipv6_records) and _writing
+    std::mutex _records_mutex;
+    /// Records with a write queued or in progress, "4 domain" or "6 domain"
+    std::unordered_set<std::string> _writing;
+
+    /// Last known host addresses, only used by runCycle caller
+    std::string _host_v4_addr;
+    std::string _host_v6_addr;
+    /// Last known guest IPv6 addresses by vmid, pair of is LXC and address (empty if none)
+    std::map<int, std::pair<bool, std::string>> _guest_v6_addrs;
+
+    /// Guards _observed
+    std::mutex _observed_mutex;
+    /// Last observed addresses by target name, "v4 v6"
+    std::unordered_map<std::string, std::string> _observed;
+
+    /// Serializes notify service calls from apply lanes
+    std::mutex _notify_mutex;
+
+    /// Guards _pending and _failed
+    std::mutex _pending_mutex;
+    std::condition_variable _idle;
+    /// Observer jobs, samples and writes not yet done
+    size_t _pending = 0;
+    /// Writes failed since last waitIdle
+    size_t _failed = 0;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_PIPELINE_UPDATE_PIPELINE_H
@@ -0,0 +1,158 @@
+#include "update_scheduler.h"
+
+#include <algorithm>
+
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+
+#include "../metrics.h"
+
+std::string get_update_target_name(const update_target & target)
+{
+    switch (target.type)
+    {
+        case UpdateTargetType::Client: return "client";
+        case UpdateTargetType::Host: return "host";
+        case UpdateTargetType::Guest: return fmt::format("guest(vmid: {})", target.vmid);
+    }
+    return "unknown";
+}
+
+void UpdateScheduler::add(const update_target & target, const std::chrono::milliseconds interval,
+                          const adaptive_polling_config & adaptive)
+{
+    target_state state;
+    state.target = target;
+    state.base_interval = std::max(std::chrono::milliseconds(1), interval);
+    state.interval = state.base_interval;
+    state.adaptive = adaptive;
+    state.last_run = std::chrono::steady_clock::now();
+    state.fast_until = state.last_run;
+    state.due = state.last_run;
+    _index[{ static_cast<int>(target.type), target.vmid }] = _targets.size();
+    _entries.push({ state.last_run, _targets.size(), state.generation });
+    _targets.push_back(state);
+    if (adaptive.enabled)
+    {
+        Metrics::getInstance().set(fmt::format("update_interval_ms{{target=\"{}\"}}", get_update_target_name(target)),
+                                   static_cast<double>(state.interval.count()));
+    }
+}
+
+std::vector<update_target> UpdateScheduler::popDue(const std::chrono::steady_clock::time_point now)
+{
+    std::vector<update_target> due;
+    std::vector<entry> rescheduled;
+    while (!_entries.empty() && _entries.top().due <= now)
+    {
+        entry e = _entries.top();
+        _entries.pop();
+        target_state & state = _targets[e.index];
+        // Superseded by a reschedule in report
+        if (e.generation != state.generation)
+            continue;
+        due.push_back(state.target);
+        state.last_run = now;
+        e.due += state.interval;
+        if (e.due <= now)
+            e.due = now + state.interval;
+        state.due = e.due;
+        rescheduled.push_back(e);
+    }
+    for (const auto & e : rescheduled)
+        _entries.push(e);
+    prune();
+    return due;
+}
+
+void UpdateScheduler::report(const update_target & target, const TargetObservation observation,
+                             const std::chrono::steady_clock::time_point now)
+{
+    target_state * state = find(target);
+    if (nullptr == state || !state->adaptive.enabled)
+        return;
+
+    const adaptive_polling_config & adaptive = state->adaptive;
+    const std::string name = get_update_target_name(target);
+    std::chrono::milliseconds interval = state->interval;
+    const char * reason = "";
+    switch (observation)
+    {
+        case TargetObservation::Changed:
+            // Never slower than configured on a change
+            interval = std::min(adaptive.fast_interval, state->base_interval);
+            state->fast_until = now + adaptive.fast_window;
+            reason = "address changed";
+            Metrics::getInstance().add(fmt::format("adaptive_fast_mode_total{{target=\"{}\"}}", name));
+            break;
+        case TargetObservation::Unchanged:
+            if (now < state->fast_until)
+                break;
+            {
+                const auto max_interval = std::max(state->base_interval, adaptive.max_interval);
+                const auto stretched = std::chrono::milliseconds(static_cast<int64_t>(
+                    static_cast<double>(interval.count()) * adaptive.backoff_factor));
+                interval = std::min(max_interval, std::max(state->base_interval, stretched));
+            }
+            reason = "address unchanged";
+            break;
+        case TargetObservation::Failed:
+            break;
+    }
+    if (interval == state->interval)
+        return;
+
+    SPDLOG_INFO("Update interval of {} changed from {} ms to {} ms, {}.",
+                name, state->interval.count(), interval.count(), reason);
+    Metrics::getInstance().set(fmt::format("update_interval_ms{{target=\"{}\"}}", name),
+                               static_cast<double>(interval.count()));
+    state->interval = interval;
+    // Previous heap entry of this target is skipped by generation
+    ++state->generation;
+    state->due = std::max(now, state->last_run + interval);
+    _entries.push({ state->due, static_cast<size_t>(state - _targets.data()), state->generation });
+    prune();
+}
+
+void UpdateScheduler::wake(const update_target & target, const std::chrono::steady_clock::time_point at)
+{
+    target_state * state = find(target);
+    if (nullptr == state || state->due <= at)
+        return;
+    ++state->generation;
+    state->due = at;
+    _entries.push({ at, static_cast<size_t>(state - _targets.data()), state->generation });
+    prune();
+}
+
+std::chrono::steady_clock::time_point UpdateScheduler::nextDue() const
+{
+    return _entries.empty() ? std::chrono::steady_clock::time_point::max() : _entries.top().due;
+}
+
+std::chrono::milliseconds UpdateScheduler::minInterval(const std::vector<update_target> & targets) const
+{
+    std::chrono::milliseconds interval(0);
+    for (const auto & target : targets)
+    {
+        const auto it = _index.find({ static_cast<int>(target.type), target.vmid });
+        if (_index.end() == it)
+            continue;
+        const auto & state = _targets[it->second];
+        if (0 == interval.count() || state.interval < interval)
+            interval = state.interval;
+    }
+    return interval;
+}
+
+void UpdateScheduler::prune()
+{
+    while (!_entries.empty() && _entries.top().generation != _targets[_entries.top().index].generation)
+        _entries.pop();
+}
+
+UpdateScheduler::target_state * UpdateScheduler::find(const update_target & target)
+{
+    const auto it = _index.find({ static_cast<int>(target.type), target.vmid });
+    return _index.end() == it ? nullptr : &_targets[it->second];
+}
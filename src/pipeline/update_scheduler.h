@@ -0,0 +1,142 @@
+#ifndef PVE_DDNS_CLIENT_SRC_PIPELINE_UPDATE_SCHEDULER_H
+#define PVE_DDNS_CLIENT_SRC_PIPELINE_UPDATE_SCHEDULER_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../config.h"
+
+/// Kind of update target
+enum class UpdateTargetType
+{
+    Client,
+    Host,
+    Guest
+};
+
+/// Target whose address is observed on its own interval
+typedef struct update_target_
+{
+    UpdateTargetType type = UpdateTargetType::Client;
+    /// Guest vmid, 0 for client and host
+    int vmid = 0;
+} update_target;
+
+/// What an update cycle saw of a target, drives adaptive polling
+enum class TargetObservation
+{
+    /// Addresses are the same as last observation
+    Unchanged,
+    /// Any address differs from last observation
+    Changed,
+    /// A configured address failed to get, interval is kept
+    Failed
+};
+
+/// \brief Get target description for logs, e.g. client, host, guest(vmid: 100)
+/// \param target Target
+/// \return Description
+std::string get_update_target_name(const update_target & target);
+
+/// Min-heap of update targets by due time on the monotonic clock, each target with its own interval.
+/// Targets in adaptive mode stretch their interval geometrically while the observed address stays unchanged, and
+/// snap to a fast interval for a window after a change. Heap entries of a target whose interval changed are left
+/// in place and skipped by generation, the top entry is always a current one.
+class UpdateScheduler
+{
+public:
+    /// \brief Add target, it is due immediately
+    /// \param target Target
+    /// \param interval Update interval, at least 1 ms, base interval in adaptive mode
+    /// \param adaptive Adaptive polling config
+    void add(const update_target & target, std::chrono::milliseconds interval,
+             const adaptive_polling_config & adaptive = adaptive_polling_config());
+
+    /// \brief Report what a cycle saw of a target, adaptive targets adjust their interval and are rescheduled from
+    /// their last run
+    /// \param target Target
+    /// \param observation Observation
+    /// \param now Current time
+    void report(const update_target & target, TargetObservation observation,
+                std::chrono::steady_clock::time_point now);
+
+    /// \brief Make a target due at given time if it is not due earlier, e.g. on an address change event. Its
+    /// interval is kept, next run after it is an interval later.
+    /// \param target Target
+    /// \param at Time
+    void wake(const update_target & target, std::chrono::steady_clock::time_point at);
+
+    /// \brief Take targets due at given time and schedule their next run. Next run keeps the target's phase,
+    /// runs missed while the process was busy are skipped rather than caught up.
+    /// \param now Current time
+    /// \return Due targets, ordered by due time
+    std::vector<update_target> popDue(std::chrono::steady_clock::time_point now);
+
+    /// \brief Get time the next target is due
+    /// \return Due time, max if there is no target
+    std::chrono::steady_clock::time_point nextDue() const;
+
+    /// \brief Get shortest interval of given targets
+    /// \param targets Targets
+    /// \return Interval, zero if none of them is scheduled
+    std::chrono::milliseconds minInterval(const std::vector<update_target> & targets) const;
+
+    /// \brief Check if no target is scheduled
+    /// \return Result
+    bool empty() const { return _entries.empty(); }
+
+private:
+    typedef struct target_state_
+    {
+        update_target target;
+        /// Configured interval
+        std::chrono::milliseconds base_interval;
+        /// Current interval, differs from base_interval only in adaptive mode
+        std::chrono::milliseconds interval;
+        adaptive_polling_config adaptive;
+        /// Time of last popDue of this target
+        std::chrono::steady_clock::time_point last_run;
+        /// Time of next run
+        std::chrono::steady_clock::time_point due;
+        /// Fast interval is held until this time
+        std::chrono::steady_clock::time_point fast_until;
+        /// Bumped whenever the target is rescheduled out of order
+        uint64_t generation = 0;
+    } target_state;
+
+    typedef struct entry_
+    {
+        std::chrono::steady_clock::time_point due;
+        /// Index into _targets
+        size_t index;
+        uint64_t generation;
+    } entry;
+
+    /// Orders the heap so the earliest due entry is on top
+    struct later
+    {
+        bool operator()(const entry & a, const entry & b) const { return a.due > b.due; }
+    };
+
+    /// \brief Find state of a target
+    /// \param target Target
+    /// \return State, nullptr if not added
+    target_state * find(const update_target & target);
+
+    /// \brief Pop superseded entries off the top of the heap, so nextDue is the due time of a current entry
+    void prune();
+
+    /// Scheduled targets
+    std::priority_queue<entry, std::vector<entry>, later> _entries;
+    /// All added targets
+    std::vector<target_state> _targets;
+    /// Index into _targets by target type and vmid
+    std::map<std::pair<int, int>, size_t> _index;
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_PIPELINE_UPDATE_SCHEDULER_H
@@ -10,7 +10,8 @@
 #include "public_ip_getter_ipify.h"
 #include "public_ip_getter_lua.h"
 
-IPublicIpGetter * PublicIpGetterFactory::create(const std::string & service_name)
+IPublicIpGetter * PublicIpGetterFactory::create(const std::string & service_name,
+                                                const std::shared_ptr<IHttpTransport> & transport)
 {
     if (service_name.empty())
     {
@@ -31,7 +32,7 @@ IPublicIpGetter * PublicIpGetterFactory::create(const std::string & service_name
 
     if (str_iequals(service_name, PUBLIC_IP_GETTER_PORKBUN))
     {
-        auto * getter = new(std::nothrow) PublicIpGetterPorkbun();
+        auto * getter = new(std::nothrow) PublicIpGetterPorkbun(transport);
         if (nullptr == getter)
         {
             SPDLOG_ERROR("Failed to instantiate PublicIpGetterPorkbun!");
@@ -42,7 +43,7 @@ IPublicIpGetter * PublicIpGetterFactory::create(const std::string & service_name
 
     if (str_iequals(service_name, PUBLIC_IP_GETTER_IPIFY))
     {
-        auto * getter = new(std::nothrow) PublicIpGetterIpify();
+        auto * getter = new(std::nothrow) PublicIpGetterIpify(transport);
         if (nullptr == getter)
         {
             SPDLOG_ERROR("Failed to instantiate PublicIpGetterIpify!");
@@ -52,7 +53,7 @@ IPublicIpGetter * PublicIpGetterFactory::create(const std::string & service_name
     }
 
     // Try loading the LUA module with the service_name
-    auto * getter = new(std::nothrow) PublicIpGetterLua();
+    auto * getter = new(std::nothrow) PublicIpGetterLua(transport);
     if (nullptr == getter)
     {
         SPDLOG_ERROR("Failed to instantiate PublicIpGetterLua!");
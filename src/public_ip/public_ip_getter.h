@@ -1,8 +1,11 @@
 #ifndef PVE_DDNS_CLIENT_SRC_PUBLIC_IP_PUBLIC_IP_GETTER_H
 #define PVE_DDNS_CLIENT_SRC_PUBLIC_IP_PUBLIC_IP_GETTER_H
 
+#include <memory>
 #include <string>
 
+class IHttpTransport;
+
 /// Public IP getter implementations
 constexpr const char * PUBLIC_IP_GETTER_IFACE = "iface";
 constexpr const char * PUBLIC_IP_GETTER_PORKBUN = "porkbun";
@@ -37,8 +40,9 @@ class PublicIpGetterFactory
 public:
     /// Create public IP getter instance
     /// \param service_name Service name
+    /// \param transport HTTP transport used by the instance
     /// \return Instance pointer or nullptr if failed
-    static IPublicIpGetter * create(const std::string & service_name);
+    static IPublicIpGetter * create(const std::string & service_name, const std::shared_ptr<IHttpTransport> & transport);
 
     /// Destroy public IP getter instance
     /// \param ip_getter Instance pointer
@@ -6,9 +6,12 @@
 
 #include "../utils.h"
 #include "../config.h"
+#include "../http/http_arena.h"
+#include "../http/http_headers.h"
 
 static constexpr const char * API_HOST = "https://api6.ipify.org/?format=json";
 static constexpr const char * API_HOST_V4 = "https://api.ipify.org/?format=json";
+static constexpr const char * HTTP_TIMEOUTS_SERVICE = "public-ip";
 
 const std::string & PublicIpGetterIpify::getServiceName()
 {
@@ -38,18 +41,20 @@ std::string PublicIpGetterIpify::getIpv6()
     return v6_ip;
 }
 
-std::string PublicIpGetterIpify::getIp(const std::string & api_host)
+std::string PublicIpGetterIpify::getIp(const std::string & api_host) const
 {
     int resp_code = 0;
-    std::string resp_data;
-    const bool ret = http_req(api_host, "", Config::getInstance()._http_timeout_ms, {}, resp_code, resp_data);
+    HttpArena arena;
+    std::string & resp_data = arena.buffer();
+    const bool ret = http_req(*_transport, api_host, "", Config::getInstance().getHttpTimeouts(HTTP_TIMEOUTS_SERVICE),
+                              HttpHeaders(), "", "", "public_ip.ipify", resp_code, resp_data);
     if (!ret || 200 != resp_code)
     {
         SPDLOG_WARN("Failed to request '{}', response code is {}, response is {}!", api_host, resp_code, resp_data);
         return "";
     }
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.Parse(resp_data.c_str());
+    ArenaDocument & d = arena.document();
+    rapidjson::ParseResult ok = arena.parse();
     if (!ok)
     {
         SPDLOG_WARN("Failed to parse response json, error '{}' ({})", 
@@ -1,23 +1,30 @@
 #ifndef PVE_DDNS_CLIENT_SRC_PUBLIC_IP_PUBLIC_IP_GETTER_IPIFY_H
 #define PVE_DDNS_CLIENT_SRC_PUBLIC_IP_PUBLIC_IP_GETTER_IPIFY_H
 
+#include <memory>
+
 #include "public_ip_getter.h"
+#include "../http/http_transport.h"
 
 /// Public IP getter using ipify APIs
 class PublicIpGetterIpify : public IPublicIpGetter
 {
 public:
+    explicit PublicIpGetterIpify(std::shared_ptr<IHttpTransport> transport) : _transport(std::move(transport)) {}
+
     const std::string & getServiceName() override;
     bool setCredentials(const std::string & cred_str) override;
     std::string getIpv4() override;
     std::string getIpv6() override;
 
 protected:
-    static std::string getIp(const std::string & api_host);
+    std::string getIp(const std::string & api_host) const;
 
 private:
     /// Service name
     std::string _service_name = PUBLIC_IP_GETTER_IPIFY;
+    /// HTTP transport
+    std::shared_ptr<IHttpTransport> _transport;
 };
 
 #endif //PVE_DDNS_CLIENT_SRC_PUBLIC_IP_PUBLIC_IP_GETTER_IPIFY_H
@@ -13,6 +13,7 @@
 #include "../lua_utils.h"
 
 PublicIpGetterLua::PublicIpGetterLua(PublicIpGetterLua && other) noexcept
+    : _ls(other._ls), _transport(std::move(other._transport))
 {
     other._ls = nullptr;
 }
@@ -24,6 +25,7 @@ PublicIpGetterLua & PublicIpGetterLua::operator=(PublicIpGetterLua && other) noe
         lua_close(_ls);
         _ls = other._ls;
         other._ls = nullptr;
+        _transport = std::move(other._transport);
     }
     return *this;
 }
@@ -41,7 +43,7 @@ bool PublicIpGetterLua::loadModule(const std::string & module_name)
     file_name.append(".lua");
     mdl_path /= file_name;
 
-    _ls = lua_load_module("LUA public IP getter", mdl_path.string());
+    _ls = lua_load_module("LUA public IP getter", mdl_path.string(), _transport.get());
     if (nullptr == _ls)
     {
         SPDLOG_WARN("Failed to lua_load_module {}!", mdl_path.string());
@@ -1,7 +1,10 @@
 #ifndef PVE_DDNS_CLIENT_SRC_PUBLIC_IP_PUBLIC_IP_GETTER_LUA_H
 #define PVE_DDNS_CLIENT_SRC_PUBLIC_IP_PUBLIC_IP_GETTER_LUA_H
 
+#include <memory>
+
 #include "public_ip_getter.h"
+#include "../http/http_transport.h"
 
 typedef struct lua_State lua_State;
 
@@ -9,7 +12,7 @@ typedef struct lua_State lua_State;
 class PublicIpGetterLua : public IPublicIpGetter
 {
 public:
-    PublicIpGetterLua() = default;
+    explicit PublicIpGetterLua(std::shared_ptr<IHttpTransport> transport) : _transport(std::move(transport)) {}
     PublicIpGetterLua(const PublicIpGetterLua & other) = delete;
     PublicIpGetterLua & operator=(const PublicIpGetterLua & other) = delete;
     PublicIpGetterLua(PublicIpGetterLua && other) noexcept;
@@ -30,6 +33,8 @@ private:
     /// Service name
     std::string _service_name = PUBLIC_IP_GETTER_LUA;
     lua_State * _ls;
+    /// HTTP transport
+    std::shared_ptr<IHttpTransport> _transport;
 };
 
 #endif //PVE_DDNS_CLIENT_SRC_PUBLIC_IP_PUBLIC_IP_GETTER_LUA_H
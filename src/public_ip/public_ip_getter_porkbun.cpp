@@ -7,10 +7,13 @@
 
 #include "../utils.h"
 #include "../config.h"
+#include "../http/http_arena.h"
+#include "../http/http_headers.h"
+#include "../http/http_rate_limiter.h"
 
-static constexpr const char * API_HOST = "https://api.porkbun.com/api/json/v3/";
-static constexpr const char * API_HOST_V4 = "https://api-ipv4.porkbun.com/api/json/v3/";
-static constexpr const char * API_PING = "ping";
+static constexpr const char * API_PING = "https://api.porkbun.com/api/json/v3/ping";
+static constexpr const char * API_PING_V4 = "https://api-ipv4.porkbun.com/api/json/v3/ping";
+static constexpr const char * HTTP_TIMEOUTS_SERVICE = "public-ip";
 
 const std::string & PublicIpGetterPorkbun::getServiceName()
 {
@@ -32,18 +35,21 @@ bool PublicIpGetterPorkbun::setCredentials(const std::string & cred_str)
     }
     _api_key = cred_str.substr(0, comma_pos);
     _api_secret = cred_str.substr(comma_pos + 1);
+    _auth_body = fmt::format(R"({{"secretapikey":"{}","apikey":"{}"}})", _api_secret, _api_key);
+    // Same account quota as porkbun dns service
+    _rate_limit_key = HttpRateLimiter::getInstance().getKey(_service_name, cred_str);
 
     return true;
 }
 
 std::string PublicIpGetterPorkbun::getIpv4()
 {
-    return getIp(API_HOST_V4);
+    return getIp(API_PING_V4);
 }
 
 std::string PublicIpGetterPorkbun::getIpv6()
 {
-    std::string v6_ip = getIp(API_HOST);
+    std::string v6_ip = getIp(API_PING);
     if (!is_ipv6(v6_ip))
     {
         SPDLOG_WARN("'{}' is not valid IPv6 ip!", v6_ip);
@@ -52,20 +58,22 @@ std::string PublicIpGetterPorkbun::getIpv6()
     return v6_ip;
 }
 
-std::string PublicIpGetterPorkbun::getIp(const std::string & api_host) const
+std::string PublicIpGetterPorkbun::getIp(const std::string & req_url) const
 {
-    const std::string req_url = fmt::format("{}{}", api_host, API_PING);
-    const std::string req_body = fmt::format(R"({{"secretapikey":"{}","apikey":"{}"}})", _api_secret, _api_key);
+    const std::string & req_body = _auth_body;
     int resp_code = 0;
-    std::string resp_data;
-    const bool ret = http_req(req_url, req_body, Config::getInstance()._http_timeout_ms, {}, resp_code, resp_data);
+    HttpArena arena;
+    std::string & resp_data = arena.buffer();
+    const bool ret = http_req(*_transport, req_url, req_body,
+                              Config::getInstance().getHttpTimeouts(HTTP_TIMEOUTS_SERVICE), HttpHeaders(), "",
+                              _rate_limit_key, "public_ip.porkbun_ping", resp_code, resp_data);
     if (!ret || 200 != resp_code)
     {
         SPDLOG_WARN("Failed to request '{}', response code is {}, response is {}!", req_url, resp_code, resp_data);
         return "";
     }
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.Parse(resp_data.c_str());
+    ArenaDocument & d = arena.document();
+    rapidjson::ParseResult ok = arena.parse();
     if (!ok)
     {
         SPDLOG_WARN("Failed to parse response json, error '{}' ({})", 
@@ -80,7 +88,7 @@ std::string PublicIpGetterPorkbun::getIp(const std::string & api_host) const
         {
             if (d.HasMember("yourIp") && d["yourIp"].IsString())
             {
-                SPDLOG_TRACE("Successfully got my ip: {} from '{}'.", d["yourIp"].GetString(), api_host);
+                SPDLOG_TRACE("Successfully got my ip: {} from '{}'.", d["yourIp"].GetString(), req_url);
                 return d["yourIp"].GetString();
             }
         }
@@ -1,27 +1,38 @@
 #ifndef PVE_DDNS_CLIENT_SRC_PUBLIC_IP_PUBLIC_IP_GETTER_PORKBUN_H
 #define PVE_DDNS_CLIENT_SRC_PUBLIC_IP_PUBLIC_IP_GETTER_PORKBUN_H
 
+#include <memory>
+
 #include "public_ip_getter.h"
+#include "../http/http_transport.h"
 
 /// Public IP getter using Porkbun APIs
 class PublicIpGetterPorkbun : public IPublicIpGetter
 {
 public:
+    explicit PublicIpGetterPorkbun(std::shared_ptr<IHttpTransport> transport) : _transport(std::move(transport)) {}
+
     const std::string & getServiceName() override;
     bool setCredentials(const std::string & cred_str) override;
     std::string getIpv4() override;
     std::string getIpv6() override;
 
 protected:
-    std::string getIp(const std::string & api_host) const;
+    std::string getIp(const std::string & req_url) const;
 
 private:
     /// Service name
     std::string _service_name = PUBLIC_IP_GETTER_PORKBUN;
+    /// HTTP transport
+    std::shared_ptr<IHttpTransport> _transport;
     /// Porkbun API key
     std::string _api_key;
     /// Porkbun secret key
     std::string _api_secret;
+    /// Prebuilt request body with credentials
+    std::string _auth_body;
+    /// Rate limiter bucket key
+    std::string _rate_limit_key;
 };
 
 #endif //PVE_DDNS_CLIENT_SRC_PUBLIC_IP_PUBLIC_IP_GETTER_PORKBUN_H
@@ -7,23 +7,27 @@
 
 #include "../config.h"
 #include "../utils.h"
+#include "../http/json_stream_extractor.h"
+#include "../http/http_arena.h"
+#include "../http/http_cache.h"
+#include "../http/http_headers.h"
+
+// URL templates, first argument is API host
+static constexpr const char * API_VERSION = "{}api2/json/version";
+static constexpr const char * API_HOST_NETWORK = "{}api2/json/nodes/{}/network/{}";
+static constexpr const char * API_HOST_NETWORK_APPLY = "{}api2/json/nodes/{}/network";
+static constexpr const char * API_GUEST_NETWORK = "{}api2/json//nodes/{}/qemu/{}/agent/network-get-interfaces";
+static constexpr const char * HTTP_TIMEOUTS_SERVICE = "pve-api";
 
-static constexpr const char * API_VERSION = "api2/json/version";
-static constexpr const char * API_HOST_NETWORK = "api2/json/nodes/{}/network/{}";
-static constexpr const char * API_HOST_NETWORK_APPLY = "api2/json/nodes/{}/network";
-static constexpr const char * API_GUEST_NETWORK = "api2/json//nodes/{}/qemu/{}/agent/network-get-interfaces";
-
-static std::string get_pve_api_http_auth_header()
+bool PveApiClient::init()
 {
     const auto & config = Config::getInstance();
+    _api_host = config._pve_api_host;
 //    Authorization: PVEAPIToken=USER@REALM!TOKENID=UUID
-    return fmt::format("Authorization: PVEAPIToken={}@{}!{}={}",
-                       config._pve_api_user, config._pve_api_realm,
-                       config._pve_api_token_id, config._pve_api_token_uuid);
-}
+    _api_token = fmt::format("{}@{}!{}={}", config._pve_api_user, config._pve_api_realm,
+                             config._pve_api_token_id, config._pve_api_token_uuid);
+    _auth_headers = HttpHeaders({ fmt::format("Authorization: PVEAPIToken={}", _api_token) });
 
-bool PveApiClient::init()
-{
     const bool ret = checkApiHost();
     if (!ret)
         SPDLOG_WARN("Failed to checkApiHost!");
@@ -32,22 +36,25 @@ bool PveApiClient::init()
 
 std::pair<std::string, std::string> PveApiClient::getHostIp(const std::string & node, const std::string & iface)
 {
-    const auto & config = Config::getInstance();
-
-    const std::string api_part = fmt::format(API_HOST_NETWORK, node, iface);
-    const std::string req_url = fmt::format("{}{}", config._pve_api_host, api_part);
+    const std::string req_url = fmt::format(API_HOST_NETWORK, _api_host, node, iface);
+    const std::string cache_key = HttpCache::getKey(req_url, "", _api_token);
 
     int resp_code = 0;
-    std::string resp_data;
-    const bool ret = req(req_url, "", resp_code, resp_data);
+    HttpArena arena;
+    std::string & resp_data = arena.buffer();
+    const bool ret = http_req(*_transport, req_url, "", Config::getInstance().getHttpTimeouts(HTTP_TIMEOUTS_SERVICE),
+                              _auth_headers, "", "", "pve.host_network", cache_key, resp_code, resp_data);
+    std::vector<std::string> cached;
+    if (ret && 304 == resp_code && HttpCache::getInstance().get(cache_key, cached) && 2 == cached.size())
+        return { cached[0], cached[1] };
     if (!ret || 200 != resp_code)
     {
         SPDLOG_WARN("Failed to request '{}', response code is {}, response is {}!", req_url, resp_code, resp_data);
         return { "", "" };
     }
 
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.Parse(resp_data.c_str());
+    ArenaDocument & d = arena.document();
+    rapidjson::ParseResult ok = arena.parse();
     if (!ok)
     {
         SPDLOG_WARN("Failed to parse response json, error '{}' ({})", 
@@ -64,6 +71,7 @@ std::pair<std::string, std::string> PveApiClient::getHostIp(const std::string &
         if (data.HasMember("address6") && data["address6"].IsString())
             v6_ip = data["address6"].GetString();
 
+        HttpCache::getInstance().update(cache_key, { v4_ip, v6_ip });
         return { v4_ip, v6_ip };
     }
 
@@ -72,95 +80,106 @@ std::pair<std::string, std::string> PveApiClient::getHostIp(const std::string &
 
 std::pair<std::string, std::string> PveApiClient::getGuestIp(const std::string & node,
                                                              const int vmid,
-                                                             const std::string & iface)
+                                                             const std::string & iface,
+                                                             const std::chrono::steady_clock::time_point deadline)
 {
-    const auto & config = Config::getInstance();
+    const std::string req_url = fmt::format(API_GUEST_NETWORK, _api_host, node, vmid);
 
-    const std::string api_part = fmt::format(API_GUEST_NETWORK, node, vmid);
-    const std::string req_url = fmt::format("{}{}", config._pve_api_host, api_part);
+    // Agent reply is parsed as it streams in, only interface names and addresses are copied out
+    std::string cur_name, cur_ip_type, cur_ip;
+    std::vector<std::pair<std::string, std::string>> cur_ips;
+    bool cur_has_ips = false;
+    bool found = false;
+    std::string v4_ip, v6_ip;
 
-    int resp_code = 0;
-    std::string resp_data;
-    const bool ret = req(req_url, "", resp_code, resp_data);
-    if (!ret || 200 != resp_code)
+    JsonStreamExtractor extractor;
+    extractor.onValue("data.result[].name", [&cur_name](const std::string & v, JsonValueType)
     {
-        SPDLOG_WARN("Failed to request '{}', response code is {}, response is {}!", req_url, resp_code, resp_data);
-        return { "", "" };
-    }
-
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.Parse(resp_data.c_str());
-    if (!ok)
+        cur_name = v;
+    });
+    extractor.onValue("data.result[].ip-addresses[].ip-address-type", [&cur_ip_type](const std::string & v,
+                                                                                    JsonValueType type)
     {
-        SPDLOG_WARN("Failed to parse response json, error '{}' ({})", 
-            rapidjson::GetParseError_En(ok.Code()), ok.Offset());
-        return { "", "" };
-    }
-
-    if (d.HasMember("data") && d["data"].IsObject())
+        if (JsonValueType::String == type)
+            cur_ip_type = v;
+    });
+    extractor.onValue("data.result[].ip-addresses[].ip-address", [&cur_ip](const std::string & v, JsonValueType)
     {
-        const auto & data = d["data"];
-        std::string v4_ip, v6_ip;
-        if (data.HasMember("result") && data["result"].IsArray())
+        cur_ip = v;
+    });
+    extractor.onEnd("data.result[].ip-addresses[]", [&cur_ips, &cur_ip_type, &cur_ip]()
+    {
+        cur_ips.emplace_back(cur_ip_type, cur_ip);
+        cur_ip_type.clear();
+        cur_ip.clear();
+    });
+    extractor.onEnd("data.result[].ip-addresses", [&cur_has_ips]()
+    {
+        cur_has_ips = true;
+    });
+    extractor.onEnd("data.result[]", [&]()
+    {
+        if (!found && cur_has_ips && cur_name == iface)
         {
-            const auto & result = data["result"].GetArray();
-            for (const auto & r : result)
+            found = true;
+            for (const auto & ip : cur_ips)
             {
-                if (r.HasMember("name") && r["name"].IsString() && r["name"].GetString() == iface)
+                if ("ipv4" == ip.first)
+                    v4_ip = ip.second;
+                else if ("ipv6" == ip.first && v6_ip.empty())
                 {
-                    if (r.HasMember("ip-addresses") && r["ip-addresses"].IsArray())
-                    {
-                        const auto & ips = r["ip-addresses"].GetArray();
-                        for (const auto & ip : ips)
-                        {
-                            if (ip.HasMember("ip-address-type") && ip["ip-address-type"].IsString())
-                            {
-                                const std::string type = ip["ip-address-type"].GetString();
-                                if ("ipv4" == type)
-                                    v4_ip = ip["ip-address"].GetString();
-                                else if ("ipv6" == type && v6_ip.empty())
-                                {
-                                    v6_ip = ip["ip-address"].GetString();
-                                    if (v6_ip.compare(0, 4, "fe80") == 0)
-                                        v6_ip.clear();
-                                }
-                            }
-                        }
-                        break;
-                    }
+                    v6_ip = ip.second;
+                    if (v6_ip.compare(0, 4, "fe80") == 0)
+                        v6_ip.clear();
                 }
             }
         }
+        cur_name.clear();
+        cur_ips.clear();
+        cur_has_ips = false;
+    });
 
-        return { v4_ip, v6_ip };
+    int resp_code = 0;
+    std::string resp_head;
+    // PVE answers 500 for guests without a running agent, that is no failure of the API endpoint
+    const bool ret = reqStream(req_url, "pve.agent_network", deadline, extractor, resp_code, resp_head, true);
+    if (!ret || 200 != resp_code)
+    {
+        SPDLOG_WARN("Failed to request '{}', response code is {}, response is {}!", req_url, resp_code, resp_head);
+        return { "", "" };
     }
 
-    return { "", "" };
+    if (!extractor.isComplete())
+    {
+        SPDLOG_WARN("Failed to parse response json, error '{}'", extractor.error());
+        return { "", "" };
+    }
+
+    return { v4_ip, v6_ip };
 }
 
 bool PveApiClient::setHostNetworkAddress(const std::string & node, const std::string & iface,
                                          const std::string & v4_ip, const std::string & v6_ip)
 {
-    const auto & config = Config::getInstance();
-
-    const std::string api_part = fmt::format(API_HOST_NETWORK, node, iface);
-    const std::string req_url = fmt::format("{}{}", config._pve_api_host, api_part);
+    const std::string req_url = fmt::format(API_HOST_NETWORK, _api_host, node, iface);
     const std::string req_body = fmt::format(R"(type=bridge&address6={}&netmask6=128&address={}&netmask=255.255.255.0)",
                                              v6_ip, v4_ip);
+    // Interface config is about to change, its cached read must not be reused even if the server would
+    HttpCache::getInstance().invalidate(HttpCache::getKey(req_url, "", _api_token));
 
     int resp_code = 0;
-    std::string resp_data;
-    std::vector<std::string> headers = { get_pve_api_http_auth_header() };
-    const bool ret = http_req(req_url, req_body, Config::getInstance()._http_timeout_ms, headers, "put",
-                              resp_code, resp_data);
+    HttpArena arena;
+    std::string & resp_data = arena.buffer();
+    const bool ret = http_req(*_transport, req_url, req_body,
+                              Config::getInstance().getHttpTimeouts(HTTP_TIMEOUTS_SERVICE), _auth_headers, "put", "",
+                              "pve.set_host_network", resp_code, resp_data);
     if (!ret || 200 != resp_code)
     {
         SPDLOG_WARN("Failed to request '{}', response code is {}, response is {}!", req_url, resp_code, resp_data);
         return false;
     }
 
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.Parse(resp_data.c_str());
+    rapidjson::ParseResult ok = arena.parse();
     if (!ok)
     {
         SPDLOG_WARN("Failed to parse response json, error '{}' ({})", 
@@ -181,24 +200,32 @@ bool PveApiClient::revertHostNetworkChange(const std::string & node)
     return reqHostNetwork("delete", node);
 }
 
-bool PveApiClient::req(const std::string & api_url, const std::string & req_data,
+bool PveApiClient::req(const std::string & api_url, const std::string & req_data, const std::string & stats_name,
                        int & resp_code, std::string & resp_data) const
 {
-    std::vector<std::string> headers = { get_pve_api_http_auth_header() };
-    return http_req(api_url, req_data, Config::getInstance()._http_timeout_ms, headers, resp_code, resp_data);
+    return http_req(*_transport, api_url, req_data, Config::getInstance().getHttpTimeouts(HTTP_TIMEOUTS_SERVICE),
+                    _auth_headers, "", "", stats_name, resp_code, resp_data);
 }
 
-bool PveApiClient::reqHostNetwork(const std::string & method, const std::string & node) const
+bool PveApiClient::reqStream(const std::string & api_url, const std::string & stats_name,
+                             const std::chrono::steady_clock::time_point deadline, JsonStreamExtractor & extractor,
+                             int & resp_code, std::string & resp_head, const bool app_server_errors) const
 {
-    const auto & config = Config::getInstance();
+    http_timeouts timeouts = Config::getInstance().getHttpTimeouts(HTTP_TIMEOUTS_SERVICE);
+    timeouts.deadline = deadline;
+    return http_req_stream(*_transport, api_url, "", timeouts, _auth_headers, "", "", stats_name, extractor,
+                           resp_code, resp_head, app_server_errors);
+}
 
-    const std::string api_part = fmt::format(API_HOST_NETWORK_APPLY, node);
-    const std::string req_url = fmt::format("{}{}", config._pve_api_host, api_part);
+bool PveApiClient::reqHostNetwork(const std::string & method, const std::string & node) const
+{
+    const std::string req_url = fmt::format(API_HOST_NETWORK_APPLY, _api_host, node);
 
     int resp_code = 0;
-    std::string resp_data;
-    std::vector<std::string> headers = { get_pve_api_http_auth_header() };
-    const bool ret = http_req(req_url, "", Config::getInstance()._http_timeout_ms, headers, method,
+    HttpArena arena;
+    std::string & resp_data = arena.buffer();
+    const bool ret = http_req(*_transport, req_url, "", Config::getInstance().getHttpTimeouts(HTTP_TIMEOUTS_SERVICE),
+                              _auth_headers, method, "", fmt::format("pve.host_network_{}", method),
                               resp_code, resp_data);
     if (!ret || 200 != resp_code)
     {
@@ -206,8 +233,7 @@ bool PveApiClient::reqHostNetwork(const std::string & method, const std::string
         return false;
     }
 
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.Parse(resp_data.c_str());
+    rapidjson::ParseResult ok = arena.parse();
     if (!ok)
     {
         SPDLOG_WARN("Failed to parse response json, error '{}' ({})", 
@@ -220,20 +246,19 @@ bool PveApiClient::reqHostNetwork(const std::string & method, const std::string
 
 bool PveApiClient::checkApiHost() const
 {
-    const auto & config = Config::getInstance();
-
-    const std::string req_url = fmt::format("{}{}", config._pve_api_host, API_VERSION);
+    const std::string req_url = fmt::format(API_VERSION, _api_host);
     int resp_code = 0;
-    std::string resp_data;
-    const bool ret = req(req_url, "", resp_code, resp_data);
+    HttpArena arena;
+    std::string & resp_data = arena.buffer();
+    const bool ret = req(req_url, "", "pve.version", resp_code, resp_data);
     if (!ret || 200 != resp_code)
     {
         SPDLOG_WARN("Failed to request '{}', response code is {}, response is {}!", req_url, resp_code, resp_data);
         return ret;
     }
 
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.Parse(resp_data.c_str());
+    ArenaDocument & d = arena.document();
+    rapidjson::ParseResult ok = arena.parse();
     if (!ok)
     {
         SPDLOG_WARN("Failed to parse response json, error '{}' ({})", 
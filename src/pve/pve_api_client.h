@@ -1,12 +1,23 @@
 #ifndef PVE_DDNS_CLIENT_SRC_PVEAPICLIENT_H
 #define PVE_DDNS_CLIENT_SRC_PVEAPICLIENT_H
 
+#include <chrono>
+#include <memory>
 #include <string>
 
+#include "../http/http_headers.h"
+#include "../http/http_transport.h"
+
+class JsonStreamExtractor;
+
 /// Proxmox VE API client
 class PveApiClient
 {
 public:
+    /// Constructor
+    /// \param transport HTTP transport
+    explicit PveApiClient(std::shared_ptr<IHttpTransport> transport) : _transport(std::move(transport)) {}
+
     /// Init using infos from global config
     /// \return Init result
     bool init();
@@ -21,10 +32,13 @@ public:
     /// \param node PVE node name
     /// \param vmid VM id
     /// \param iface Interface name
+    /// \param deadline Deadline over all attempts, the request fails once it passes
     /// \return A pair of strings, first is IPv4 address, second is IPv6 address (empty string if failed to get)
     std::pair<std::string, std::string> getGuestIp(const std::string & node,
                                                    int vmid,
-                                                   const std::string & iface);
+                                                   const std::string & iface,
+                                                   std::chrono::steady_clock::time_point deadline =
+                                                       std::chrono::steady_clock::time_point::max());
 
     /// Set IPv4, IPv6 address of a specific host interface (will only generate a temp modified config file)
     /// \param node PVE node name
@@ -46,15 +60,23 @@ public:
     bool revertHostNetworkChange(const std::string & node);
 
 protected:
-    bool req(const std::string & api_url, const std::string & req_data, int & resp_code, std::string & resp_data) const;
+    bool req(const std::string & api_url, const std::string & req_data, const std::string & stats_name,
+             int & resp_code, std::string & resp_data) const;
+    bool reqStream(const std::string & api_url, const std::string & stats_name,
+                   std::chrono::steady_clock::time_point deadline, JsonStreamExtractor & extractor,
+                   int & resp_code, std::string & resp_head, bool app_server_errors) const;
     bool reqHostNetwork(const std::string & method, const std::string & node) const;
     bool checkApiHost() const;
 
 private:
+    /// HTTP transport
+    std::shared_ptr<IHttpTransport> _transport;
     /// PVE API host (root url)
     std::string _api_host;
-    /// PVE API access token
+    /// PVE API access token (USER@REALM!TOKENID=UUID)
     std::string _api_token;
+    /// Prebuilt authorization headers
+    HttpHeaders _auth_headers;
 };
 
 #endif //PVE_DDNS_CLIENT_SRC_PVEAPICLIENT_H
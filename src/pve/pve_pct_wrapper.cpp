@@ -30,12 +30,16 @@ bool PvePctWrapper::isLxcGuest(const int vmid) const
     return std::find(_lxc_vmids.begin(), _lxc_vmids.end(), vmid) != _lxc_vmids.end();
 }
 
-std::pair<std::string, std::string> PvePctWrapper::getGuestIp(const int vmid, const std::string & iface) const
+std::pair<std::string, std::string> PvePctWrapper::getGuestIp(const int vmid, const std::string & iface,
+                                                              const std::chrono::milliseconds timeout) const
 {
     if (!_available)
         return { "", "" };
 
-    const std::string pct_ip_addr = fmt::format("{} exec {} ip addr", pct_cmd, vmid);
+    std::string pct_ip_addr = fmt::format("{} exec {} ip addr", pct_cmd, vmid);
+    // A hung container must not hold up the caller, coreutils timeout kills pct (and SIGKILLs it 1s later)
+    if (timeout.count() > 0)
+        pct_ip_addr = fmt::format("timeout -k 1 {:.3f} {}", static_cast<double>(timeout.count()) / 1000, pct_ip_addr);
     std::string result;
     if (!shell_execute(pct_ip_addr, result))
     {
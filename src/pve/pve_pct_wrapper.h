@@ -1,6 +1,7 @@
 #ifndef PVE_DDNS_CLIENT_SRC_PVE_PVE_PCT_WRAPPER_H
 #define PVE_DDNS_CLIENT_SRC_PVE_PVE_PCT_WRAPPER_H
 
+#include <chrono>
 #include <string>
 #include <vector>
 
@@ -20,8 +21,10 @@ public:
     /// Get LXC guest VM IPv4 and IPv6 address of specific interface
     /// \param vmid VM id
     /// \param iface Interface name
+    /// \param timeout Kill pct after this long, 0 for no limit
     /// \return A pair of strings, first is IPv4 address, second is IPv6 address (empty string if failed to get)
-    std::pair<std::string, std::string> getGuestIp(int vmid, const std::string & iface) const;
+    std::pair<std::string, std::string> getGuestIp(
+        int vmid, const std::string & iface, std::chrono::milliseconds timeout = std::chrono::milliseconds(0)) const;
 
 protected:
     static bool execute(const std::string & cmd, std::string & result);
@@ -0,0 +1,226 @@
+#include "signal_waiter.h"
+
+#if WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#endif
+
+#include "spdlog/spdlog.h"
+
+#if WIN32
+static BOOL WINAPI ctrl_handler(DWORD fdw_ctrl_type)
+{
+    switch (fdw_ctrl_type)
+    {
+        case CTRL_C_EVENT:
+        case CTRL_BREAK_EVENT:
+        case CTRL_CLOSE_EVENT:
+        case CTRL_SHUTDOWN_EVENT:
+            // Called on its own thread, so it may block and lock
+            SignalWaiter::getInstance().signalled(SignalEvent::Stop);
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+#else
+// Read and write end of the wakeup fd, the same eventfd on Linux
+static int g_wake_read_fd = -1;
+static int g_wake_write_fd = -1;
+// Set by signal handlers, taken by the watcher thread
+static volatile sig_atomic_t g_stop_signal = 0;
+static volatile sig_atomic_t g_reload_signal = 0;
+// Tells the watcher thread to exit
+static volatile sig_atomic_t g_watcher_quit = 0;
+
+// Async-signal-safe wakeup of the watcher thread
+static void notify_wake_fd()
+{
+    const int saved_errno = errno;
+#ifdef __linux__
+    const uint64_t one = 1;
+    (void)!write(g_wake_write_fd, &one, sizeof(one));
+#else
+    const char one = 1;
+    (void)!write(g_wake_write_fd, &one, sizeof(one));
+#endif
+    errno = saved_errno;
+}
+
+static void drain_wake_fd()
+{
+    char buf[64];
+    while (read(g_wake_read_fd, buf, sizeof(buf)) > 0)
+    {
+    }
+}
+
+static void signal_handler(const int sig)
+{
+    if (SIGHUP == sig)
+        g_reload_signal = 1;
+    else
+        g_stop_signal = sig;
+    notify_wake_fd();
+}
+#endif
+
+SignalWaiter::~SignalWaiter()
+{
+    stop();
+}
+
+bool SignalWaiter::start(std::function<void()> on_stop)
+{
+    _on_stop = std::move(on_stop);
+#if WIN32
+    if (!SetConsoleCtrlHandler(ctrl_handler, TRUE))
+    {
+        SPDLOG_WARN("Failed to set console ctrl handler!");
+        return false;
+    }
+#else
+    if (_watcher.joinable())
+        return true;
+#ifdef __linux__
+    g_wake_read_fd = g_wake_write_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_wake_read_fd < 0)
+    {
+        SPDLOG_WARN("Failed to create eventfd, error is {}!", errno);
+        return false;
+    }
+#else
+    int fds[2];
+    if (0 != pipe(fds))
+    {
+        SPDLOG_WARN("Failed to create wakeup pipe, error is {}!", errno);
+        return false;
+    }
+    for (const int fd : fds)
+    {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    g_wake_read_fd = fds[0];
+    g_wake_write_fd = fds[1];
+#endif
+
+    struct sigaction action = {};
+    action.sa_handler = signal_handler;
+    sigemptyset(&action.sa_mask);
+    // Interrupted syscalls (e.g. reading pct output) are restarted rather than failed
+    action.sa_flags = SA_RESTART;
+    for (const int sig : { SIGTERM, SIGINT, SIGHUP })
+    {
+        if (0 != sigaction(sig, &action, nullptr))
+            SPDLOG_WARN("Failed to install handler of signal {}, error is {}!", sig, errno);
+    }
+    g_watcher_quit = 0;
+    _watcher = std::thread(&SignalWaiter::watch, this);
+#endif
+    return true;
+}
+
+void SignalWaiter::stop()
+{
+#if WIN32
+    SetConsoleCtrlHandler(ctrl_handler, FALSE);
+#else
+    if (!_watcher.joinable())
+        return;
+    struct sigaction action = {};
+    action.sa_handler = SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    for (const int sig : { SIGTERM, SIGINT, SIGHUP })
+        sigaction(sig, &action, nullptr);
+    g_watcher_quit = 1;
+    notify_wake_fd();
+    _watcher.join();
+
+    close(g_wake_read_fd);
+    if (g_wake_write_fd != g_wake_read_fd)
+        close(g_wake_write_fd);
+    g_wake_read_fd = g_wake_write_fd = -1;
+#endif
+}
+
+SignalEvent SignalWaiter::waitUntil(const std::chrono::steady_clock::time_point until)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cv.wait_until(lock, until, [this] { return _woken || _reload || _stop; });
+    _woken = false;
+    if (_stop)
+        return SignalEvent::Stop;
+    if (_reload)
+    {
+        _reload = false;
+        return SignalEvent::Reload;
+    }
+    return SignalEvent::None;
+}
+
+void SignalWaiter::wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _woken = true;
+    }
+    _cv.notify_all();
+}
+
+void SignalWaiter::signalled(const SignalEvent event)
+{
+    if (SignalEvent::Stop == event)
+    {
+        // A second stop signal while shutting down is not handled again
+        if (_stop.exchange(true))
+            return;
+        SPDLOG_INFO("Received stop signal, stopping...");
+        if (_on_stop)
+            _on_stop();
+    }
+    else if (SignalEvent::Reload == event)
+    {
+        SPDLOG_INFO("Received reload signal, reloading config...");
+        std::lock_guard<std::mutex> lock(_mutex);
+        _reload = true;
+    }
+    // Lock so the notification is not lost between predicate check and wait
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+    }
+    _cv.notify_all();
+}
+
+void SignalWaiter::watch()
+{
+#if !WIN32
+    pollfd pfd{ g_wake_read_fd, POLLIN, 0 };
+    while (true)
+    {
+        if (poll(&pfd, 1, -1) < 0 && EINTR != errno)
+        {
+            SPDLOG_WARN("Failed to poll wakeup fd, error is {}!", errno);
+            return;
+        }
+        drain_wake_fd();
+        if (g_watcher_quit)
+            return;
+        if (0 != g_stop_signal)
+            signalled(SignalEvent::Stop);
+        if (0 != g_reload_signal)
+        {
+            g_reload_signal = 0;
+            signalled(SignalEvent::Reload);
+        }
+    }
+#endif
+}
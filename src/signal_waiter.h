@@ -0,0 +1,78 @@
+#ifndef PVE_DDNS_CLIENT_SRC_SIGNAL_WAITER_H
+#define PVE_DDNS_CLIENT_SRC_SIGNAL_WAITER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/// Event the main loop is woken up for
+enum class SignalEvent
+{
+    /// Wait time reached or woken up by wake()
+    None,
+    /// SIGTERM or SIGINT (ctrl+c on Windows), sticky once received
+    Stop,
+    /// SIGHUP, reported once per signal
+    Reload
+};
+
+/// Turns SIGTERM, SIGINT and SIGHUP into main loop wakeups. Signal handlers only write to an eventfd (a pipe where
+/// eventfd is not available), a watcher thread reads it, runs the stop callback and wakes waitUntil. Signals are
+/// not blocked, so child processes (pct, timeout) keep default signal handling.
+class SignalWaiter
+{
+public:
+    static SignalWaiter & getInstance()
+    {
+        static SignalWaiter instance;
+        return instance;
+    }
+
+    /// \brief Install signal handlers and start watcher thread
+    /// \param on_stop Called on watcher thread when a stop signal is received, e.g. to cut in-flight requests short
+    /// \return Operation result
+    bool start(std::function<void()> on_stop);
+
+    /// \brief Restore default signal handlers and stop watcher thread
+    void stop();
+
+    /// \brief Wait until given time, a signal or wake()
+    /// \param until Time to wait until
+    /// \return Event woken up for
+    SignalEvent waitUntil(std::chrono::steady_clock::time_point until);
+
+    /// \brief Wake up waitUntil from another thread
+    void wake();
+
+    /// \brief Check if a stop signal is received
+    /// \return Result
+    bool stopping() const { return _stop; }
+
+    /// \brief Handle a received signal, called by the watcher thread (the console control handler on Windows)
+    /// \param event Stop or Reload
+    void signalled(SignalEvent event);
+
+private:
+    SignalWaiter() = default;
+    ~SignalWaiter();
+    SignalWaiter(SignalWaiter const &) = delete;
+    SignalWaiter & operator=(SignalWaiter const &) = delete;
+
+    void watch();
+
+    /// Watcher thread
+    std::thread _watcher;
+    /// Called on stop signal
+    std::function<void()> _on_stop;
+    /// Guards _woken and _reload
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _woken = false;
+    bool _reload = false;
+    std::atomic<bool> _stop{ false };
+};
+
+#endif //PVE_DDNS_CLIENT_SRC_SIGNAL_WAITER_H
@@ -5,7 +5,10 @@
 
 #include "fmt/format.h"
 #include "spdlog/spdlog.h"
-#include "curl/curl.h"
+
+#include "http/http_client.h"
+#include "http/http_transport.h"
+#include "http/json_stream_extractor.h"
 
 #if WIN32
 #define pve_popen _popen
@@ -15,53 +18,6 @@
 #define pve_pclose pclose
 #endif
 
-//typedef struct curl_read_userdata_
-//{
-//    const std::string & req_data;
-//    size_t pos;
-//} curl_read_userdata;
-
-static size_t write_string_callback(const void * bufptr, size_t size, size_t nitems, void * userp)
-{
-    if (nullptr == bufptr || nullptr == userp)
-    {
-        SPDLOG_WARN("Invalid curl write callback function params bufptr and/or userp!");
-        return nitems;
-    }
-    if (size < 1 || nitems < 1)
-    {
-        SPDLOG_WARN("Invalid curl write callback function params, size is '{}', nitems is '{}'!", size, nitems);
-        return nitems;
-    }
-
-    auto * str = reinterpret_cast<std::string *>(userp);
-    str->append(reinterpret_cast<const char *>(bufptr), size * nitems);
-    return nitems;
-}
-
-//static size_t read_string_callback(char * bufptr, size_t size, size_t nitems, void * userp)
-//{
-//    if (nullptr == bufptr || nullptr == userp)
-//    {
-//        SPDLOG_WARN("Invalid curl read callback function params bufptr and/pr userp!");
-//        return nitems;
-//    }
-//    if (size < 1 || nitems < 1)
-//    {
-//        SPDLOG_WARN("Invalid curl read callback function params, size is '{}', nitems is '{}'!", size, nitems);
-//        return nitems;
-//    }
-//
-//    auto * userdata = reinterpret_cast<curl_read_userdata *>(userp);
-//    if (userdata->pos >= userdata->req_data.length())
-//        return 0;
-//    auto bytes_left = static_cast<size_t>(userdata->req_data.length() - userdata->pos);
-//    auto bytes_to_copy = bytes_left < (size * nitems) ? bytes_left : (size * nitems);
-//    memcpy(bufptr, userdata->req_data.data() + userdata->pos, bytes_to_copy);
-//    userdata->pos += bytes_to_copy;
-//    return bytes_to_copy;
-//}
-
 std::string get_version_string()
 {
 #if defined(PVE_DDNS_CLIENT_VER)
@@ -353,97 +309,106 @@ bool get_ip_from_ipconfig_result(const std::string& result, const std::string& i
     return false;
 }
 
-bool http_req(const std::string & url, const std::string & req_data, long timeout_ms,
-              const std::vector<std::string> & custom_headers,
-              int & resp_code, std::string & resp_data)
+// Copy service timeouts into request
+static void set_http_timeouts(http_request & req, const http_timeouts & timeouts)
 {
-    return http_req(url, req_data, timeout_ms, custom_headers, "", resp_code, resp_data);
+    req.timeout_ms = static_cast<long>(timeouts.total.count());
+    req.connect_timeout_ms = static_cast<long>(timeouts.connect.count());
+    req.tls_timeout_ms = static_cast<long>(timeouts.tls.count());
+    req.first_byte_timeout_ms = static_cast<long>(timeouts.first_byte.count());
+    req.deadline = timeouts.deadline;
 }
 
-bool http_req(const std::string & url, const std::string & req_data, long timeout_ms,
-              const std::vector<std::string> & custom_headers, const std::string & method,
-              int & resp_code, std::string & resp_data)
+bool http_req(IHttpTransport & transport, const std::string & url, const std::string & req_data, long timeout_ms,
+              const std::vector<std::string> & custom_headers, int & resp_code, std::string & resp_data)
 {
-    CURL * curl = curl_easy_init();
-    if (nullptr == curl)
-    {
-        SPDLOG_ERROR("Failed to curl_easy_init!");
-        return false;
-    }
-//    curl_read_userdata read_userdata = { req_data, 0 };
-    curl_easy_setopt(curl, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_3);
-    curl_easy_setopt(curl, CURLoption::CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLoption::CURLOPT_TIMEOUT_MS, timeout_ms);
-    if (!req_data.empty())
-    {
-        if ("put" == method)
-        {
-            curl_easy_setopt(curl, CURLoption::CURLOPT_CUSTOMREQUEST, "PUT");
-//            curl_easy_setopt(curl, CURLoption::CURLOPT_UPLOAD, 1L);
-//            curl_easy_setopt(curl, CURLoption::CURLOPT_READFUNCTION, read_string_callback);
-//            curl_easy_setopt(curl, CURLoption::CURLOPT_READDATA, static_cast<void *>(&read_userdata));
-//            curl_easy_setopt(curl, CURLoption::CURLOPT_INFILESIZE_LARGE, req_data.length());
-        }
-        else if ("delete" == method)
-            curl_easy_setopt(curl, CURLoption::CURLOPT_CUSTOMREQUEST, "DELETE");
-        else
-            curl_easy_setopt(curl, CURLoption::CURLOPT_POST, 1L);
+    return http_req(transport, url, req_data, timeout_ms, custom_headers, "", resp_code, resp_data);
+}
 
-        curl_easy_setopt(curl, CURLoption::CURLOPT_POSTFIELDS, req_data.c_str());
-        curl_easy_setopt(curl, CURLoption::CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(req_data.length()));
-    }
-    else
-    {
-        if ("put" == method)
-            curl_easy_setopt(curl, CURLoption::CURLOPT_CUSTOMREQUEST, "PUT");
-        else if ("delete" == method)
-            curl_easy_setopt(curl, CURLoption::CURLOPT_CUSTOMREQUEST, "DELETE");
-    }
-    curl_easy_setopt(curl, CURLoption::CURLOPT_WRITEFUNCTION, write_string_callback);
-    curl_easy_setopt(curl, CURLoption::CURLOPT_WRITEDATA, static_cast<void *>(&resp_data));
+bool http_req(IHttpTransport & transport, const std::string & url, const std::string & req_data, long timeout_ms,
+              const std::vector<std::string> & custom_headers, const std::string & method, int & resp_code,
+              std::string & resp_data)
+{
+    http_request req;
+    req.url = url;
+    req.body = req_data;
+    req.method = method;
+    req.headers = custom_headers;
+    req.timeout_ms = timeout_ms;
+    // Receive straight into caller buffer so its capacity is reused across requests
+    resp_data.clear();
+    req.body_buffer = &resp_data;
+
+    http_response resp;
+    const bool ret = transport.perform(std::move(req), resp);
+    resp_code = resp.code;
 
-    bool ret = false;
-    do
-    {
-        char errbuf[CURL_ERROR_SIZE] = {};
-        curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errbuf);
-//#ifndef NDEBUG
-//        curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
-//#endif
-        curl_slist * http_headers = nullptr;
-        for (const auto & custom_header : custom_headers)
-        {
-            http_headers = curl_slist_append(http_headers, custom_header.c_str());
-//            http_headers = curl_slist_append(http_headers, "Accept: application/json");
-//            http_headers = curl_slist_append(http_headers, "Content-Type: application/json");
-//            http_headers = curl_slist_append(http_headers, "charset: utf-8");
-        }
-        if (nullptr != http_headers)
-            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, http_headers);
+    return ret;
+}
 
-        CURLcode curl_ret = curl_easy_perform(curl);
-        if (curl_ret != CURLcode::CURLE_OK)
-        {
-            SPDLOG_WARN("curl_easy_perform fail, curl code is '{}', error is '{}', url is '{}'!", 
-                static_cast<int>(curl_ret), errbuf, url);
-            break;
-        }
-        ret = true;
+bool http_req(IHttpTransport & transport, const std::string & url, const std::string & req_data,
+              const http_timeouts & timeouts, const HttpHeaders & headers, const std::string & method,
+              const std::string & rate_limit_key, const std::string & stats_name, int & resp_code,
+              std::string & resp_data)
+{
+    return http_req(transport, url, req_data, timeouts, headers, method, rate_limit_key, stats_name, "",
+                    resp_code, resp_data);
+}
 
-        long code = 0;
-        curl_ret = curl_easy_getinfo(curl, CURLINFO::CURLINFO_RESPONSE_CODE, &code);
-        if (CURLcode::CURLE_OK != curl_ret)
-        {
-            SPDLOG_WARN("curl_easy_getinfo fail, curl_code is '{}', error is '{}'!",
-                 static_cast<int>(curl_ret), errbuf);
-            break;
-        }
-        resp_code = static_cast<int>(code);
-        if (resp_code != 200)
-            SPDLOG_WARN("'{}' request failed, response code is '{}'!", url, resp_code);
-    } while (false);
+bool http_req(IHttpTransport & transport, const std::string & url, const std::string & req_data,
+              const http_timeouts & timeouts, const HttpHeaders & headers, const std::string & method,
+              const std::string & rate_limit_key, const std::string & stats_name, const std::string & cache_key,
+              int & resp_code, std::string & resp_data)
+{
+    http_request req;
+    req.url = url;
+    req.body = req_data;
+    req.method = method;
+    req.header_list = headers;
+    req.rate_limit_key = rate_limit_key;
+    req.cache_key = cache_key;
+    req.stats_name = stats_name;
+    set_http_timeouts(req, timeouts);
+    resp_data.clear();
+    req.body_buffer = &resp_data;
+
+    http_response resp;
+    const bool ret = transport.perform(std::move(req), resp);
+    resp_code = resp.code;
 
-    curl_easy_cleanup(curl);
+    return ret;
+}
+
+bool http_req_stream(IHttpTransport & transport, const std::string & url, const std::string & req_data,
+                     const http_timeouts & timeouts, const HttpHeaders & headers, const std::string & method,
+                     const std::string & rate_limit_key, const std::string & stats_name,
+                     JsonStreamExtractor & extractor, int & resp_code, std::string & resp_head,
+                     const bool app_server_errors)
+{
+    http_request req;
+    req.url = url;
+    req.body = req_data;
+    req.method = method;
+    req.header_list = headers;
+    req.rate_limit_key = rate_limit_key;
+    req.stats_name = stats_name;
+    req.app_server_errors = app_server_errors;
+    set_http_timeouts(req, timeouts);
+
+    extractor.reset();
+    req.on_data = [&extractor](const char * data, size_t len)
+    {
+        // Keep receiving on parse error so response code is still available, error is reported by finish
+        extractor.feed(data, len);
+        return true;
+    };
+
+    http_response resp;
+    const bool ret = transport.perform(std::move(req), resp);
+    resp_code = resp.code;
+    resp_head = std::move(resp.body);
+    if (ret)
+        extractor.finish();
 
     return ret;
 }
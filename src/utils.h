@@ -4,6 +4,12 @@
 #include <string>
 #include <vector>
 
+#include "config.h"
+
+class JsonStreamExtractor;
+class HttpHeaders;
+class IHttpTransport;
+
 /// \brief Get app version string
 /// \return Version string
 std::string get_version_string();
@@ -58,7 +64,8 @@ bool get_ip_from_ip_addr_result(const std::string & result, const std::string &
 bool get_ip_from_ipconfig_result(const std::string & result, const std::string & iface,
                                  std::string & ipv4, std::string & ipv6);
 
-/// \brief HTTP request
+/// \brief HTTP request (blocking wrapper over the asynchronous HttpClient engine)
+/// \param transport HTTP transport
 /// \param url URL
 /// \param req_data Request body
 /// \param timeout_ms Timeout
@@ -66,11 +73,11 @@ bool get_ip_from_ipconfig_result(const std::string & result, const std::string &
 /// \param resp_code Response code
 /// \param resp_data Response data
 /// \return If request succeeded
-bool http_req(const std::string & url, const std::string & req_data, long timeout_ms,
-              const std::vector<std::string> & custom_headers,
-              int & resp_code, std::string & resp_data);
+bool http_req(IHttpTransport & transport, const std::string & url, const std::string & req_data, long timeout_ms,
+              const std::vector<std::string> & custom_headers, int & resp_code, std::string & resp_data);
 
-/// \brief HTTP request with customizable method, e.g. PUT, DELETE...
+/// \brief HTTP request with customizable method, e.g. PUT, DELETE, PATCH...
+/// \param transport HTTP transport
 /// \param url URL
 /// \param req_data Request body
 /// \param timeout_ms Timeout
@@ -79,10 +86,66 @@ bool http_req(const std::string & url, const std::string & req_data, long timeou
 /// \param resp_code Response code
 /// \param resp_data Response data
 /// \return If request succeeded
-bool http_req(const std::string & url, const std::string & req_data, long timeout_ms,
-              const std::vector<std::string> & custom_headers, const std::string & method,
+bool http_req(IHttpTransport & transport, const std::string & url, const std::string & req_data, long timeout_ms,
+              const std::vector<std::string> & custom_headers, const std::string & method, int & resp_code,
+              std::string & resp_data);
+
+/// \brief HTTP request with prebuilt headers
+/// \param transport HTTP transport
+/// \param url URL
+/// \param req_data Request body
+/// \param timeouts Timeouts of the service
+/// \param headers Prebuilt headers
+/// \param method Method name
+/// \param rate_limit_key Rate limiter bucket key, empty for no limit
+/// \param stats_name Logical endpoint name timings are recorded under
+/// \param resp_code Response code
+/// \param resp_data Response data
+/// \return If request succeeded
+bool http_req(IHttpTransport & transport, const std::string & url, const std::string & req_data,
+              const http_timeouts & timeouts, const HttpHeaders & headers, const std::string & method,
+              const std::string & rate_limit_key, const std::string & stats_name, int & resp_code,
+              std::string & resp_data);
+
+/// \brief Conditional HTTP request with prebuilt headers, response code 304 means values stored in HttpCache
+/// for cache_key are still valid
+/// \param transport HTTP transport
+/// \param url URL
+/// \param req_data Request body
+/// \param timeouts Timeouts of the service
+/// \param headers Prebuilt headers
+/// \param method Method name
+/// \param rate_limit_key Rate limiter bucket key, empty for no limit
+/// \param stats_name Logical endpoint name timings are recorded under
+/// \param cache_key HttpCache key
+/// \param resp_code Response code
+/// \param resp_data Response data
+/// \return If request succeeded
+bool http_req(IHttpTransport & transport, const std::string & url, const std::string & req_data,
+              const http_timeouts & timeouts, const HttpHeaders & headers, const std::string & method,
+              const std::string & rate_limit_key, const std::string & stats_name, const std::string & cache_key,
               int & resp_code, std::string & resp_data);
 
+/// \brief HTTP request with JSON response body parsed incrementally as it arrives (no full body copy or DOM)
+/// \param transport HTTP transport
+/// \param url URL
+/// \param req_data Request body
+/// \param timeouts Timeouts of the service
+/// \param headers Prebuilt headers
+/// \param method Method name
+/// \param rate_limit_key Rate limiter bucket key, empty for no limit
+/// \param stats_name Logical endpoint name timings are recorded under
+/// \param extractor JSON stream extractor with registered paths, reset before request and finished after
+/// \param resp_code Response code
+/// \param resp_head First bytes of response body, for diagnostics
+/// \param app_server_errors 5xx responses are answers of the resource, not retried or counted as endpoint failure
+/// \return If request succeeded, check extractor.error() for JSON parse result
+bool http_req_stream(IHttpTransport & transport, const std::string & url, const std::string & req_data,
+                     const http_timeouts & timeouts, const HttpHeaders & headers, const std::string & method,
+                     const std::string & rate_limit_key, const std::string & stats_name,
+                     JsonStreamExtractor & extractor, int & resp_code, std::string & resp_head,
+                     bool app_server_errors = false);
+
 /// \brief Execute shell command with output stored in result
 /// \param cmd Shell command
 /// \param result Result
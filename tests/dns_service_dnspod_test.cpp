@@ -0,0 +1,89 @@
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "../src/dns_service/dns_service_dnspod.h"
+#include "../src/http/http_transport_mock.h"
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) \
+        { \
+            std::fprintf(stderr, "%s:%d: check '%s' failed\n", __FILE__, __LINE__, #cond); \
+            ++failures; \
+        } \
+    } while (false)
+
+static constexpr const char * API_VERSION = "https://dnsapi.cn/Info.Version";
+static constexpr const char * API_RECORD_LIST = "https://dnsapi.cn/Record.List";
+static constexpr const char * API_RECORD_DDNS = "https://dnsapi.cn/Record.Ddns";
+
+static http_mock_response json_response(int code, const std::string & body)
+{
+    http_mock_response resp;
+    resp.code = code;
+    resp.body = body;
+    return resp;
+}
+
+static size_t count_calls(const HttpTransportMock & mock, const std::string & url)
+{
+    size_t count = 0;
+    for (const auto & call : mock.getCalls())
+    {
+        if (call.url == url)
+            ++count;
+    }
+    return count;
+}
+
+int main()
+{
+    int failures = 0;
+
+    auto mock = std::make_shared<HttpTransportMock>();
+    mock->setRoute("post", API_VERSION,
+        json_response(200, R"({"status":{"code":"1","message":"4.6"}})"));
+    mock->setRoute("post", API_RECORD_LIST, json_response(200,
+        R"({"status":{"code":"1"},"records":[{"id":"42","line_id":"0","value":"1.1.1.1"}]})"));
+
+    DnsServiceDnspod service(mock);
+    CHECK(service.setCredentials("1,token"));
+    CHECK("1.1.1.1" == service.getIpv4("www.example.com"));
+
+    // No record cache for the domain, nothing may be written
+    CHECK(!service.setIpv4("other.example.com", "2.2.2.2"));
+    CHECK(0 == count_calls(*mock, API_RECORD_DDNS));
+
+    // API level failure is reported with HTTP 200
+    mock->setRoute("post", API_RECORD_DDNS,
+        json_response(200, R"({"status":{"code":"-15","message":"Domain is locked"}})"));
+    CHECK(!service.setIpv4("www.example.com", "2.2.2.2"));
+
+    // Server error
+    mock->setRoute("post", API_RECORD_DDNS, json_response(500, "Internal Server Error"));
+    CHECK(!service.setIpv4("www.example.com", "2.2.2.2"));
+
+    // Transport error
+    http_mock_response refused;
+    refused.curl_code = CURLE_COULDNT_CONNECT;
+    mock->setRoute("post", API_RECORD_DDNS, refused);
+    CHECK(!service.setIpv4("www.example.com", "2.2.2.2"));
+
+    // Success, the record found by the lookup is written
+    mock->setRoute("post", API_RECORD_DDNS, json_response(200, R"({"status":{"code":"1"}})"));
+    CHECK(service.setIpv4("www.example.com", "2.2.2.2"));
+    const auto calls = mock->getCalls();
+    CHECK(!calls.empty() && API_RECORD_DDNS == calls.back().url
+        && std::string::npos != calls.back().body.find("record_id=42")
+        && std::string::npos != calls.back().body.find("sub_domain=www"));
+    CHECK(4 == count_calls(*mock, API_RECORD_DDNS));
+
+    if (0 != failures)
+    {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("All checks passed\n");
+    return 0;
+}
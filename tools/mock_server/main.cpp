@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <csignal>
+#include <iostream>
+#include <sstream>
+
+#include <pthread.h>
+
+#include "spdlog/spdlog.h"
+#include "cmdline.h"
+
+#include "mock_apis.h"
+#include "mock_http_server.h"
+
+// Split comma separated list
+static std::vector<std::string> split_list(const std::string & str)
+{
+    std::vector<std::string> items;
+    std::istringstream ss(str);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty())
+            items.push_back(item);
+    }
+    return items;
+}
+
+int main(int argc, char * argv[])
+{
+    cmdline::parser p;
+    p.add("help", 'h', "Show usage");
+    p.add<std::string>("address", 'a', "Listen address", false, "127.0.0.1");
+    p.add<int>("http-port", 0, "Plain HTTP port, 0 to disable", false, 18080);
+    p.add<int>("https-port", 0, "HTTPS port, 0 to disable (requires cert and key)", false, 18443);
+    p.add<std::string>("cert", 0, "PEM certificate chain for HTTPS", false, "");
+    p.add<std::string>("key", 0, "PEM private key for HTTPS", false, "");
+    p.add<int>("latency-ms", 0, "Latency added to every response", false, 0);
+    p.add<int>("jitter-ms", 0, "Random extra latency, up to this", false, 0);
+    p.add<double>("error-rate", 0, "Probability of a 503 response", false, 0);
+    p.add<std::string>("zones", 0, "Comma separated zones created up front", false, "example.com");
+    p.add<int>("records", 0, "A and AAAA records created up front in each zone (host0..hostN-1)", false, 0);
+    p.add<int>("guests", 0, "Number of running QEMU guests with agent", false, 0);
+    p.add<int>("first-vmid", 0, "vmid of the first guest", false, 100);
+    p.add<std::string>("public-ipv4", 0, "Public IPv4 reported by ipify and Porkbun ping", false, "203.0.113.10");
+    p.add<std::string>("public-ipv6", 0, "Public IPv6 reported by ipify and Porkbun ping", false, "2001:db8::10");
+    p.add("verbose", 'v', "Log every request");
+
+    if (!p.parse(argc, argv))
+    {
+        std::cerr << "Failed to parse command line params!" << std::endl;
+        std::cout << p.usage() << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (p.exist("help"))
+    {
+        std::cout << p.usage() << std::endl;
+        return EXIT_SUCCESS;
+    }
+    if (p.exist("verbose"))
+        spdlog::set_level(spdlog::level::debug);
+
+    mock_api_config config;
+    config.latency = std::chrono::milliseconds(std::max(0, p.get<int>("latency-ms")));
+    config.jitter = std::chrono::milliseconds(std::max(0, p.get<int>("jitter-ms")));
+    config.error_rate = p.get<double>("error-rate");
+    config.zones = split_list(p.get<std::string>("zones"));
+    config.records = std::max(0, p.get<int>("records"));
+    config.guests = std::max(0, p.get<int>("guests"));
+    config.first_vmid = p.get<int>("first-vmid");
+    config.public_ipv4 = p.get<std::string>("public-ipv4");
+    config.public_ipv6 = p.get<std::string>("public-ipv6");
+
+    // Signals are taken synchronously below, block them before any thread starts
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    MockApis apis(config);
+    MockHttpServer server([&apis](const mock_request & req, mock_response & resp) { apis.handle(req, resp); });
+
+    const std::string address = p.get<std::string>("address");
+    const int http_port = p.get<int>("http-port");
+    const int https_port = p.get<int>("https-port");
+    bool ok = true;
+    if (http_port > 0)
+        ok = server.listen(address, http_port, false);
+    if (ok && https_port > 0)
+    {
+        if (p.get<std::string>("cert").empty() || p.get<std::string>("key").empty())
+            SPDLOG_WARN("No certificate given, HTTPS port {} is not served!", https_port);
+        else
+            ok = server.setTls(p.get<std::string>("cert"), p.get<std::string>("key"))
+                && server.listen(address, https_port, true);
+    }
+    if (!ok)
+        return EXIT_FAILURE;
+
+    int sig = 0;
+    sigwait(&signals, &sig);
+    SPDLOG_INFO("Received signal {}, stopping...", sig);
+    server.stop();
+
+    return EXIT_SUCCESS;
+}
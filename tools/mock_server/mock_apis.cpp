@@ -0,0 +1,463 @@
+#include "mock_apis.h"
+
+#include <sstream>
+#include <thread>
+
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+#include "rapidjson/document.h"
+
+// Escape a string for a JSON string literal
+static std::string json_escape(const std::string & str)
+{
+    std::string out;
+    out.reserve(str.length());
+    for (const char c : str)
+    {
+        if ('"' == c || '\\' == c)
+        {
+            out.push_back('\\');
+            out.push_back(c);
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+            out.append(fmt::format("\\u{:04x}", static_cast<int>(c)));
+        else
+            out.push_back(c);
+    }
+    return out;
+}
+
+// Decode a percent-encoded form or query component
+static std::string url_decode(const std::string & str)
+{
+    std::string out;
+    out.reserve(str.length());
+    for (size_t i = 0; i < str.length(); ++i)
+    {
+        if ('+' == str[i])
+            out.push_back(' ');
+        else if ('%' == str[i] && i + 2 < str.length())
+        {
+            out.push_back(static_cast<char>(std::stoi(str.substr(i + 1, 2), nullptr, 16)));
+            i += 2;
+        }
+        else
+            out.push_back(str[i]);
+    }
+    return out;
+}
+
+// Parse application/x-www-form-urlencoded body or query string
+static std::unordered_map<std::string, std::string> parse_form(const std::string & str)
+{
+    std::unordered_map<std::string, std::string> params;
+    std::istringstream ss(str);
+    std::string item;
+    while (std::getline(ss, item, '&'))
+    {
+        const size_t eq = item.find('=');
+        if (std::string::npos == eq)
+            params[url_decode(item)] = "";
+        else
+            params[url_decode(item.substr(0, eq))] = url_decode(item.substr(eq + 1));
+    }
+    return params;
+}
+
+// Split path into segments, empty segments (e.g. from "//") are skipped
+static std::vector<std::string> split_path(const std::string & path)
+{
+    std::vector<std::string> segments;
+    std::istringstream ss(path);
+    std::string item;
+    while (std::getline(ss, item, '/'))
+    {
+        if (!item.empty())
+            segments.push_back(url_decode(item));
+    }
+    return segments;
+}
+
+// Root domain of a name, same split as the client (www.domain.com => domain.com)
+static std::string root_domain(const std::string & name)
+{
+    const size_t last = name.rfind('.');
+    if (std::string::npos == last || 0 == last)
+        return name;
+    const size_t prev = name.rfind('.', last - 1);
+    return std::string::npos == prev ? name : name.substr(prev + 1);
+}
+
+// Full name from root domain and sub domain ("" or "@" for the root itself)
+static std::string full_name(const std::string & domain, const std::string & sub)
+{
+    return sub.empty() || "@" == sub ? domain : fmt::format("{}.{}", sub, domain);
+}
+
+MockApis::MockApis(const mock_api_config & config) : _config(config), _random(std::random_device()())
+{
+    for (const auto & zone : _config.zones)
+    {
+        for (int i = 0; i < _config.records; ++i)
+        {
+            const std::string name = fmt::format("host{}.{}", i, zone);
+            getRecord(name, "A").content = fmt::format("10.{}.{}.{}", (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+            getRecord(name, "AAAA").content = fmt::format("fd00::{:x}", i);
+        }
+    }
+    SPDLOG_INFO("Mock APIs ready, {} zones, {} records, {} guests.", _zones.size(), _records.size(), _config.guests);
+}
+
+void MockApis::handle(const mock_request & req, mock_response & resp)
+{
+    if (injectFault(resp))
+    {
+        SPDLOG_DEBUG("{} {}{} -> {} (injected)", req.method, req.host, req.path, resp.code);
+        return;
+    }
+
+    if ("api.cloudflare.com" == req.host)
+        cloudflare(req, resp);
+    else if ("api.porkbun.com" == req.host || "api-ipv4.porkbun.com" == req.host)
+        porkbun(req, resp);
+    else if ("dnsapi.cn" == req.host)
+        dnspod(req, resp);
+    else if ("api.ipify.org" == req.host || "api6.ipify.org" == req.host)
+        ipify(req, resp);
+    else if (0 == req.path.compare(0, 10, "/api2/json"))
+        pve(req, resp);
+    else
+    {
+        resp.code = 404;
+        resp.body = R"({"error":"unknown API"})";
+    }
+    SPDLOG_DEBUG("{} {}{} -> {}", req.method, req.host, req.path, resp.code);
+}
+
+bool MockApis::injectFault(mock_response & resp)
+{
+    std::chrono::milliseconds delay = _config.latency;
+    bool fail = false;
+    {
+        std::lock_guard<std::mutex> lock(_random_mutex);
+        if (_config.jitter.count() > 0)
+            delay += std::chrono::milliseconds(
+                std::uniform_int_distribution<long long>(0, _config.jitter.count())(_random));
+        fail = std::uniform_real_distribution<double>(0.0, 1.0)(_random) < _config.error_rate;
+    }
+    if (delay.count() > 0)
+        std::this_thread::sleep_for(delay);
+    if (!fail)
+        return false;
+    resp.code = 503;
+    resp.body = R"({"error":"mock injected error"})";
+    return true;
+}
+
+void MockApis::cloudflare(const mock_request & req, mock_response & resp)
+{
+    const auto record_json = [](const mock_record & r)
+    {
+        return fmt::format(R"({{"id":"{}","zone_id":"{}","name":"{}","type":"{}","content":"{}",)"
+                           R"("proxied":false,"ttl":1}})",
+                           r.id, r.zone_id, json_escape(r.name), r.type, json_escape(r.content));
+    };
+    const auto auth = req.headers.find("authorization");
+    if (req.headers.end() == auth || auth->second.compare(0, 7, "Bearer ") != 0)
+    {
+        resp.code = 400;
+        resp.body = R"({"success":false,"errors":[{"code":6003,"message":"Invalid request headers"}],"result":null})";
+        return;
+    }
+
+    // /client/v4/...
+    const auto seg = split_path(req.path);
+    const auto query = parse_form(req.query);
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (5 == seg.size() && "user" == seg[2] && "tokens" == seg[3] && "verify" == seg[4] && "GET" == req.method)
+    {
+        resp.body = R"({"success":true,"errors":[],"messages":[],"result":{"id":"mock","status":"active"}})";
+        return;
+    }
+    if (3 == seg.size() && "zones" == seg[2] && "GET" == req.method)
+    {
+        const auto name = query.find("name");
+        std::string result;
+        if (query.end() != name && !name->second.empty())
+            result = fmt::format(R"({{"id":"{}","name":"{}","status":"active"}})", getZoneId(name->second),
+                                 json_escape(name->second));
+        resp.body = fmt::format(R"({{"success":true,"errors":[],"messages":[],"result":[{}]}})", result);
+        return;
+    }
+    if (5 == seg.size() && "zones" == seg[2] && "dns_records" == seg[4] && "GET" == req.method)
+    {
+        const auto name = query.find("name");
+        const auto type = query.find("type");
+        std::string result;
+        if (query.end() != name && query.end() != type)
+            result = record_json(getRecord(name->second, type->second));
+        resp.body = fmt::format(R"({{"success":true,"errors":[],"messages":[],"result":[{}]}})", result);
+        return;
+    }
+    if (6 == seg.size() && "zones" == seg[2] && "dns_records" == seg[4] && "PATCH" == req.method)
+    {
+        mock_record * record = getRecordById(seg[5]);
+        rapidjson::Document d;
+        d.Parse(req.body.c_str());
+        if (nullptr == record || d.HasParseError() || !d.IsObject())
+        {
+            resp.code = nullptr == record ? 404 : 400;
+            resp.body = R"({"success":false,"errors":[{"code":81044,"message":"Record does not exist."}],)"
+                        R"("result":null})";
+            return;
+        }
+        if (d.HasMember("content") && d["content"].IsString())
+            record->content = d["content"].GetString();
+        resp.body = fmt::format(R"({{"success":true,"errors":[],"messages":[],"result":{}}})", record_json(*record));
+        return;
+    }
+
+    resp.code = 404;
+    resp.body = R"({"success":false,"errors":[{"code":7003,"message":"Could not route"}],"result":null})";
+}
+
+void MockApis::porkbun(const mock_request & req, mock_response & resp)
+{
+    rapidjson::Document d;
+    d.Parse(req.body.c_str());
+    if (d.HasParseError() || !d.IsObject() || !d.HasMember("apikey") || !d.HasMember("secretapikey"))
+    {
+        resp.code = 400;
+        resp.body = R"({"status":"ERROR","message":"Invalid API key."})";
+        return;
+    }
+
+    // /api/json/v3/ping or /api/json/v3/dns/{op}/{domain}/{type}[/{sub}]
+    const auto seg = split_path(req.path);
+    if (4 == seg.size() && "ping" == seg[3])
+    {
+        const std::string & ip = "api-ipv4.porkbun.com" == req.host ? _config.public_ipv4 : _config.public_ipv6;
+        resp.body = fmt::format(R"({{"status":"SUCCESS","yourIp":"{}"}})", ip);
+        return;
+    }
+    if ((7 == seg.size() || 8 == seg.size()) && "dns" == seg[3])
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        mock_record & record = getRecord(full_name(seg[5], 8 == seg.size() ? seg[7] : ""), seg[6]);
+        if ("retrieveByNameType" == seg[4])
+        {
+            resp.body = fmt::format(
+                R"({{"status":"SUCCESS","records":[{{"id":"{}","name":"{}","type":"{}","content":"{}",)"
+                R"("ttl":"600","prio":"0","notes":""}}]}})",
+                record.id, json_escape(record.name), record.type, json_escape(record.content));
+            return;
+        }
+        if ("editByNameType" == seg[4])
+        {
+            if (!d.HasMember("content") || !d["content"].IsString())
+            {
+                resp.code = 400;
+                resp.body = R"({"status":"ERROR","message":"Missing content."})";
+                return;
+            }
+            record.content = d["content"].GetString();
+            resp.body = R"({"status":"SUCCESS"})";
+            return;
+        }
+    }
+
+    resp.code = 404;
+    resp.body = R"({"status":"ERROR","message":"Unknown endpoint."})";
+}
+
+void MockApis::dnspod(const mock_request & req, mock_response & resp)
+{
+    const auto params = parse_form(req.body);
+    const auto token = params.find("login_token");
+    if (params.end() == token || token->second.find(',') == std::string::npos)
+    {
+        resp.body = R"({"status":{"code":"-1","message":"Login fail, please check login info."}})";
+        return;
+    }
+    const auto param = [&params](const char * name)
+    {
+        const auto found = params.find(name);
+        return params.end() == found ? std::string() : found->second;
+    };
+
+    if ("/Info.Version" == req.path)
+    {
+        resp.body = R"({"status":{"code":"1","message":"4.6","created_at":"2024-01-01 00:00:00"}})";
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if ("/Record.List" == req.path)
+    {
+        const std::string domain = param("domain");
+        const mock_record & r = getRecord(full_name(domain, param("sub_domain")), param("record_type"));
+        const std::string sub = r.name == domain ? "@" : r.name.substr(0, r.name.length() - domain.length() - 1);
+        resp.body = fmt::format(
+            R"({{"status":{{"code":"1","message":"Action completed successful"}},"domain":{{"id":"{}","name":"{}"}},)"
+            R"("info":{{"sub_domains":"1","record_total":"1","records_num":"1"}},)"
+            R"("records":[{{"id":"{}","name":"{}","line":"default","line_id":"0","type":"{}","ttl":"600",)"
+            R"("value":"{}","enabled":"1"}}]}})",
+            r.zone_id, json_escape(domain), r.id, json_escape(sub), r.type, json_escape(r.content));
+        return;
+    }
+    if ("/Record.Ddns" == req.path)
+    {
+        mock_record * record = getRecordById(param("record_id"));
+        if (nullptr == record)
+        {
+            resp.body = R"({"status":{"code":"8","message":"Record id invalid"}})";
+            return;
+        }
+        // Without a value the address the request came from is used
+        std::string value = param("value");
+        if (value.empty())
+            value = "A" == record->type ? _config.public_ipv4 : _config.public_ipv6;
+        record->content = value;
+        resp.body = fmt::format(
+            R"({{"status":{{"code":"1","message":"Action completed successful"}},)"
+            R"("record":{{"id":{},"name":"{}","value":"{}"}}}})",
+            record->id, json_escape(record->name), json_escape(record->content));
+        return;
+    }
+
+    resp.code = 404;
+    resp.body = R"({"status":{"code":"-3","message":"Unknown action"}})";
+}
+
+void MockApis::pve(const mock_request & req, mock_response & resp)
+{
+    const auto auth = req.headers.find("authorization");
+    if (req.headers.end() == auth || auth->second.compare(0, 12, "PVEAPIToken=") != 0)
+    {
+        resp.code = 401;
+        resp.body = R"({"data":null})";
+        return;
+    }
+
+    // /api2/json/...
+    const auto seg = split_path(req.path);
+    if (3 == seg.size() && "version" == seg[2] && "GET" == req.method)
+    {
+        resp.body = R"({"data":{"version":"8.2.4","release":"8.2","repoid":"mock"}})";
+        return;
+    }
+
+    // /api2/json/nodes/{node}/qemu/{vmid}/agent/network-get-interfaces
+    if (8 == seg.size() && "nodes" == seg[2] && "qemu" == seg[4] && "network-get-interfaces" == seg[7])
+    {
+        const int vmid = std::atoi(seg[5].c_str());
+        const int index = vmid - _config.first_vmid;
+        if (index < 0 || index >= _config.guests)
+        {
+            resp.code = 500;
+            resp.body = R"({"data":null,"message":"QEMU guest agent is not running\n"})";
+            return;
+        }
+        resp.body = fmt::format(
+            R"({{"data":{{"result":[)"
+            R"({{"name":"lo","hardware-address":"00:00:00:00:00:00","ip-addresses":[)"
+            R"({{"ip-address-type":"ipv4","ip-address":"127.0.0.1","prefix":8}},)"
+            R"({{"ip-address-type":"ipv6","ip-address":"::1","prefix":128}}]}},)"
+            R"({{"name":"eth0","hardware-address":"bc:24:11:00:{:02x}:{:02x}","ip-addresses":[)"
+            R"({{"ip-address-type":"ipv4","ip-address":"10.{}.{}.{}","prefix":24}},)"
+            R"({{"ip-address-type":"ipv6","ip-address":"fe80::be24:11ff:fe00:{:x}","prefix":64}},)"
+            R"({{"ip-address-type":"ipv6","ip-address":"2001:db8:100::{:x}","prefix":64}}]}}]}}}})",
+            (index >> 8) & 0xff, index & 0xff, 100 + ((index >> 16) & 0xff), (index >> 8) & 0xff, index & 0xff,
+            index, vmid);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    // /api2/json/nodes/{node}/network/{iface}
+    if (6 == seg.size() && "nodes" == seg[2] && "network" == seg[4])
+    {
+        auto & iface = _ifaces[seg[3] + "/" + seg[5]];
+        if ("GET" == req.method)
+        {
+            resp.body = fmt::format(
+                R"({{"data":{{"iface":"{}","type":"bridge","method":"static","address":"{}","netmask":"24",)"
+                R"("address6":"{}","netmask6":"64"}}}})",
+                json_escape(seg[5]), iface.address, iface.address6);
+            return;
+        }
+        if ("PUT" == req.method)
+        {
+            const auto params = parse_form(req.body);
+            const auto address = params.find("address");
+            const auto address6 = params.find("address6");
+            iface.pending_address = params.end() != address ? address->second : iface.address;
+            iface.pending_address6 = params.end() != address6 ? address6->second : iface.address6;
+            resp.body = R"({"data":null})";
+            return;
+        }
+    }
+    // /api2/json/nodes/{node}/network, PUT applies and DELETE reverts pending changes of all interfaces
+    if (5 == seg.size() && "nodes" == seg[2] && "network" == seg[4] && ("PUT" == req.method || "DELETE" == req.method))
+    {
+        const std::string prefix = seg[3] + "/";
+        for (auto & kv : _ifaces)
+        {
+            if (0 != kv.first.compare(0, prefix.length(), prefix) || kv.second.pending_address.empty())
+                continue;
+            if ("PUT" == req.method)
+            {
+                kv.second.address = kv.second.pending_address;
+                kv.second.address6 = kv.second.pending_address6;
+            }
+            kv.second.pending_address.clear();
+            kv.second.pending_address6.clear();
+        }
+        resp.body = "PUT" == req.method ? fmt::format(R"({{"data":"UPID:{}:mock:srvreload:networking"}})",
+                                                      json_escape(seg[3])) : R"({"data":null})";
+        return;
+    }
+
+    resp.code = 501;
+    resp.body = fmt::format(R"({{"data":null,"message":"Method '{} {}' not implemented"}})", req.method,
+                            json_escape(req.path));
+}
+
+void MockApis::ipify(const mock_request & req, mock_response & resp) const
+{
+    const std::string & ip = "api.ipify.org" == req.host ? _config.public_ipv4 : _config.public_ipv6;
+    resp.body = fmt::format(R"({{"ip":"{}"}})", ip);
+}
+
+const std::string & MockApis::getZoneId(const std::string & zone)
+{
+    auto found = _zones.find(zone);
+    if (_zones.end() == found)
+        found = _zones.emplace(zone, fmt::format("{:032x}", _next_id++)).first;
+    return found->second;
+}
+
+MockApis::mock_record & MockApis::getRecord(const std::string & name, const std::string & type)
+{
+    const std::string key = fmt::format("{} {}", type, name);
+    auto found = _records.find(key);
+    if (_records.end() != found)
+        return found->second;
+
+    // Unknown records are created so any client config works against the mock
+    mock_record record;
+    record.id = std::to_string(_next_id++);
+    record.zone_id = getZoneId(root_domain(name));
+    record.name = name;
+    record.type = type;
+    record.content = "AAAA" == type ? "2001:db8::1" : "192.0.2.1";
+    _record_ids[record.id] = key;
+    return _records.emplace(key, std::move(record)).first->second;
+}
+
+MockApis::mock_record * MockApis::getRecordById(const std::string & id)
+{
+    const auto key = _record_ids.find(id);
+    if (_record_ids.end() == key)
+        return nullptr;
+    return &_records[key->second];
+}
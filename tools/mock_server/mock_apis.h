@@ -0,0 +1,100 @@
+#ifndef PVE_DDNS_CLIENT_TOOLS_MOCK_SERVER_MOCK_APIS_H
+#define PVE_DDNS_CLIENT_TOOLS_MOCK_SERVER_MOCK_APIS_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mock_http_server.h"
+
+/// Mock API behaviour
+typedef struct mock_api_config_
+{
+    /// Latency added to every response
+    std::chrono::milliseconds latency{ 0 };
+    /// Random extra latency, uniform in [0, jitter]
+    std::chrono::milliseconds jitter{ 0 };
+    /// Probability of a request getting a 503 response
+    double error_rate = 0;
+    /// Zones (root domains) known to every DNS provider, records of other zones are created on first lookup
+    std::vector<std::string> zones = { "example.com" };
+    /// A and AAAA records created up front in each zone (host0..hostN-1)
+    int records = 0;
+    /// Number of running QEMU guests with an agent, vmids start at first_vmid
+    int guests = 0;
+    int first_vmid = 100;
+    /// Addresses reported by ipify and Porkbun ping
+    std::string public_ipv4 = "203.0.113.10";
+    std::string public_ipv6 = "2001:db8::10";
+} mock_api_config;
+
+/// In-memory emulation of the Cloudflare, Porkbun, DNSPod, PVE and ipify APIs used by the client.
+/// Requests are routed by Host header, PVE by path so it can be reached at any address.
+class MockApis
+{
+public:
+    explicit MockApis(const mock_api_config & config);
+
+    /// \brief Handle request, thread safe
+    /// \param req Request
+    /// \param resp Response
+    void handle(const mock_request & req, mock_response & resp);
+
+private:
+    /// DNS record
+    typedef struct mock_record_
+    {
+        std::string id;
+        std::string zone_id;
+        /// Full name, e.g. www.example.com
+        std::string name;
+        /// A or AAAA
+        std::string type;
+        std::string content;
+    } mock_record;
+
+    /// PVE host network interface
+    typedef struct mock_iface_
+    {
+        std::string address = "192.168.1.2";
+        std::string address6 = "2001:db8:1::2";
+        /// Written but not yet applied values, empty if none
+        std::string pending_address;
+        std::string pending_address6;
+    } mock_iface;
+
+    bool injectFault(mock_response & resp);
+    void cloudflare(const mock_request & req, mock_response & resp);
+    void porkbun(const mock_request & req, mock_response & resp);
+    void dnspod(const mock_request & req, mock_response & resp);
+    void pve(const mock_request & req, mock_response & resp);
+    void ipify(const mock_request & req, mock_response & resp) const;
+
+    const std::string & getZoneId(const std::string & zone);
+    mock_record & getRecord(const std::string & name, const std::string & type);
+    mock_record * getRecordById(const std::string & id);
+
+    /// Mock API behaviour
+    mock_api_config _config;
+    /// Guards _random
+    std::mutex _random_mutex;
+    std::mt19937 _random;
+    /// Guards zones, records and PVE state
+    std::mutex _mutex;
+    /// Zone IDs by zone name
+    std::unordered_map<std::string, std::string> _zones;
+    /// Records by "type name"
+    std::unordered_map<std::string, mock_record> _records;
+    /// Record keys by record ID
+    std::unordered_map<std::string, std::string> _record_ids;
+    /// PVE host interfaces by "node/iface"
+    std::unordered_map<std::string, mock_iface> _ifaces;
+    /// Next record or zone ID
+    uint64_t _next_id = 1000;
+};
+
+#endif //PVE_DDNS_CLIENT_TOOLS_MOCK_SERVER_MOCK_APIS_H
@@ -0,0 +1,298 @@
+#include "mock_http_server.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "openssl/err.h"
+#include "openssl/ssl.h"
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+
+// Max size of request line and headers
+static constexpr size_t MAX_HEADER_SIZE = 64 * 1024;
+// Idle connections check the running flag this often
+static constexpr int RECV_TIMEOUT_MS = 500;
+
+// Connection over a plain or TLS socket
+typedef struct mock_conn_
+{
+    int fd = -1;
+    SSL * ssl = nullptr;
+
+    // Read some bytes, 0 on close or error, -1 on timeout
+    long read(char * buf, const size_t len) const
+    {
+        if (nullptr != ssl)
+        {
+            const int n = SSL_read(ssl, buf, static_cast<int>(len));
+            if (n > 0)
+                return n;
+            const int err = SSL_get_error(ssl, n);
+            return (SSL_ERROR_WANT_READ == err && (EAGAIN == errno || EWOULDBLOCK == errno)) ? -1 : 0;
+        }
+        const ssize_t n = ::recv(fd, buf, len, 0);
+        if (n > 0)
+            return n;
+        return (n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno)) ? -1 : 0;
+    }
+
+    bool write(const std::string & data) const
+    {
+        size_t sent = 0;
+        while (sent < data.length())
+        {
+            const long n = nullptr != ssl
+                ? SSL_write(ssl, data.data() + sent, static_cast<int>(data.length() - sent))
+                : ::send(fd, data.data() + sent, data.length() - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+                return false;
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+} mock_conn;
+
+static const char * reason_phrase(const int code)
+{
+    switch (code)
+    {
+        case 200: return "OK";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 429: return "Too Many Requests";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "Unknown";
+    }
+}
+
+MockHttpServer::~MockHttpServer()
+{
+    stop();
+    if (nullptr != _ssl_ctx)
+        SSL_CTX_free(_ssl_ctx);
+}
+
+bool MockHttpServer::setTls(const std::string & cert_file, const std::string & key_file)
+{
+    _ssl_ctx = SSL_CTX_new(TLS_server_method());
+    if (nullptr == _ssl_ctx)
+    {
+        SPDLOG_ERROR("Failed to SSL_CTX_new!");
+        return false;
+    }
+    if (SSL_CTX_use_certificate_chain_file(_ssl_ctx, cert_file.c_str()) != 1
+        || SSL_CTX_use_PrivateKey_file(_ssl_ctx, key_file.c_str(), SSL_FILETYPE_PEM) != 1)
+    {
+        SPDLOG_ERROR("Failed to load TLS certificate '{}' or key '{}': {}!", cert_file, key_file,
+                     ERR_error_string(ERR_get_error(), nullptr));
+        SSL_CTX_free(_ssl_ctx);
+        _ssl_ctx = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool MockHttpServer::listen(const std::string & address, const int port, const bool tls)
+{
+    if (tls && nullptr == _ssl_ctx)
+    {
+        SPDLOG_ERROR("TLS listener on port {} requires a certificate!", port);
+        return false;
+    }
+
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        SPDLOG_ERROR("Failed to create socket!");
+        return false;
+    }
+    const int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1
+        || ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(fd, 1024) != 0)
+    {
+        SPDLOG_ERROR("Failed to listen on {}:{}!", address, port);
+        ::close(fd);
+        return false;
+    }
+
+    listener l;
+    l.fd = fd;
+    l.thread = std::thread(&MockHttpServer::acceptLoop, this, fd, tls);
+    _listeners.emplace_back(std::move(l));
+    SPDLOG_INFO("Mock server listening on {}://{}:{}.", tls ? "https" : "http", address, port);
+    return true;
+}
+
+void MockHttpServer::stop()
+{
+    _running = false;
+    for (auto & l : _listeners)
+    {
+        ::shutdown(l.fd, SHUT_RDWR);
+        if (l.thread.joinable())
+            l.thread.join();
+        ::close(l.fd);
+    }
+    _listeners.clear();
+    // Connection threads notice within one receive timeout
+    while (_connections > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(RECV_TIMEOUT_MS / 5));
+}
+
+void MockHttpServer::acceptLoop(const int listen_fd, const bool tls)
+{
+    while (_running)
+    {
+        const int fd = ::accept(listen_fd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            if (!_running)
+                break;
+            continue;
+        }
+        const int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        timeval tv{ 0, RECV_TIMEOUT_MS * 1000 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        ++_connections;
+        std::thread(&MockHttpServer::serve, this, fd, tls).detach();
+    }
+}
+
+void MockHttpServer::serve(const int fd, const bool tls)
+{
+    mock_conn conn;
+    conn.fd = fd;
+    bool ok = true;
+    if (tls)
+    {
+        conn.ssl = SSL_new(_ssl_ctx);
+        SSL_set_fd(conn.ssl, fd);
+        // Handshake may span receive timeouts of a slow client
+        int ret = 0;
+        while (_running && (ret = SSL_accept(conn.ssl)) != 1
+               && SSL_ERROR_WANT_READ == SSL_get_error(conn.ssl, ret)
+               && (EAGAIN == errno || EWOULDBLOCK == errno))
+            ;
+        ok = 1 == ret;
+        if (!ok)
+            SPDLOG_DEBUG("TLS handshake failed: {}", ERR_error_string(ERR_get_error(), nullptr));
+    }
+
+    std::string buf;
+    char chunk[16 * 1024];
+    while (ok && _running)
+    {
+        // Read request line and headers
+        size_t header_end;
+        while ((header_end = buf.find("\r\n\r\n")) == std::string::npos)
+        {
+            const long n = conn.read(chunk, sizeof(chunk));
+            if (n < 0 && _running)
+                continue;
+            if (n <= 0 || buf.length() > MAX_HEADER_SIZE)
+            {
+                ok = false;
+                break;
+            }
+            buf.append(chunk, static_cast<size_t>(n));
+        }
+        if (!ok)
+            break;
+
+        mock_request req;
+        size_t line_end = buf.find("\r\n");
+        const std::string request_line = buf.substr(0, line_end);
+        const size_t sp1 = request_line.find(' ');
+        const size_t sp2 = request_line.rfind(' ');
+        if (std::string::npos == sp1 || sp1 == sp2)
+            break;
+        req.method = request_line.substr(0, sp1);
+        const std::string target = request_line.substr(sp1 + 1, sp2 - sp1 - 1);
+        const size_t qpos = target.find('?');
+        req.path = target.substr(0, qpos);
+        if (std::string::npos != qpos)
+            req.query = target.substr(qpos + 1);
+
+        size_t pos = line_end + 2;
+        while (pos < header_end)
+        {
+            line_end = buf.find("\r\n", pos);
+            const std::string line = buf.substr(pos, line_end - pos);
+            pos = line_end + 2;
+            const size_t colon = line.find(':');
+            if (std::string::npos == colon)
+                continue;
+            std::string name = line.substr(0, colon);
+            std::transform(name.begin(), name.end(), name.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            size_t value_start = colon + 1;
+            while (value_start < line.length() && ' ' == line[value_start])
+                ++value_start;
+            req.headers[name] = line.substr(value_start);
+        }
+        buf.erase(0, header_end + 4);
+        req.host = req.headers["host"].substr(0, req.headers["host"].find(':'));
+
+        const auto expect = req.headers.find("expect");
+        if (req.headers.end() != expect && "100-continue" == expect->second)
+            conn.write("HTTP/1.1 100 Continue\r\n\r\n");
+
+        // Read body
+        const auto content_length = req.headers.find("content-length");
+        const size_t body_len = req.headers.end() != content_length
+            ? static_cast<size_t>(std::strtoull(content_length->second.c_str(), nullptr, 10)) : 0;
+        while (ok && buf.length() < body_len)
+        {
+            const long n = conn.read(chunk, sizeof(chunk));
+            if (n < 0 && _running)
+                continue;
+            if (n <= 0)
+                ok = false;
+            else
+                buf.append(chunk, static_cast<size_t>(n));
+        }
+        if (!ok)
+            break;
+        req.body = buf.substr(0, body_len);
+        buf.erase(0, body_len);
+
+        mock_response resp;
+        _handler(req, resp);
+
+        const auto connection = req.headers.find("connection");
+        const bool close = req.headers.end() != connection && "close" == connection->second;
+        std::string out = fmt::format("HTTP/1.1 {} {}\r\nContent-Type: {}\r\nContent-Length: {}\r\n{}\r\n",
+                                      resp.code, reason_phrase(resp.code), resp.content_type, resp.body.length(),
+                                      close ? "Connection: close\r\n" : "");
+        out.append(resp.body);
+        if (!conn.write(out) || close)
+            break;
+    }
+
+    if (nullptr != conn.ssl)
+    {
+        SSL_shutdown(conn.ssl);
+        SSL_free(conn.ssl);
+    }
+    ::close(fd);
+    --_connections;
+}
@@ -0,0 +1,87 @@
+#ifndef PVE_DDNS_CLIENT_TOOLS_MOCK_SERVER_MOCK_HTTP_SERVER_H
+#define PVE_DDNS_CLIENT_TOOLS_MOCK_SERVER_MOCK_HTTP_SERVER_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+typedef struct ssl_ctx_st SSL_CTX;
+
+/// Request received by the mock server
+typedef struct mock_request_
+{
+    /// Method in upper case, e.g. GET
+    std::string method;
+    /// Path without query string
+    std::string path;
+    /// Query string without '?'
+    std::string query;
+    /// Host header without port
+    std::string host;
+    /// Headers by lower case name
+    std::unordered_map<std::string, std::string> headers;
+    std::string body;
+} mock_request;
+
+/// Response of the mock server
+typedef struct mock_response_
+{
+    int code = 200;
+    std::string content_type = "application/json";
+    std::string body;
+} mock_response;
+
+/// Request handler, called concurrently from connection threads
+using mock_handler = std::function<void(const mock_request & req, mock_response & resp)>;
+
+/// Minimal HTTP/1.1 server on loopback with keep-alive and optional TLS, one thread per connection
+class MockHttpServer
+{
+public:
+    explicit MockHttpServer(mock_handler handler) : _handler(std::move(handler)) {}
+    ~MockHttpServer();
+    MockHttpServer(MockHttpServer const &) = delete;
+    MockHttpServer & operator=(MockHttpServer const &) = delete;
+
+    /// \brief Enable TLS on listeners added afterwards
+    /// \param cert_file PEM certificate chain
+    /// \param key_file PEM private key
+    /// \return Operation result
+    bool setTls(const std::string & cert_file, const std::string & key_file);
+
+    /// \brief Start listening
+    /// \param address Listen address, e.g. 127.0.0.1
+    /// \param port Listen port
+    /// \param tls Serve TLS (setTls must have succeeded)
+    /// \return Operation result
+    bool listen(const std::string & address, int port, bool tls);
+
+    /// \brief Stop listeners, open connections finish their current request
+    void stop();
+
+private:
+    typedef struct listener_
+    {
+        int fd = -1;
+        std::thread thread;
+    } listener;
+
+    void acceptLoop(int listen_fd, bool tls);
+    void serve(int fd, bool tls);
+
+    /// Request handler
+    mock_handler _handler;
+    /// TLS context, nullptr if TLS is not set up
+    SSL_CTX * _ssl_ctx = nullptr;
+    /// Running flag
+    std::atomic<bool> _running{ true };
+    /// Open connections, each served by a detached thread
+    std::atomic<int> _connections{ 0 };
+    /// Listening sockets
+    std::vector<listener> _listeners;
+};
+
+#endif //PVE_DDNS_CLIENT_TOOLS_MOCK_SERVER_MOCK_HTTP_SERVER_H